@@ -5,6 +5,7 @@
 #include <bench/bench.h>
 #include <interfaces/chain.h>
 #include <node/context.h>
+#include <wallet/coincontrol.h>
 #include <wallet/coinselection.h>
 #include <wallet/wallet.h>
 
@@ -62,6 +63,53 @@ static void CoinSelection(benchmark::State& state)
     }
 }
 
+// Coin selection in a wallet with many small outputs, like those staking
+// rewards leave behind: find the available coins and select from them like
+// a send does, branch and bound first and then the fallback.
+static void CoinSelectionLargeWallet(benchmark::State& state)
+{
+    NodeContext node;
+    auto chain = interfaces::MakeChain(node);
+    CWallet wallet(chain.get(), WalletLocation(), WalletDatabase::CreateDummy());
+    wallet.SetupLegacyScriptPubKeyMan();
+    auto locked_chain = chain->lock();
+    LOCK(wallet.cs_wallet);
+    wallet.SetLastBlockProcessed(1000, uint256());
+
+    CTxDestination dest;
+    std::string error;
+    assert(wallet.GetNewDestination(OutputType::LEGACY, "", dest, error));
+    const CScript script = GetScriptForDestination(dest);
+
+    // Add coins of 0.001 to 1 coin, confirmed in block 1
+    for (int i = 0; i < 100000; ++i) {
+        CMutableTransaction tx;
+        tx.nLockTime = i; // so all transactions get different hashes
+        tx.vout.emplace_back((i % 1000 + 1) * COIN / 1000, script);
+        CWalletTx wtx(&wallet, MakeTransactionRef(std::move(tx)));
+        wtx.m_confirm = CWalletTx::Confirmation(CWalletTx::Status::CONFIRMED, 1, uint256(), 0);
+        assert(wallet.AddToWallet(wtx));
+    }
+
+    const CCoinControl coin_control;
+    while (state.KeepRunning()) {
+        std::vector<COutput> coins;
+        wallet.AvailableCoins(*locked_chain, coins, true, &coin_control);
+        assert(coins.size() == 100000);
+
+        std::set<CInputCoin> setCoinsRet;
+        CAmount nValueRet = 0;
+        bool bnb_used;
+        CoinSelectionParams coin_selection_params(true, 34, 148, CFeeRate(0), 0);
+        if (!wallet.SelectCoins(coins, 100 * COIN, setCoinsRet, nValueRet, coin_control, coin_selection_params, bnb_used)) {
+            coin_selection_params.use_bnb = false;
+            nValueRet = 0;
+            assert(wallet.SelectCoins(coins, 100 * COIN, setCoinsRet, nValueRet, coin_control, coin_selection_params, bnb_used));
+        }
+        assert(nValueRet >= 100 * COIN);
+    }
+}
+
 typedef std::set<CInputCoin> CoinSet;
 static NodeContext testNode;
 static auto testChain = interfaces::MakeChain(testNode);
@@ -112,4 +160,5 @@ static void BnBExhaustion(benchmark::State& state)
 }
 
 BENCHMARK(CoinSelection, 650);
+BENCHMARK(CoinSelectionLargeWallet, 5);
 BENCHMARK(BnBExhaustion, 650);
@@ -58,6 +58,37 @@ static void SHA256D64_1024(benchmark::State& state)
     }
 }
 
+static void SHA256D64_1024_CHash256(benchmark::State& state)
+{
+    std::vector<uint8_t> in(64 * 1024, 0);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 1024; ++i) {
+            CHash256().Write(in.data() + 64 * i, 64).Finalize(in.data() + 64 * i);
+        }
+    }
+}
+
+// 76 bytes is the size of a serialized stake kernel.
+static void SHA256D76_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> in(76 * 1024, 0);
+    std::vector<uint8_t> out(32 * 1024);
+    while (state.KeepRunning()) {
+        SHA256D(out.data(), in.data(), 76, 1024);
+    }
+}
+
+static void SHA256D76_1024_CHash256(benchmark::State& state)
+{
+    std::vector<uint8_t> in(76 * 1024, 0);
+    std::vector<uint8_t> out(32 * 1024);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 1024; ++i) {
+            CHash256().Write(in.data() + 76 * i, 76).Finalize(out.data() + 32 * i);
+        }
+    }
+}
+
 static void SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -99,5 +130,8 @@ BENCHMARK(SHA512, 330);
 BENCHMARK(SHA256_32b, 4700 * 1000);
 BENCHMARK(SipHash_32b, 40 * 1000 * 1000);
 BENCHMARK(SHA256D64_1024, 7400);
+BENCHMARK(SHA256D64_1024_CHash256, 1900);
+BENCHMARK(SHA256D76_1024, 1900);
+BENCHMARK(SHA256D76_1024_CHash256, 1700);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
@@ -8,6 +8,7 @@
 #include <validation.h>
 #include <streams.h>
 #include <rpc/blockchain.h>
+#include <rpc/jsonstream.h>
 
 #include <univalue.h>
 
@@ -30,3 +31,50 @@ static void BlockToJsonVerbose(benchmark::State& state) {
 }
 
 BENCHMARK(BlockToJsonVerbose, 10);
+
+// Building the whole document and then its text, as a UniValue reply does.
+// Peak memory holds both the document and the text.
+static void BlockToJsonVerboseWrite(benchmark::State& state) {
+    CDataStream stream(benchmark::data::blockbench, SER_NETWORK, PROTOCOL_VERSION);
+    char a = '\0';
+    stream.write(&a, 1); // Prevent compaction
+
+    CBlock block;
+    stream >> block;
+
+    CBlockIndex blockindex;
+    const uint256 blockHash = block.GetHash();
+    blockindex.phashBlock = &blockHash;
+    blockindex.nBits = 403014710;
+
+    while (state.KeepRunning()) {
+        (void)blockToJSON(block, &blockindex, &blockindex, /*verbose*/ true).write();
+    }
+}
+
+// Streaming the same text, as a streamed reply does. Peak memory holds one
+// transaction's document and at most JSON_STREAM_FLUSH_SIZE bytes of text.
+static void BlockToJsonVerboseStream(benchmark::State& state) {
+    CDataStream stream(benchmark::data::blockbench, SER_NETWORK, PROTOCOL_VERSION);
+    char a = '\0';
+    stream.write(&a, 1); // Prevent compaction
+
+    CBlock block;
+    stream >> block;
+
+    CBlockIndex blockindex;
+    const uint256 blockHash = block.GetHash();
+    blockindex.phashBlock = &blockHash;
+    blockindex.nBits = 403014710;
+
+    size_t written = 0;
+    while (state.KeepRunning()) {
+        JSONStreamWriter writer([&written](const std::string& chunk) { written += chunk.size(); });
+        blockToJSONStream(writer, block, &blockindex, &blockindex);
+        writer.Flush();
+    }
+    assert(written > 0);
+}
+
+BENCHMARK(BlockToJsonVerboseWrite, 10);
+BENCHMARK(BlockToJsonVerboseStream, 10);
@@ -0,0 +1,55 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <random.h>
+#include <script/sigcache.h>
+
+#include <thread>
+#include <vector>
+
+static const int CONTENTION_THREADS = 32;
+static const int OPERATIONS_PER_THREAD = 1000;
+
+// Many threads looking up and adding signature cache entries at once, like
+// parallel script checks and mempool acceptance do. Three in four
+// operations look up an entry of a set that is half in the cache, the
+// fourth inserts a new entry.
+static void SigCacheContention(benchmark::State& state, unsigned int shards)
+{
+    ShardedCuckooCache cache(shards);
+    cache.setup_bytes((DEFAULT_MAX_SIG_CACHE_SIZE << 20) / 2);
+
+    FastRandomContext rng(true);
+    std::vector<uint256> entries(CONTENTION_THREADS * OPERATIONS_PER_THREAD);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        entries[i] = rng.rand256();
+        if (i % 2 == 0) cache.insert(entries[i]);
+    }
+
+    while (state.KeepRunning()) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < CONTENTION_THREADS; ++t) {
+            threads.emplace_back([&cache, &entries, t] {
+                FastRandomContext insecure_rand(true);
+                for (int i = 0; i < OPERATIONS_PER_THREAD; ++i) {
+                    if (i % 4 == 0) {
+                        cache.insert(insecure_rand.rand256());
+                    } else {
+                        cache.contains(entries[t * OPERATIONS_PER_THREAD + i], false);
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+}
+
+static void SigCacheContentionSingleShard(benchmark::State& state) { SigCacheContention(state, 1); }
+static void SigCacheContentionSharded(benchmark::State& state) { SigCacheContention(state, DEFAULT_SIG_CACHE_SHARDS); }
+
+BENCHMARK(SigCacheContentionSingleShard, 20);
+BENCHMARK(SigCacheContentionSharded, 20);
@@ -21,6 +21,7 @@ static constexpr int GCS_SER_VERSION = 0;
 
 static const std::map<BlockFilterType, std::string> g_filter_types = {
     {BlockFilterType::BASIC, "basic"},
+    {BlockFilterType::CONTRACT, "contract"},
 };
 
 template <typename OStream>
@@ -297,9 +298,23 @@ BlockFilter::BlockFilter(BlockFilterType filter_type, const CBlock& block, const
     if (!BuildParams(params)) {
         throw std::invalid_argument("unknown filter_type");
     }
+    if (filter_type == BlockFilterType::CONTRACT) {
+        throw std::invalid_argument("contract filters are built from receipts");
+    }
     m_filter = GCSFilter(params, BasicFilterElements(block, block_undo));
 }
 
+BlockFilter::BlockFilter(BlockFilterType filter_type, const uint256& block_hash,
+                         const GCSFilter::ElementSet& elements)
+    : m_filter_type(filter_type), m_block_hash(block_hash)
+{
+    GCSFilter::Params params;
+    if (!BuildParams(params)) {
+        throw std::invalid_argument("unknown filter_type");
+    }
+    m_filter = GCSFilter(params, elements);
+}
+
 bool BlockFilter::BuildParams(GCSFilter::Params& params) const
 {
     switch (m_filter_type) {
@@ -309,6 +324,12 @@ bool BlockFilter::BuildParams(GCSFilter::Params& params) const
         params.m_P = BASIC_FILTER_P;
         params.m_M = BASIC_FILTER_M;
         return true;
+    case BlockFilterType::CONTRACT:
+        params.m_siphash_k0 = m_block_hash.GetUint64(0);
+        params.m_siphash_k1 = m_block_hash.GetUint64(1);
+        params.m_P = CONTRACT_FILTER_P;
+        params.m_M = CONTRACT_FILTER_M;
+        return true;
     case BlockFilterType::INVALID:
         return false;
     }
@@ -84,10 +84,14 @@ public:
 
 constexpr uint8_t BASIC_FILTER_P = 19;
 constexpr uint32_t BASIC_FILTER_M = 784931;
+constexpr uint8_t CONTRACT_FILTER_P = 19;
+constexpr uint32_t CONTRACT_FILTER_M = 784931;
 
 enum class BlockFilterType : uint8_t
 {
     BASIC = 0,
+    //! Contract addresses and log topics of a block, taken from its receipts
+    CONTRACT = 128,
     INVALID = 255,
 };
 
@@ -125,8 +129,13 @@ public:
                 std::vector<unsigned char> filter);
 
     //! Construct a new BlockFilter of the specified type from a block.
+    //! Not for CONTRACT filters, whose elements are not in the block itself.
     BlockFilter(BlockFilterType filter_type, const CBlock& block, const CBlockUndo& block_undo);
 
+    //! Construct a new BlockFilter of the specified type from its elements.
+    BlockFilter(BlockFilterType filter_type, const uint256& block_hash,
+                const GCSFilter::ElementSet& elements);
+
     BlockFilterType GetFilterType() const { return m_filter_type; }
     const uint256& GetBlockHash() const { return m_block_hash; }
     const GCSFilter& GetFilter() const { return m_filter; }
@@ -0,0 +1,77 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockservecache.h>
+
+#include <memusage.h>
+
+//! Approximate memory used per entry besides the payload itself (list and map nodes).
+static const size_t ENTRY_OVERHEAD = 160;
+
+std::shared_ptr<const CSharedNetPayload> BlockServeCache::Get(const uint256& hash, Kind kind)
+{
+    LOCK(m_mutex);
+    auto it = m_index.find(Key(hash, kind));
+    if (it == m_index.end()) {
+        ++m_misses;
+        return nullptr;
+    }
+    ++m_hits;
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->payload;
+}
+
+void BlockServeCache::Put(const uint256& hash, Kind kind, std::shared_ptr<const CSharedNetPayload> payload)
+{
+    const size_t usage = memusage::DynamicUsage(payload->data) + memusage::MallocUsage(sizeof(CSharedNetPayload)) + ENTRY_OVERHEAD;
+    LOCK(m_mutex);
+    if (usage > m_max_bytes) return;
+    const Key key(hash, kind);
+    if (m_index.count(key)) return;
+    m_lru.push_front(Entry{key, std::move(payload), usage});
+    m_index.emplace(key, m_lru.begin());
+    m_usage += usage;
+    Trim();
+}
+
+void BlockServeCache::SetMaxBytes(size_t max_bytes)
+{
+    LOCK(m_mutex);
+    m_max_bytes = max_bytes;
+    Trim();
+}
+
+void BlockServeCache::Trim()
+{
+    while (m_usage > m_max_bytes) {
+        const Entry& entry = m_lru.back();
+        m_usage -= entry.usage;
+        m_index.erase(entry.key);
+        m_lru.pop_back();
+    }
+}
+
+size_t BlockServeCache::GetUsage() const
+{
+    LOCK(m_mutex);
+    return m_usage;
+}
+
+size_t BlockServeCache::GetCount() const
+{
+    LOCK(m_mutex);
+    return m_lru.size();
+}
+
+uint64_t BlockServeCache::GetHits() const
+{
+    LOCK(m_mutex);
+    return m_hits;
+}
+
+uint64_t BlockServeCache::GetMisses() const
+{
+    LOCK(m_mutex);
+    return m_misses;
+}
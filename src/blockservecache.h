@@ -0,0 +1,72 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKSERVECACHE_H
+#define BITCOIN_BLOCKSERVECACHE_H
+
+#include <net.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <list>
+#include <map>
+#include <memory>
+
+/** Default for -blockservecache, in MiB */
+static const int64_t DEFAULT_BLOCK_SERVE_CACHE_MB = 64;
+/** Only blocks at most this deep in the active chain are added to the cache */
+static const int BLOCK_SERVE_CACHE_DEPTH = 144;
+
+/**
+ * LRU cache of serialized "block" and "cmpctblock" payloads, bounded by memory.
+ *
+ * When many peers catch up at the same time they ask for the same recent
+ * blocks. Each payload is read (or serialized) and hashed once, and then
+ * handed to every requesting peer's send queue without copying it.
+ */
+class BlockServeCache
+{
+public:
+    /** The message a payload was serialized for */
+    enum class Kind : uint8_t {
+        BLOCK,            //!< "block" with witnesses, identical to the on-disk format
+        BLOCK_NO_WITNESS, //!< "block" without witnesses
+        CMPCT,            //!< "cmpctblock" with wtxid short ids (version 2)
+        CMPCT_NO_WITNESS, //!< "cmpctblock" with txid short ids (version 1)
+    };
+
+    explicit BlockServeCache(size_t max_bytes) : m_max_bytes(max_bytes) {}
+
+    std::shared_ptr<const CSharedNetPayload> Get(const uint256& hash, Kind kind);
+    void Put(const uint256& hash, Kind kind, std::shared_ptr<const CSharedNetPayload> payload);
+
+    //! Change the memory bound, evicting entries as needed; 0 disables the cache.
+    void SetMaxBytes(size_t max_bytes);
+
+    size_t GetUsage() const;
+    size_t GetCount() const;
+    uint64_t GetHits() const;
+    uint64_t GetMisses() const;
+
+private:
+    using Key = std::pair<uint256, Kind>;
+    struct Entry {
+        Key key;
+        std::shared_ptr<const CSharedNetPayload> payload;
+        size_t usage;
+    };
+
+    void Trim() EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    mutable Mutex m_mutex;
+    //! Most recently used first.
+    std::list<Entry> m_lru GUARDED_BY(m_mutex);
+    std::map<Key, std::list<Entry>::iterator> m_index GUARDED_BY(m_mutex);
+    size_t m_usage GUARDED_BY(m_mutex){0};
+    size_t m_max_bytes GUARDED_BY(m_mutex);
+    uint64_t m_hits GUARDED_BY(m_mutex){0};
+    uint64_t m_misses GUARDED_BY(m_mutex){0};
+};
+
+#endif // BITCOIN_BLOCKSERVECACHE_H
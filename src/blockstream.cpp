@@ -0,0 +1,134 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockstream.h>
+
+#include <consensus/consensus.h>
+#include <consensus/merkle.h>
+#include <consensus/tx_check.h>
+#include <consensus/validation.h>
+
+#include <assert.h>
+#include <string.h>
+
+namespace {
+
+/** Stream over the part of the payload received so far, which remembers whether it ran out of data. */
+class PartialReader
+{
+private:
+    const int m_type;
+    const int m_version;
+    const char* const m_data;
+    const size_t m_end;
+    size_t m_pos;
+    bool m_truncated{false};
+
+public:
+    PartialReader(int type, int version, const char* data, size_t pos, size_t end)
+        : m_type(type), m_version(version), m_data(data), m_end(end), m_pos(pos) {}
+
+    template<typename T>
+    PartialReader& operator>>(T& obj)
+    {
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+
+    int GetVersion() const { return m_version; }
+    int GetType() const { return m_type; }
+    size_t GetPos() const { return m_pos; }
+    bool IsTruncated() const { return m_truncated; }
+
+    void read(char* dst, size_t n)
+    {
+        if (n == 0) {
+            return;
+        }
+        if (m_end - m_pos < n) {
+            m_truncated = true;
+            throw std::ios_base::failure("PartialReader::read(): end of data");
+        }
+        memcpy(dst, m_data + m_pos, n);
+        m_pos += n;
+    }
+};
+
+} // namespace
+
+BlockStreamParser::BlockStreamParser(int type, int version, uint32_t message_size)
+    : m_type(type), m_version(version), m_message_size(message_size), m_block(std::make_shared<CBlock>()) {}
+
+bool BlockStreamParser::Invalid(const std::string& reason)
+{
+    m_state = State::INVALID;
+    m_reject_reason = reason;
+    return false;
+}
+
+bool BlockStreamParser::Update(const char* data, size_t available)
+{
+    assert(available <= m_message_size);
+    if (m_state == State::INVALID) return false;
+    if (m_state == State::COMPLETE) return true;
+
+    // Anything that does not parse once all data is there is malformed.
+    const bool all_received = available == m_message_size;
+    if (available < m_retry_size && !all_received) return true;
+
+    while (m_state != State::COMPLETE) {
+        PartialReader reader(m_type, m_version, data, m_pos, available);
+        try {
+            if (m_state == State::HEADER) {
+                CBlockHeader& header = *m_block;
+                reader >> header;
+                m_state = State::TX_COUNT;
+            } else if (m_state == State::TX_COUNT) {
+                m_tx_count = ReadCompactSize(reader);
+                // Each transaction takes at least MIN_SERIALIZABLE_TRANSACTION_WEIGHT / WITNESS_SCALE_FACTOR bytes.
+                const size_t max_tx_count = (m_message_size - reader.GetPos()) / (MIN_SERIALIZABLE_TRANSACTION_WEIGHT / WITNESS_SCALE_FACTOR);
+                if (m_tx_count == 0 || m_tx_count > max_tx_count) {
+                    return Invalid("bad-blk-length");
+                }
+                m_state = State::TRANSACTIONS;
+            } else {
+                CTransactionRef tx;
+                reader >> tx;
+                TxValidationState state;
+                if (!CheckTransaction(*tx, state)) {
+                    return Invalid(state.GetRejectReason());
+                }
+                // First transaction must be coinbase, the rest must not be
+                if (m_block->vtx.empty() != tx->IsCoinBase()) {
+                    return Invalid(m_block->vtx.empty() ? "bad-cb-missing" : "bad-cb-multiple");
+                }
+                m_block->vtx.push_back(std::move(tx));
+                if (m_block->vtx.size() == m_tx_count) {
+                    bool mutated;
+                    if (BlockMerkleRoot(*m_block, &mutated) != m_block->hashMerkleRoot) {
+                        return Invalid("bad-txnmrklroot");
+                    }
+                    if (mutated) {
+                        return Invalid("bad-txns-duplicate");
+                    }
+                    m_state = State::COMPLETE;
+                }
+            }
+        } catch (const std::ios_base::failure&) {
+            if (!reader.IsTruncated() || all_received) {
+                return Invalid("bad-blk-format");
+            }
+            m_retry_size = available + (available - m_pos);
+            return true;
+        }
+        m_pos = reader.GetPos();
+    }
+    return true;
+}
+
+std::shared_ptr<CBlock> BlockStreamParser::TakeBlock()
+{
+    assert(m_state == State::COMPLETE);
+    return std::move(m_block);
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKSTREAM_H
+#define BITCOIN_BLOCKSTREAM_H
+
+#include <primitives/block.h>
+
+#include <memory>
+#include <string>
+
+/** "block" messages at least this large are parsed while they are being received */
+static const unsigned int MIN_STREAMED_BLOCK_SIZE = 1000000;
+
+/**
+ * Incrementally deserializes and pre-checks a "block" message payload.
+ *
+ * The block-size DGP allows blocks of up to 32 MB. Instead of buffering such a
+ * block and only then parsing and checking it, the header and each transaction
+ * are parsed as soon as their bytes have arrived, so that malformed blocks are
+ * rejected early and the hashing of transactions overlaps with the transfer.
+ *
+ * Only context-free checks are done here: transaction structure, coinbase
+ * position and, once complete, the merkle root. The block is then handed to
+ * validation as usual, which does not have to deserialize it again.
+ */
+class BlockStreamParser
+{
+public:
+    enum class State {
+        HEADER,       //!< waiting for the block header
+        TX_COUNT,     //!< waiting for the number of transactions
+        TRANSACTIONS, //!< parsing transactions
+        COMPLETE,     //!< all transactions parsed and the merkle root matches
+        INVALID,      //!< the payload cannot be a valid block, see GetRejectReason()
+    };
+
+    /**
+     * @param[in] type          Serialization type of the message stream
+     * @param[in] version       Serialization version of the message stream
+     * @param[in] message_size  Size of the whole payload, as announced in the message header
+     */
+    BlockStreamParser(int type, int version, uint32_t message_size);
+
+    /**
+     * Parse as far as possible.
+     *
+     * @param[in] data       The payload received so far
+     * @param[in] available  Number of bytes at data, which only ever grows between calls
+     * @return false if the payload has been found to be invalid
+     */
+    bool Update(const char* data, size_t available);
+
+    State GetState() const { return m_state; }
+    const std::string& GetRejectReason() const { return m_reject_reason; }
+    bool HasHeader() const { return m_state != State::HEADER; }
+    const CBlock& GetBlock() const { return *m_block; }
+
+    /** Hand over the parsed block. Only valid in State::COMPLETE. */
+    std::shared_ptr<CBlock> TakeBlock();
+
+private:
+    bool Invalid(const std::string& reason);
+
+    const int m_type;
+    const int m_version;
+    const uint32_t m_message_size;
+
+    State m_state{State::HEADER};
+    std::string m_reject_reason;
+    std::shared_ptr<CBlock> m_block;
+    uint64_t m_tx_count{0};
+    //! Offset of the first byte not parsed yet.
+    size_t m_pos{0};
+    //! Do not try again before this many bytes are available. A transaction
+    //! that did not fit is retried once the unparsed data has doubled, which
+    //! keeps the total parsing work linear in the size of the block.
+    size_t m_retry_size{0};
+};
+
+#endif // BITCOIN_BLOCKSTREAM_H
@@ -4,6 +4,8 @@
 
 #include <bloom.h>
 
+#include <crypto/siphash.h>
+#include <memusage.h>
 #include <primitives/transaction.h>
 #include <hash.h>
 #include <script/script.h>
@@ -307,3 +309,61 @@ void CRollingBloomFilter::reset()
     nGeneration = 1;
     std::fill(data.begin(), data.end(), 0);
 }
+
+/* Bits per block, and 64 bit words per block */
+static const uint32_t BLOCKED_BLOOM_BLOCK_BITS = 512;
+static const uint32_t BLOCKED_BLOOM_BLOCK_WORDS = BLOCKED_BLOOM_BLOCK_BITS / 64;
+
+CBlockedBloomFilter::CBlockedBloomFilter(uint64_t nElements, double fpRate) : nCapacity(nElements)
+{
+    /* The ideal size of a plain bloom filter is -nElements * log(fpRate) / ln(2)^2 bits.
+     * Because elements do not spread evenly over the blocks, a blocked filter
+     * needs about half as much again for the same false positive rate. */
+    double nFilterBits = -1.5 / LN2SQUARED * std::max<uint64_t>(nElements, 1) * log(fpRate);
+    nBlocks = std::max<uint64_t>(1, std::min<uint64_t>((uint64_t)ceil(nFilterBits / BLOCKED_BLOOM_BLOCK_BITS), std::numeric_limits<uint32_t>::max()));
+    nHashFuncs = std::max(1, std::min((int)round(-log(fpRate) / LN2), 16));
+    k0 = GetRand(std::numeric_limits<uint64_t>::max());
+    k1 = GetRand(std::numeric_limits<uint64_t>::max());
+    data.reset(new std::atomic<uint64_t>[nBlocks * BLOCKED_BLOOM_BLOCK_WORDS]);
+    for (uint64_t i = 0; i < nBlocks * BLOCKED_BLOOM_BLOCK_WORDS; ++i) {
+        data[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+std::atomic<uint64_t>* CBlockedBloomFilter::GetBlock(const uint256& hash, uint32_t& h1, uint32_t& h2) const
+{
+    /* One hash picks the block, another one the bits in it */
+    uint64_t bits = SipHashUint256Extra(k0, k1, hash, 1);
+    h1 = (uint32_t)bits;
+    h2 = (uint32_t)(bits >> 32) | 1;
+    return &data[FastMod((uint32_t)SipHashUint256(k0, k1, hash), nBlocks) * BLOCKED_BLOOM_BLOCK_WORDS];
+}
+
+void CBlockedBloomFilter::insert(const uint256& hash)
+{
+    uint32_t h1, h2;
+    std::atomic<uint64_t>* block = GetBlock(hash, h1, h2);
+    for (int n = 0; n < nHashFuncs; ++n) {
+        uint32_t bit = (h1 + n * h2) % BLOCKED_BLOOM_BLOCK_BITS;
+        block[bit >> 6].fetch_or((uint64_t)1 << (bit & 63), std::memory_order_relaxed);
+    }
+    nInserted.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool CBlockedBloomFilter::contains(const uint256& hash) const
+{
+    uint32_t h1, h2;
+    const std::atomic<uint64_t>* block = GetBlock(hash, h1, h2);
+    for (int n = 0; n < nHashFuncs; ++n) {
+        uint32_t bit = (h1 + n * h2) % BLOCKED_BLOOM_BLOCK_BITS;
+        if (!(block[bit >> 6].load(std::memory_order_relaxed) & ((uint64_t)1 << (bit & 63)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t CBlockedBloomFilter::DynamicMemoryUsage() const
+{
+    return memusage::MallocUsage(nBlocks * BLOCKED_BLOOM_BLOCK_WORDS * sizeof(uint64_t));
+}
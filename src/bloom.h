@@ -7,6 +7,8 @@
 
 #include <serialize.h>
 
+#include <atomic>
+#include <memory>
 #include <vector>
 
 class COutPoint;
@@ -133,4 +135,39 @@ private:
     int nHashFuncs;
 };
 
+/**
+ * BlockedBloomFilter is a bloom filter for large sets of hashes that only
+ * grow, such as all transactions in the txindex. All bits of an element are
+ * in the same 512 bit block, so that a lookup touches a single cache line.
+ *
+ * insert() and contains() may be called from several threads at once.
+ * contains(item) always returns true once insert(item) has returned.
+ *
+ * It needs around 2.7 bytes per element for a false positive rate of 0.1%.
+ */
+class CBlockedBloomFilter
+{
+public:
+    CBlockedBloomFilter(uint64_t nElements, double fpRate);
+
+    void insert(const uint256& hash);
+    bool contains(const uint256& hash) const;
+
+    //! Number of insert() calls so far
+    uint64_t GetInsertCount() const { return nInserted.load(std::memory_order_relaxed); }
+    //! Number of elements the filter was sized for
+    uint64_t GetCapacity() const { return nCapacity; }
+    size_t DynamicMemoryUsage() const;
+
+private:
+    std::atomic<uint64_t>* GetBlock(const uint256& hash, uint32_t& h1, uint32_t& h2) const;
+
+    uint64_t nCapacity;
+    uint64_t nBlocks;
+    int nHashFuncs;
+    uint64_t k0, k1;
+    std::unique_ptr<std::atomic<uint64_t>[]> data;
+    std::atomic<uint64_t> nInserted{0};
+};
+
 #endif // BITCOIN_BLOOM_H
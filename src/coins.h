@@ -167,8 +167,8 @@ public:
 class SaltedOutpointHasher
 {
 private:
-    /** Salt */
-    const uint64_t k0, k1;
+    /** Salt. Not const, so that maps using this hasher can be swapped. */
+    uint64_t k0, k1;
 
 public:
     SaltedOutpointHasher();
@@ -266,6 +266,10 @@ public:
 
     //! Estimate database size (0 if not implemented)
     virtual size_t EstimateSize() const { return 0; }
+
+    //! Memory held by this view for coins not yet in the database, e.g. a
+    //! write still in progress (0 if not implemented)
+    virtual size_t PendingMemoryUsage() const { return 0; }
 };
 
 
@@ -285,6 +289,7 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
     size_t EstimateSize() const override;
+    size_t PendingMemoryUsage() const override;
 };
 
 
@@ -368,7 +373,8 @@ public:
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
-    //! Calculate the size of the cache (in bytes)
+    //! Calculate the size of the cache (in bytes), including coins the views
+    //! below still hold in memory on their way to disk
     size_t DynamicMemoryUsage() const;
 
     /**
@@ -0,0 +1,166 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coinsprefetch.h>
+
+#include <logging.h>
+#include <util/system.h>
+
+#include <algorithm>
+
+//! Number of outpoints read by a worker per job, so that one block is spread over all workers.
+static const size_t PREFETCH_CHUNK_SIZE = 64;
+
+CCoinsViewPrefetch::CCoinsViewPrefetch(CCoinsView* view, const CCoinsView* reader, int threads) : CCoinsViewBacked(view), m_reader(reader)
+{
+    threads = std::min(threads, MAX_PREFETCH_THREADS);
+    for (int i = 0; i < threads; ++i) {
+        m_threads.emplace_back(&TraceThread<std::function<void()>>, "coinsprefetch", std::bind(&CCoinsViewPrefetch::ThreadPrefetch, this));
+    }
+}
+
+CCoinsViewPrefetch::~CCoinsViewPrefetch()
+{
+    {
+        LOCK(m_mutex);
+        m_stop = true;
+        m_queue.clear();
+    }
+    m_cv.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+bool CCoinsViewPrefetch::GetCoin(const COutPoint& outpoint, Coin& coin) const
+{
+    {
+        LOCK(m_mutex);
+        CCoinsMap::iterator it = m_staged.find(outpoint);
+        if (it != m_staged.end()) {
+            // The cache above keeps its own copy from now on.
+            m_staged_usage -= it->second.coin.DynamicMemoryUsage();
+            coin = std::move(it->second.coin);
+            m_staged.erase(it);
+            return true;
+        }
+    }
+    return base->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewPrefetch::HaveCoin(const COutPoint& outpoint) const
+{
+    {
+        LOCK(m_mutex);
+        if (m_staged.count(outpoint)) return true;
+    }
+    return base->HaveCoin(outpoint);
+}
+
+bool CCoinsViewPrefetch::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
+{
+    {
+        LOCK(m_mutex);
+        ++m_generation;
+        CCoinsMap().swap(m_staged);
+        m_staged_usage = 0;
+    }
+    bool ret = base->BatchWrite(mapCoins, hashBlock);
+    {
+        LOCK(m_mutex);
+        ++m_generation;
+    }
+    return ret;
+}
+
+size_t CCoinsViewPrefetch::PendingMemoryUsage() const
+{
+    size_t usage;
+    {
+        LOCK(m_mutex);
+        usage = memusage::DynamicUsage(m_staged) + m_staged_usage;
+    }
+    return usage + base->PendingMemoryUsage();
+}
+
+void CCoinsViewPrefetch::Prefetch(std::vector<COutPoint> outpoints)
+{
+    if (!IsEnabled() || outpoints.empty()) return;
+    {
+        LOCK(m_mutex);
+        for (size_t i = 0; i < outpoints.size(); i += PREFETCH_CHUNK_SIZE) {
+            auto end = outpoints.begin() + std::min(i + PREFETCH_CHUNK_SIZE, outpoints.size());
+            std::vector<COutPoint> chunk(outpoints.begin() + i, end);
+            m_queue.emplace_back([this, chunk] { ReadCoins(chunk); });
+        }
+    }
+    m_cv.notify_all();
+}
+
+void CCoinsViewPrefetch::Enqueue(std::function<void()> job)
+{
+    if (!IsEnabled()) return;
+    {
+        LOCK(m_mutex);
+        m_queue.emplace_back(std::move(job));
+    }
+    m_cv.notify_one();
+}
+
+size_t CCoinsViewPrefetch::GetStagedCount() const
+{
+    LOCK(m_mutex);
+    return m_staged.size();
+}
+
+void CCoinsViewPrefetch::ReadCoins(const std::vector<COutPoint>& outpoints)
+{
+    uint64_t generation;
+    {
+        LOCK(m_mutex);
+        generation = m_generation;
+        if (generation & 1 || m_staged.size() >= MAX_PREFETCH_STAGED_COINS) return;
+    }
+
+    std::vector<std::pair<COutPoint, Coin>> found;
+    found.reserve(outpoints.size());
+    try {
+        for (const COutPoint& outpoint : outpoints) {
+            Coin coin;
+            if (m_reader->GetCoin(outpoint, coin)) {
+                found.emplace_back(outpoint, std::move(coin));
+            }
+        }
+    } catch (const std::exception& e) {
+        // Read errors are left to the validation thread, which reads the
+        // same coins again through the error-handling views.
+        LogPrint(BCLog::COINDB, "%s: %s\n", __func__, e.what());
+        return;
+    }
+
+    LOCK(m_mutex);
+    // A write went through while we were reading; what we read may be outdated.
+    if (m_generation != generation) return;
+    for (auto& entry : found) {
+        const size_t coin_usage = entry.second.DynamicMemoryUsage();
+        if (m_staged.emplace(entry.first, CCoinsCacheEntry(std::move(entry.second))).second) {
+            m_staged_usage += coin_usage;
+        }
+    }
+}
+
+void CCoinsViewPrefetch::ThreadPrefetch()
+{
+    while (true) {
+        std::function<void()> job;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_stop) return;
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        job();
+    }
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_COINSPREFETCH_H
+#define BITCOIN_COINSPREFETCH_H
+
+#include <coins.h>
+#include <sync.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+
+//! -prefetchthreads default
+static const int DEFAULT_PREFETCH_THREADS = 4;
+//! Maximum number of -prefetchthreads
+static const int MAX_PREFETCH_THREADS = 16;
+//! Upper bound on the number of coins staged at any time
+static const size_t MAX_PREFETCH_STAGED_COINS = 100000;
+
+/**
+ * CCoinsView layer that stages coins read ahead of time by a pool of worker
+ * threads, so that block connection finds its inputs in memory instead of
+ * waiting on one database read per cache miss.
+ *
+ * A staged coin is handed over to the cache above on first access. All staged
+ * coins are dropped whenever the cache above flushes into this view, and
+ * reads that raced with a flush are discarded, so the staging area never
+ * holds a coin that differs from the view below.
+ */
+class CCoinsViewPrefetch final : public CCoinsViewBacked
+{
+public:
+    /**
+     * @param[in] view      The view this one is layered on.
+     * @param[in] reader    The view worker threads read coins from. Must be safe to read from
+     *                      several threads without any external lock, and agree with view.
+     * @param[in] threads   Number of worker threads; with none, prefetch requests are ignored.
+     */
+    CCoinsViewPrefetch(CCoinsView* view, const CCoinsView* reader, int threads);
+    ~CCoinsViewPrefetch();
+
+    bool GetCoin(const COutPoint& outpoint, Coin& coin) const override;
+    bool HaveCoin(const COutPoint& outpoint) const override;
+    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock) override;
+    size_t PendingMemoryUsage() const override;
+
+    //! Queue background reads of the given outpoints.
+    void Prefetch(std::vector<COutPoint> outpoints);
+
+    //! Queue arbitrary read-ahead work, e.g. loading a block from disk before prefetching its inputs.
+    void Enqueue(std::function<void()> job);
+
+    //! Whether worker threads are running.
+    bool IsEnabled() const { return !m_threads.empty(); }
+
+    //! Number of coins currently staged.
+    size_t GetStagedCount() const;
+
+private:
+    void ThreadPrefetch();
+    void ReadCoins(const std::vector<COutPoint>& outpoints);
+
+    const CCoinsView* const m_reader;
+    mutable Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::function<void()>> m_queue GUARDED_BY(m_mutex);
+    mutable CCoinsMap m_staged GUARDED_BY(m_mutex);
+    //! Dynamic memory usage of the coins in m_staged.
+    mutable size_t m_staged_usage GUARDED_BY(m_mutex){0};
+    //! Bumped before and after every BatchWrite; odd while one is in progress.
+    uint64_t m_generation GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+};
+
+#endif // BITCOIN_COINSPREFETCH_H
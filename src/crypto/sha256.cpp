@@ -5,6 +5,7 @@
 #include <crypto/sha256.h>
 #include <crypto/common.h>
 
+#include <algorithm>
 #include <assert.h>
 #include <string.h>
 
@@ -29,6 +30,11 @@ namespace sha256d64_avx2
 void Transform_8way(unsigned char* out, const unsigned char* in);
 }
 
+namespace sha256d64_avx512
+{
+void Transform_16way(unsigned char* out, const unsigned char* in);
+}
+
 namespace sha256d64_shani
 {
 void Transform_2way(unsigned char* out, const unsigned char* in);
@@ -461,6 +467,7 @@ TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+TransformD64Type TransformD64_16way = nullptr;
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -544,6 +551,17 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test TransformD64_16way, if available, on the 8 messages above repeated twice.
+    if (TransformD64_16way) {
+        unsigned char in[1024];
+        std::copy(data + 1, data + 513, in);
+        std::copy(data + 1, data + 513, in + 512);
+        unsigned char out[512];
+        TransformD64_16way(out, in);
+        if (!std::equal(out, out + 256, result_d64)) return false;
+        if (!std::equal(out + 256, out + 512, result_d64)) return false;
+    }
+
     return true;
 }
 
@@ -555,6 +573,14 @@ bool AVXEnabled()
     __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
     return (a & 6) == 6;
 }
+
+/** Check whether the OS has enabled the AVX-512 opmask and ZMM registers, on top of the AVX ones. */
+bool AVX512Enabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 0xe6) == 0xe6;
+}
 #endif
 } // namespace
 
@@ -567,16 +593,21 @@ std::string SHA256AutoDetect()
     bool have_xsave = false;
     bool have_avx = false;
     bool have_avx2 = false;
+    bool have_avx512 = false;
     bool have_shani = false;
     bool enabled_avx = false;
+    bool enabled_avx512 = false;
 
     (void)AVXEnabled;
+    (void)AVX512Enabled;
     (void)have_sse4;
     (void)have_avx;
     (void)have_xsave;
     (void)have_avx2;
+    (void)have_avx512;
     (void)have_shani;
     (void)enabled_avx;
+    (void)enabled_avx512;
 
     uint32_t eax, ebx, ecx, edx;
     GetCPUID(1, 0, eax, ebx, ecx, edx);
@@ -589,8 +620,12 @@ std::string SHA256AutoDetect()
     if (have_sse4) {
         GetCPUID(7, 0, eax, ebx, ecx, edx);
         have_avx2 = (ebx >> 5) & 1;
+        have_avx512 = (ebx >> 16) & 1;
         have_shani = (ebx >> 29) & 1;
     }
+    if (have_avx512 && enabled_avx) {
+        enabled_avx512 = AVX512Enabled();
+    }
 
 #if defined(ENABLE_SHANI) && !defined(BUILD_BITCOIN_INTERNAL)
     if (have_shani) {
@@ -621,6 +656,15 @@ std::string SHA256AutoDetect()
         ret += ",avx2(8way)";
     }
 #endif
+
+    // Unlike AVX2, the 16-way code is kept alongside SHA-NI: for batches of 16
+    // or more it outperforms the 2-way SHA-NI code on CPUs that have both.
+#if defined(ENABLE_AVX512) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx512 && enabled_avx512) {
+        TransformD64_16way = sha256d64_avx512::Transform_16way;
+        ret += ",avx512(16way)";
+    }
+#endif
 #endif
 
     assert(SelfTest());
@@ -686,6 +730,14 @@ CSHA256& CSHA256::Reset()
 
 void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
 {
+    if (TransformD64_16way) {
+        while (blocks >= 16) {
+            TransformD64_16way(out, in);
+            out += 512;
+            in += 1024;
+            blocks -= 16;
+        }
+    }
     if (TransformD64_8way) {
         while (blocks >= 8) {
             TransformD64_8way(out, in);
@@ -717,3 +769,38 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+void SHA256D(unsigned char* out, const unsigned char* in, size_t size, size_t count)
+{
+    if (size == 64) {
+        SHA256D64(out, in, count);
+        return;
+    }
+
+    // The padding only depends on the size, so it is laid out once for all inputs.
+    const size_t full = size / 64;
+    const size_t rem = size % 64;
+    const size_t tail_blocks = rem + 9 > 64 ? 2 : 1;
+    unsigned char tail[128] = {0};
+    tail[rem] = 0x80;
+    WriteBE64(tail + 64 * tail_blocks - 8, (uint64_t)size << 3);
+    // The second hash always covers a single 32-byte digest.
+    unsigned char outer[64] = {0};
+    outer[32] = 0x80;
+    WriteBE64(outer + 56, 256);
+
+    uint32_t s[8];
+    while (count) {
+        sha256::Initialize(s);
+        if (full) Transform(s, in, full);
+        std::copy(in + 64 * full, in + size, tail);
+        Transform(s, tail, tail_blocks);
+        for (int i = 0; i < 8; ++i) WriteBE32(outer + 4 * i, s[i]);
+        sha256::Initialize(s);
+        Transform(s, outer, 1);
+        for (int i = 0; i < 8; ++i) WriteBE32(out + 4 * i, s[i]);
+        out += 32;
+        in += size;
+        --count;
+    }
+}
@@ -38,4 +38,14 @@ std::string SHA256AutoDetect();
  */
 void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
+/** Compute multiple double-SHA256's of equally sized blobs, such as stake
+ *  kernels. 64-byte blobs use the multi-way SHA256D64 code; other sizes skip
+ *  the buffering done by CSHA256.
+ *  output:  pointer to a count*32 byte output buffer
+ *  input:   pointer to a count*size byte input buffer
+ *  size:    the size of each blob.
+ *  count:   the number of hashes to compute.
+ */
+void SHA256D(unsigned char* output, const unsigned char* input, size_t size, size_t count);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
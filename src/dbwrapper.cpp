@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <random.h>
+#include <sync.h>
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
@@ -13,6 +14,7 @@
 #include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
+#include <sstream>
 
 class CBitcoinLevelDBLogger : public leveldb::Logger {
 public:
@@ -97,12 +99,54 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+bool ParseDBOption(const std::string& arg, std::string& db_name, std::string& option, int64_t& value)
+{
+    size_t colon = arg.find(':');
+    size_t equals = arg.find('=', colon);
+    if (colon == std::string::npos || colon == 0 || equals == std::string::npos) {
+        return false;
+    }
+    db_name = arg.substr(0, colon);
+    option = arg.substr(colon + 1, equals - colon - 1);
+    if (!ParseInt64(arg.substr(equals + 1), &value) || value < 0) {
+        return false;
+    }
+    if (option == "cache" || option == "writebuffer") {
+        return (uint64_t)value <= std::numeric_limits<size_t>::max() >> 20;
+    }
+    if (option == "bloombits") {
+        return value <= MAX_DB_BLOOM_BITS;
+    }
+    return false;
+}
+
+DBOptions GetDBOptions(const std::string& db_name, size_t cache_size)
+{
+    DBOptions db_options;
+    db_options.cache_size = cache_size;
+    for (const std::string& arg : gArgs.GetArgs("-dboption")) {
+        std::string name, option;
+        int64_t value;
+        // Values are checked at startup, so anything invalid can be skipped
+        if (!ParseDBOption(arg, name, option, value) || name != db_name) continue;
+        if (option == "cache") {
+            db_options.cache_size = (size_t)value << 20;
+        } else if (option == "writebuffer") {
+            db_options.write_buffer_size = (size_t)value << 20;
+        } else if (option == "bloombits") {
+            db_options.bloom_bits = value;
+        }
+    }
+    return db_options;
+}
+
+leveldb::Options MakeLevelDBOptions(const DBOptions& db_options)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    options.block_cache = leveldb::NewLRUCache(db_options.cache_size / 2);
+    // up to two write buffers may be held in memory simultaneously
+    options.write_buffer_size = db_options.write_buffer_size ? db_options.write_buffer_size : db_options.cache_size / 4;
+    options.filter_policy = db_options.bloom_bits > 0 ? leveldb::NewBloomFilterPolicy(db_options.bloom_bits) : nullptr;
     options.compression = leveldb::kNoCompression;
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
@@ -114,15 +158,83 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
-    : m_name{path.stem().string()}
+namespace {
+
+struct RegisteredDB {
+    std::string name;
+    const leveldb::DB* db;
+    DBOptions options;
+};
+
+Mutex g_registered_dbs_mutex;
+std::vector<RegisteredDB> g_registered_dbs GUARDED_BY(g_registered_dbs_mutex);
+
+DBStats ReadDBStats(const RegisteredDB& registered)
+{
+    leveldb::DB* db = const_cast<leveldb::DB*>(registered.db);
+    DBStats stats;
+    stats.name = registered.name;
+    stats.options = registered.options;
+
+    std::string value;
+    if (db->GetProperty("leveldb.approximate-memory-usage", &value)) {
+        stats.memory_usage = atoi64(value);
+    }
+
+    // One line per level after a three line header, see DBImpl::GetProperty
+    if (db->GetProperty("leveldb.stats", &value)) {
+        std::istringstream lines(value);
+        std::string line;
+        for (int header = 0; header < 3 && std::getline(lines, line); ++header) {}
+        while (std::getline(lines, line)) {
+            DBStats::Level level;
+            std::istringstream fields(line);
+            if (fields >> level.level >> level.files >> level.size_mb >> level.compaction_sec >> level.compaction_read_mb >> level.compaction_write_mb) {
+                stats.levels.push_back(level);
+                stats.read_amplification += level.level == 0 ? level.files : (level.files > 0 ? 1 : 0);
+            }
+        }
+    }
+    return stats;
+}
+
+} // namespace
+
+void RegisterDBStats(const std::string& db_name, leveldb::DB* db, const DBOptions& db_options)
+{
+    LOCK(g_registered_dbs_mutex);
+    g_registered_dbs.push_back({db_name, db, db_options});
+}
+
+void UnregisterDBStats(const leveldb::DB* db)
+{
+    LOCK(g_registered_dbs_mutex);
+    g_registered_dbs.erase(std::remove_if(g_registered_dbs.begin(), g_registered_dbs.end(),
+                                          [db](const RegisteredDB& registered) { return registered.db == db; }),
+                           g_registered_dbs.end());
+}
+
+std::vector<DBStats> GetDBStats()
+{
+    // Databases cannot be closed while their stats are read
+    LOCK(g_registered_dbs_mutex);
+    std::vector<DBStats> result;
+    for (const RegisteredDB& registered : g_registered_dbs) {
+        result.push_back(ReadDBStats(registered));
+    }
+    return result;
+}
+
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate, const std::string& name)
+    : m_name{name.empty() ? path.stem().string() : name}
 {
     penv = nullptr;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    m_db_options = GetDBOptions(m_name, nCacheSize);
+    options = MakeLevelDBOptions(m_db_options);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -139,6 +251,7 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
+    RegisterDBStats(m_name, pdb, m_db_options);
 
     if (gArgs.GetBoolArg("-forcecompactdb", false)) {
         LogPrintf("Starting database compaction of %s\n", path.string());
@@ -168,6 +281,7 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
 
 CDBWrapper::~CDBWrapper()
 {
+    UnregisterDBStats(pdb);
     delete pdb;
     pdb = nullptr;
     delete options.filter_policy;
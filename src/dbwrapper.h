@@ -13,11 +13,73 @@
 #include <util/strencodings.h>
 
 #include <leveldb/db.h>
+#include <leveldb/options.h>
 #include <leveldb/write_batch.h>
 
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
+//! Default bits per key of the LevelDB bloom filters
+static const int DEFAULT_DB_BLOOM_BITS = 10;
+//! Maximum -dboption=<db>:bloombits
+static const int MAX_DB_BLOOM_BITS = 64;
+
+/** LevelDB settings of one database */
+struct DBOptions {
+    //! Split between the block cache and the write buffers
+    size_t cache_size{0};
+    //! Bits per key of the bloom filter policy, or 0 for none
+    int bloom_bits{DEFAULT_DB_BLOOM_BITS};
+    //! Size of each write buffer, or 0 for a quarter of cache_size
+    size_t write_buffer_size{0};
+};
+
+/**
+ * Parse a -dboption value of the form <db>:<option>=<value>, where option is
+ * cache or writebuffer (in MiB), or bloombits.
+ */
+bool ParseDBOption(const std::string& arg, std::string& db_name, std::string& option, int64_t& value);
+
+/**
+ * The options of the database with the given name: the defaults for the
+ * given cache size, with the -dboption settings for that name applied.
+ */
+DBOptions GetDBOptions(const std::string& db_name, size_t cache_size);
+
+/** LevelDB settings built from DBOptions. The caller owns the cache, filter policy and logger. */
+leveldb::Options MakeLevelDBOptions(const DBOptions& db_options);
+
+/** What LevelDB reports about one open database */
+struct DBStats {
+    struct Level {
+        int level;
+        int files;
+        double size_mb;
+        //! Time spent compacting into this level, and the data read and written by it
+        double compaction_sec;
+        double compaction_read_mb;
+        double compaction_write_mb;
+    };
+
+    std::string name;
+    DBOptions options;
+    //! Block cache and memtable usage
+    size_t memory_usage{0};
+    //! Levels that have files or have been compacted into
+    std::vector<Level> levels;
+    //! Most tables a lookup may have to search: every level 0 file and one
+    //! table of each deeper level that has any
+    int read_amplification{0};
+};
+
+/**
+ * Databases that have been registered are listed by GetDBStats. A database
+ * must be unregistered before it is closed.
+ */
+void RegisterDBStats(const std::string& db_name, leveldb::DB* db, const DBOptions& db_options);
+void UnregisterDBStats(const leveldb::DB* db);
+std::vector<DBStats> GetDBStats();
+
 class dbwrapper_error : public std::runtime_error
 {
 public:
@@ -200,6 +262,9 @@ private:
     //! the name of this database
     std::string m_name;
 
+    //! the settings the database was opened with
+    DBOptions m_db_options;
+
     //! a key used for optional XOR-obfuscation of the database
     std::vector<unsigned char> obfuscate_key;
 
@@ -219,8 +284,10 @@ public:
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
      *                        with a zero'd byte array.
+     * @param[in] name        Name of the database in -dboption and getdbinfo. Defaults to
+     *                        the last component of path.
      */
-    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false, const std::string& name = "");
     ~CDBWrapper();
 
     CDBWrapper(const CDBWrapper&) = delete;
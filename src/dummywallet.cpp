@@ -38,6 +38,7 @@ void DummyWalletInit::AddWalletOptions() const
         "-mintxfee=<amt>",
         "-paytxfee=<amt>",
         "-rescan",
+        "-rescanthreads=<n>",
         "-salvagewallet",
         "-spendzeroconfchange",
         "-txconfirmtarget=<n>",
@@ -48,6 +49,7 @@ void DummyWalletInit::AddWalletOptions() const
         "-walletnotify=<cmd>",
         "-walletrbf",
         "-zapwallettxes=<mode>",
+        "-checkwalletbalance",
         "-dblogsize=<n>",
         "-flushwallet",
         "-privdb",
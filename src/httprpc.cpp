@@ -72,6 +72,8 @@ static std::unique_ptr<HTTPRPCTimerInterface> httpRPCTimerInterface;
 /* RPC Auth Whitelist */
 static std::map<std::string, std::set<std::string>> g_rpc_whitelist;
 static bool g_rpc_whitelist_default = false;
+/* Maximum number of worker threads one batch request is executed on */
+static int g_rpc_batch_threads = DEFAULT_HTTP_BATCH_THREADS;
 
 static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const UniValue& id)
 {
@@ -96,6 +98,16 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     }
 }
 
+static void AbortStreamedReply(HTTPRequest* req, const std::string& error)
+{
+    // Part of the result has already been sent, so there is no way to turn
+    // this into an error reply. End the transfer with the document left
+    // unterminated: the client fails to parse it instead of taking a
+    // truncated result for a complete one.
+    LogPrintf("ThreadRPCServer: error after the reply started streaming, closing it unfinished: %s\n", error);
+    req->ChunkEnd();
+}
+
 //This function checks username and password against -rpcauth
 //entries from config file.
 static bool multiUserAuthorized(std::string strUserPass)
@@ -187,6 +199,8 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         return false;
     }
 
+    // Set once part of the reply may have been streamed to the client.
+    std::shared_ptr<JSONStreamWriter> stream;
     try {
         // Parse request
         UniValue valRequest;
@@ -211,6 +225,20 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
                 req->WriteReply(HTTP_FORBIDDEN);
                 return false;
             }
+
+            // Large results may be written out while they are being produced,
+            // as a chunked reply of the usual shape.
+            stream = std::make_shared<JSONStreamWriter>([req](const std::string& chunk) {
+                if (!req->isChunkMode()) {
+                    req->WriteHeader("Content-Type", "application/json");
+                    req->WriteHeader("Connection", "close");
+                }
+                req->Chunk(chunk);
+            });
+            stream->BeginObject();
+            stream->Key("result");
+            jreq.resultStream = stream;
+
             UniValue result = tableRPC.execute(jreq);
 
             if (jreq.isLongPolling) {
@@ -218,6 +246,22 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
                 return true;
             }
 
+            if (!stream->AwaitingValue()) {
+                // The handler wrote the result to the stream
+                stream->Pair("error", NullUniValue);
+                stream->Pair("id", jreq.id);
+                stream->EndObject();
+                if (!stream->IsCommitted()) {
+                    req->WriteHeader("Content-Type", "application/json");
+                    req->WriteReply(HTTP_OK, stream->TakeBuffered() + "\n");
+                    return true;
+                }
+                stream->Flush();
+                req->Chunk("\n");
+                req->ChunkEnd();
+                return true;
+            }
+
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
 
@@ -239,7 +283,7 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
                     }
                 }
             }
-            strReply = JSONRPCExecBatch(jreq, valRequest.get_array());
+            strReply = JSONRPCExecBatch(jreq, valRequest.get_array(), g_rpc_batch_threads, HTTPRunAsync);
         }
         else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
@@ -247,10 +291,18 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strReply);
     } catch (const UniValue& objError) {
-        JSONErrorReply(req, objError, jreq.id);
+        if (stream && stream->IsCommitted()) {
+            AbortStreamedReply(req, objError.write());
+        } else {
+            JSONErrorReply(req, objError, jreq.id);
+        }
         return false;
     } catch (const std::exception& e) {
-        JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        if (stream && stream->IsCommitted()) {
+            AbortStreamedReply(req, e.what());
+        } else {
+            JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        }
         return false;
     }
     return true;
@@ -304,6 +356,7 @@ bool StartHTTPRPC()
     LogPrint(BCLog::RPC, "Starting HTTP RPC server\n");
     if (!InitRPCAuthentication())
         return false;
+    g_rpc_batch_threads = std::max((int)gArgs.GetArg("-rpcbatchthreads", DEFAULT_HTTP_BATCH_THREADS), 1);
 
     RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
     if (g_wallet_init_interface.HasWalletSupport()) {
@@ -63,6 +63,22 @@ private:
     HTTPRequestHandler func;
 };
 
+/** Work item that runs a task on behalf of a request already being handled */
+class HTTPTaskItem final : public HTTPClosure
+{
+public:
+    explicit HTTPTaskItem(std::function<void()> _task) : task(std::move(_task))
+    {
+    }
+    void operator()() override
+    {
+        task();
+    }
+
+private:
+    std::function<void()> task;
+};
+
 /** Simple work queue for distributing work over multiple threads.
  * Work items are simply callable objects.
  */
@@ -748,6 +764,15 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod() const
     }
 }
 
+bool HTTPRunAsync(std::function<void()> task)
+{
+    if (!workQueue) return false;
+    std::unique_ptr<HTTPTaskItem> item(new HTTPTaskItem(std::move(task)));
+    if (!workQueue->Enqueue(item.get())) return false;
+    item.release(); /* queue took ownership */
+    return true;
+}
+
 void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
 {
     LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
@@ -13,6 +13,7 @@
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
+static const int DEFAULT_HTTP_BATCH_THREADS=1;
 
 struct evhttp_request;
 struct event_base;
@@ -52,6 +53,11 @@ void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
  */
 struct event_base* EventBase();
 
+/** Queue a task to be run by one of the HTTP worker threads.
+ * Returns false if the server is not running or the work queue is full.
+ */
+bool HTTPRunAsync(std::function<void()> task);
+
 /** In-flight HTTP request.
  * Thin C++ wrapper around evhttp_request.
  */
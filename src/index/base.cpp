@@ -11,6 +11,11 @@
 #include <validation.h>
 #include <warnings.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
 constexpr char DB_BEST_BLOCK = 'B';
 
 constexpr int64_t SYNC_LOG_INTERVAL = 30; // seconds
@@ -28,8 +33,136 @@ static void FatalError(const char* fmt, const Args&... args)
     StartShutdown();
 }
 
-BaseIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe, bool f_obfuscate) :
-    CDBWrapper(path, n_cache_size, f_memory, f_wipe, f_obfuscate)
+/**
+ * Blocks on their way to the index sync thread. Blocks are pushed in chain
+ * order, read from disk and prepared by worker threads in any order, and
+ * popped in the order they were pushed. Without workers, Pop reads and
+ * prepares the block itself.
+ */
+class BaseIndex::BlockReadAhead
+{
+private:
+    struct Item {
+        const CBlockIndex* pindex;
+        CBlock block;
+        std::unique_ptr<BlockData> data;
+        bool claimed{false};
+        bool done{false};
+        bool ok{false};
+
+        explicit Item(const CBlockIndex* pindex_in) : pindex(pindex_in) {}
+    };
+
+    const BaseIndex& m_index;
+    const Consensus::Params& m_consensus_params;
+    Mutex m_mutex;
+    std::condition_variable m_cv_work;
+    std::condition_variable m_cv_done;
+    std::deque<std::shared_ptr<Item>> m_items GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+
+    void Process(Item& item) const
+    {
+        item.ok = ReadBlockFromDisk(item.block, item.pindex, m_consensus_params);
+        if (item.ok) item.data = m_index.PrepareBlock(item.block, item.pindex);
+    }
+
+    void ThreadWork()
+    {
+        while (true) {
+            std::shared_ptr<Item> item;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cv_work.wait(lock, [&] {
+                    if (m_stop) return true;
+                    for (const auto& queued : m_items) {
+                        if (!queued->claimed) {
+                            item = queued;
+                            return true;
+                        }
+                    }
+                    return false;
+                });
+                if (m_stop) return;
+                item->claimed = true;
+            }
+            Process(*item);
+            {
+                LOCK(m_mutex);
+                item->done = true;
+            }
+            m_cv_done.notify_all();
+        }
+    }
+
+public:
+    BlockReadAhead(const BaseIndex& index, int threads)
+        : m_index(index), m_consensus_params(Params().GetConsensus())
+    {
+        threads = std::min(threads, MAX_INDEX_THREADS);
+        for (int i = 0; i < threads; ++i) {
+            m_threads.emplace_back(&TraceThread<std::function<void()>>, "indexread", std::bind(&BlockReadAhead::ThreadWork, this));
+        }
+    }
+
+    ~BlockReadAhead()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_cv_work.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    /// Number of blocks to keep on their way.
+    size_t Capacity() const { return std::max<size_t>(1, m_threads.size() * INDEX_READ_AHEAD_PER_THREAD); }
+
+    size_t Size()
+    {
+        LOCK(m_mutex);
+        return m_items.size();
+    }
+
+    void Push(const CBlockIndex* pindex)
+    {
+        {
+            LOCK(m_mutex);
+            m_items.push_back(std::make_shared<Item>(pindex));
+        }
+        m_cv_work.notify_one();
+    }
+
+    /// Take the oldest block once it has been read and prepared. Returns false
+    /// if it could not be read from disk.
+    bool Pop(const CBlockIndex*& pindex, CBlock& block, std::unique_ptr<BlockData>& data)
+    {
+        std::shared_ptr<Item> item;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            assert(!m_items.empty());
+            item = m_items.front();
+            m_items.pop_front();
+            if (item->claimed) {
+                m_cv_done.wait(lock, [&] { return item->done; });
+            } else {
+                item->claimed = true;
+            }
+        }
+        if (!item->done) Process(*item);
+
+        pindex = item->pindex;
+        block = std::move(item->block);
+        data = std::move(item->data);
+        return item->ok;
+    }
+};
+
+BaseIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe, bool f_obfuscate, const std::string& name) :
+    CDBWrapper(path, n_cache_size, f_memory, f_wipe, f_obfuscate, name)
 {}
 
 bool BaseIndex::DB::ReadBestBlock(CBlockLocator& locator) const
@@ -89,7 +222,10 @@ void BaseIndex::ThreadSync()
 {
     const CBlockIndex* pindex = m_best_block_index.load();
     if (!m_synced) {
-        auto& consensus_params = Params().GetConsensus();
+        BlockReadAhead read_ahead(*this, gArgs.GetArg("-indexthreads", DEFAULT_INDEX_THREADS));
+        // The last block handed to read_ahead. Blocks on their way always
+        // continue the chain from pindex up to pindex_queued.
+        const CBlockIndex* pindex_queued = pindex;
 
         int64_t last_log_time = 0;
         int64_t last_locator_write_time = 0;
@@ -105,20 +241,45 @@ void BaseIndex::ThreadSync()
 
             {
                 LOCK(cs_main);
-                const CBlockIndex* pindex_next = NextSyncBlock(pindex);
-                if (!pindex_next) {
-                    m_best_block_index = pindex;
-                    m_synced = true;
-                    // No need to handle errors in Commit. See rationale above.
-                    Commit();
-                    break;
+                while (read_ahead.Size() < read_ahead.Capacity()) {
+                    const CBlockIndex* pindex_next = NextSyncBlock(pindex_queued);
+                    // Stop at a reorg; it is handled once the blocks before it are written.
+                    if (!pindex_next || pindex_next->pprev != pindex_queued) break;
+                    read_ahead.Push(pindex_next);
+                    pindex_queued = pindex_next;
                 }
-                if (pindex_next->pprev != pindex && !Rewind(pindex, pindex_next->pprev)) {
-                    FatalError("%s: Failed to rewind index %s to a previous chain tip",
-                               __func__, GetName());
-                    return;
+
+                if (read_ahead.Size() == 0) {
+                    const CBlockIndex* pindex_next = NextSyncBlock(pindex);
+                    if (!pindex_next) {
+                        m_best_block_index = pindex;
+                        m_synced = true;
+                        // No need to handle errors in Commit. See rationale above.
+                        Commit();
+                        break;
+                    }
+                    if (pindex_next->pprev != pindex && !Rewind(pindex, pindex_next->pprev)) {
+                        FatalError("%s: Failed to rewind index %s to a previous chain tip",
+                                   __func__, GetName());
+                        return;
+                    }
+                    pindex = pindex_next->pprev;
+                    pindex_queued = pindex;
+                    continue;
                 }
-                pindex = pindex_next;
+            }
+
+            CBlock block;
+            std::unique_ptr<BlockData> data;
+            if (!read_ahead.Pop(pindex, block, data)) {
+                FatalError("%s: Failed to read block %s from disk",
+                           __func__, pindex->GetBlockHash().ToString());
+                return;
+            }
+            if (!WritePreparedBlock(block, pindex, std::move(data))) {
+                FatalError("%s: Failed to write block %s to index database",
+                           __func__, pindex->GetBlockHash().ToString());
+                return;
             }
 
             int64_t current_time = GetTime();
@@ -134,18 +295,6 @@ void BaseIndex::ThreadSync()
                 // No need to handle errors in Commit. See rationale above.
                 Commit();
             }
-
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
-                FatalError("%s: Failed to read block %s from disk",
-                           __func__, pindex->GetBlockHash().ToString());
-                return;
-            }
-            if (!WriteBlock(block, pindex)) {
-                FatalError("%s: Failed to write block %s to index database",
-                           __func__, pindex->GetBlockHash().ToString());
-                return;
-            }
         }
     }
 
@@ -221,7 +370,7 @@ void BaseIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const
         }
     }
 
-    if (WriteBlock(*block, pindex)) {
+    if (WritePreparedBlock(*block, pindex, PrepareBlock(*block, pindex))) {
         m_best_block_index = pindex;
     } else {
         FatalError("%s: Failed to write block %s to index",
@@ -320,3 +469,13 @@ void BaseIndex::Stop()
         m_thread_sync.join();
     }
 }
+
+IndexSummary BaseIndex::GetSummary() const
+{
+    IndexSummary summary{};
+    summary.name = GetName();
+    summary.synced = m_synced;
+    const CBlockIndex* best_block_index = m_best_block_index.load();
+    summary.best_block_height = best_block_index ? best_block_index->nHeight : 0;
+    return summary;
+}
@@ -11,8 +11,24 @@
 #include <threadinterrupt.h>
 #include <validationinterface.h>
 
+#include <memory>
+#include <string>
+
 class CBlockIndex;
 
+struct IndexSummary {
+    std::string name;
+    bool synced{false};
+    int best_block_height{0};
+};
+
+//! -indexthreads default
+static const int DEFAULT_INDEX_THREADS = 4;
+//! Maximum number of -indexthreads
+static const int MAX_INDEX_THREADS = 16;
+//! Number of blocks read ahead of the index sync thread per -indexthreads worker
+static const int INDEX_READ_AHEAD_PER_THREAD = 2;
+
 /**
  * Base class for indices of blockchain data. This implements
  * CValidationInterface and ensures blocks are indexed sequentially according
@@ -25,7 +41,7 @@ protected:
     {
     public:
         DB(const fs::path& path, size_t n_cache_size,
-           bool f_memory = false, bool f_wipe = false, bool f_obfuscate = false);
+           bool f_memory = false, bool f_wipe = false, bool f_obfuscate = false, const std::string& name = "");
 
         /// Read block locator of the chain that the txindex is in sync with.
         bool ReadBestBlock(CBlockLocator& locator) const;
@@ -34,7 +50,18 @@ protected:
         void WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator);
     };
 
+public:
+    /// Data about a block that an index computes in PrepareBlock and writes in
+    /// WritePreparedBlock.
+    class BlockData
+    {
+    public:
+        virtual ~BlockData() {}
+    };
+
 private:
+    class BlockReadAhead;
+
     /// Whether the index is in sync with the main chain. The flag is flipped
     /// from false to true once, after which point this starts processing
     /// ValidationInterface notifications to stay in sync.
@@ -50,7 +77,8 @@ private:
     /// Intended to be run in its own thread, m_thread_sync, and can be
     /// interrupted with m_interrupt. Once the index gets in sync, the m_synced
     /// flag is set and the BlockConnected ValidationInterface callback takes
-    /// over and the sync thread exits.
+    /// over and the sync thread exits. Blocks are read and prepared ahead by
+    /// -indexthreads workers and written in chain order by this thread.
     void ThreadSync();
 
     /// Write the current index state (eg. chain block locator and subclass-specific items) to disk.
@@ -74,6 +102,19 @@ protected:
     /// Write update index entries for a newly connected block.
     virtual bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) { return true; }
 
+    /// Compute the part of the index entries for a block that does not depend
+    /// on earlier blocks. During the initial sync this runs on the
+    /// -indexthreads workers for several blocks at once, ahead of
+    /// WritePreparedBlock, so it must not use or change index state.
+    virtual std::unique_ptr<BlockData> PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const { return nullptr; }
+
+    /// Write update index entries for a block, given what PrepareBlock
+    /// computed for it. Blocks are written one at a time in chain order.
+    virtual bool WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex, std::unique_ptr<BlockData> data)
+    {
+        return WriteBlock(block, pindex);
+    }
+
     /// Virtual method called internally by Commit that can be overridden to atomically
     /// commit more index state.
     virtual bool CommitInternal(CDBBatch& batch);
@@ -106,6 +147,9 @@ public:
 
     /// Stops the instance from staying in sync with blockchain updates.
     void Stop();
+
+    /// Get a summary of the index and its state.
+    IndexSummary GetSummary() const;
 };
 
 #endif // BITCOIN_INDEX_BASE_H
@@ -6,6 +6,7 @@
 
 #include <dbwrapper.h>
 #include <index/blockfilterindex.h>
+#include <util/convert.h>
 #include <util/system.h>
 #include <validation.h>
 
@@ -107,7 +108,7 @@ BlockFilterIndex::BlockFilterIndex(BlockFilterType filter_type,
     fs::create_directories(path);
 
     m_name = filter_name + " block filter index";
-    m_db = MakeUnique<BaseIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe);
+    m_db = MakeUnique<BaseIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe, false, "blockfilter/" + filter_name);
     m_filter_fileseq = MakeUnique<FlatFileSeq>(std::move(path), "fltr", FLTR_FILE_CHUNK_SIZE);
 }
 
@@ -212,16 +213,67 @@ size_t BlockFilterIndex::WriteFilterToDisk(FlatFilePos& pos, const BlockFilter&
     return data_size;
 }
 
-bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+namespace {
+
+/** A block's filter, built ahead of writing it */
+class FilterData : public BaseIndex::BlockData
+{
+public:
+    BlockFilter filter;
+
+    explicit FilterData(BlockFilter&& filter_in) : filter(std::move(filter_in)) {}
+};
+
+} // namespace
+
+GCSFilter::ElementSet ContractFilterElements(const CBlock& block)
+{
+    GCSFilter::ElementSet elements;
+    const uint256 block_hash = block.GetHash();
+    std::vector<TransactionReceiptInfo> receipts;
+    for (const CTransactionRef& tx : block.vtx) {
+        if (!tx->HasCreateOrCall()) continue;
+        receipts.clear();
+        pstorageresult->readCommittedResult(uintToh256(tx->GetHash()), receipts);
+
+        for (const TransactionReceiptInfo& receipt : receipts) {
+            // Receipts from other blocks the transaction was mined in do not belong in this filter.
+            if (receipt.blockHash != block_hash) continue;
+            if (receipt.contractAddress != dev::Address()) {
+                elements.emplace(receipt.contractAddress.begin(), receipt.contractAddress.end());
+            }
+            for (const dev::eth::LogEntry& log : receipt.logs) {
+                elements.emplace(log.address.begin(), log.address.end());
+                for (const dev::h256& topic : log.topics) {
+                    elements.emplace(topic.begin(), topic.end());
+                }
+            }
+        }
+    }
+    return elements;
+}
+
+std::unique_ptr<BaseIndex::BlockData> BlockFilterIndex::PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const
 {
+    if (m_filter_type == BlockFilterType::CONTRACT) {
+        return MakeUnique<FilterData>(BlockFilter(m_filter_type, block.GetHash(), ContractFilterElements(block)));
+    }
+
     CBlockUndo block_undo;
+    if (pindex->nHeight > 0 && !UndoReadFromDisk(block_undo, pindex)) {
+        return nullptr;
+    }
+    return MakeUnique<FilterData>(BlockFilter(m_filter_type, block, block_undo));
+}
+
+bool BlockFilterIndex::WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex, std::unique_ptr<BlockData> data)
+{
+    // Without data, the undo data of the block could not be read.
+    if (!data) return false;
+    const FilterData& filter_data = static_cast<const FilterData&>(*data);
     uint256 prev_header;
 
     if (pindex->nHeight > 0) {
-        if (!UndoReadFromDisk(block_undo, pindex)) {
-            return false;
-        }
-
         std::pair<uint256, DBVal> read_out;
         if (!m_db->Read(DBHeightKey(pindex->nHeight - 1), read_out)) {
             return false;
@@ -236,15 +288,13 @@ bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex
         prev_header = read_out.second.header;
     }
 
-    BlockFilter filter(m_filter_type, block, block_undo);
-
-    size_t bytes_written = WriteFilterToDisk(m_next_filter_pos, filter);
+    size_t bytes_written = WriteFilterToDisk(m_next_filter_pos, filter_data.filter);
     if (bytes_written == 0) return false;
 
     std::pair<uint256, DBVal> value;
     value.first = pindex->GetBlockHash();
-    value.second.hash = filter.GetHash();
-    value.second.header = filter.ComputeHeader(prev_header);
+    value.second.hash = filter_data.filter.GetHash();
+    value.second.header = filter_data.filter.ComputeHeader(prev_header);
     value.second.pos = m_next_filter_pos;
 
     if (!m_db->Write(DBHeightKey(pindex->nHeight), value)) {
@@ -35,7 +35,9 @@ protected:
 
     bool CommitInternal(CDBBatch& batch) override;
 
-    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+    std::unique_ptr<BlockData> PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const override;
+
+    bool WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex, std::unique_ptr<BlockData> data) override;
 
     bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
 
@@ -65,6 +67,14 @@ public:
                                std::vector<uint256>& hashes_out) const;
 };
 
+/**
+ * Get the elements of the CONTRACT filter of a block: the addresses of the
+ * contracts its transactions created or called, and the addresses and topics
+ * of their logs. Read from the receipt database, so requires -logevents.
+ * Addresses and topics are in the byte order of their hex in RPC results.
+ */
+GCSFilter::ElementSet ContractFilterElements(const CBlock& block);
+
 /**
  * Get a block filter index by type. Returns nullptr if index has not been initialized or was
  * already destroyed.
@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <chainparams.h>
 #include <index/txindex.h>
 #include <shutdown.h>
 #include <ui_interface.h>
@@ -203,7 +204,13 @@ TxIndex::TxIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
     : m_db(MakeUnique<TxIndex::DB>(n_cache_size, f_memory, f_wipe))
 {}
 
-TxIndex::~TxIndex() {}
+TxIndex::~TxIndex()
+{
+    m_filter_interrupt();
+    if (m_filter_thread.joinable()) {
+        m_filter_thread.join();
+    }
+}
 
 bool TxIndex::Init()
 {
@@ -216,30 +223,143 @@ bool TxIndex::Init()
         return false;
     }
 
-    return BaseIndex::Init();
+    // The filter is rebuilt on every start rather than stored, as a stored
+    // filter that missed the last blocks written before a crash would hide
+    // transactions. It is created before BaseIndex::Init lets blocks be
+    // written, so every txid is either in the database snapshot the build
+    // thread reads or inserted by WritePreparedBlock. It is sized for the
+    // whole chain as far as it is known, so that it does not fill up while
+    // the index syncs during IBD.
+    bool build_filter = false;
+    if (gArgs.GetBoolArg("-txindexfilter", DEFAULT_TXINDEX_FILTER)) {
+        LOCK(m_filter_mutex);
+        if (!m_filter && !m_next_filter) {
+            const CBlockIndex* tip = ::ChainActive().Tip();
+            uint64_t expected = std::max<uint64_t>(tip ? tip->nChainTx : 0, Params().TxData().nTxCount);
+            const int64_t size_override = gArgs.GetArg("-txindexfiltersize", 0);
+            expected = size_override > 0 ? size_override : expected * 3 / 2 + TXINDEX_FILTER_HEADROOM;
+            m_next_filter = std::make_shared<CBlockedBloomFilter>(expected, TXINDEX_FILTER_FP_RATE);
+            build_filter = true;
+        }
+    }
+
+    if (!BaseIndex::Init()) {
+        return false;
+    }
+
+    if (build_filter && !m_filter_thread.joinable()) {
+        m_filter_thread = std::thread(&TraceThread<std::function<void()>>, "txindexfilter",
+                                      std::bind(&TxIndex::ThreadBuildFilter, this));
+    }
+    return true;
 }
 
-bool TxIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+void TxIndex::ThreadBuildFilter()
 {
+    int64_t start = GetTimeMillis();
+    const std::shared_ptr<CBlockedBloomFilter> filter = WITH_LOCK(m_filter_mutex, return m_next_filter);
+    std::unique_ptr<CDBIterator> cursor(m_db->NewIterator());
+    std::pair<unsigned char, uint256> key;
+    uint64_t count = 0;
+    for (cursor->Seek(std::make_pair(DB_TXINDEX, uint256())); cursor->Valid(); cursor->Next()) {
+        if (!cursor->GetKey(key) || key.first != DB_TXINDEX) {
+            break;
+        }
+        filter->insert(key.second);
+        if (++count % 10000 == 0 && (m_filter_interrupt || ShutdownRequested())) {
+            LogPrintf("%s: txindex lookup filter build interrupted\n", __func__);
+            return;
+        }
+    }
+    {
+        LOCK(m_filter_mutex);
+        m_filter = filter;
+        m_next_filter.reset();
+    }
+    LogPrintf("txindex lookup filter built from %u transactions in %dms, using %u bytes\n",
+              count, GetTimeMillis() - start, filter->DynamicMemoryUsage());
+}
+
+namespace {
+
+/** The disk positions of a block's transactions */
+class TxPosData : public BaseIndex::BlockData
+{
+public:
+    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
+};
+
+} // namespace
+
+std::unique_ptr<BaseIndex::BlockData> TxIndex::PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const
+{
+    auto data = MakeUnique<TxPosData>();
+
     // Exclude genesis block transaction because outputs are not spendable.
-    if (pindex->nHeight == 0) return true;
+    if (pindex->nHeight == 0) return data;
 
     CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
-    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
-    vPos.reserve(block.vtx.size());
+    data->vPos.reserve(block.vtx.size());
     for (const auto& tx : block.vtx) {
-        vPos.emplace_back(tx->GetHash(), pos);
+        data->vPos.emplace_back(tx->GetHash(), pos);
         pos.nTxOffset += ::GetSerializeSize(*tx, CLIENT_VERSION);
     }
-    return m_db->WriteTxs(vPos);
+    return data;
+}
+
+bool TxIndex::WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex, std::unique_ptr<BlockData> data)
+{
+    const TxPosData& pos_data = static_cast<const TxPosData&>(*data);
+    if (pos_data.vPos.empty()) return true;
+    // Insert before writing, so a transaction that FindTx can read is never
+    // filtered out.
+    std::shared_ptr<CBlockedBloomFilter> filter, next_filter;
+    bool rebuild = false;
+    {
+        LOCK(m_filter_mutex);
+        filter = m_filter;
+        next_filter = m_next_filter;
+        // Past its capacity the false positive rate of the filter climbs
+        // quickly, so build a larger one from the database. Lookups keep
+        // using the current one until it is done.
+        if (filter && !next_filter && filter->GetInsertCount() > filter->GetCapacity()) {
+            uint64_t expected = filter->GetInsertCount() + pos_data.vPos.size();
+            next_filter = m_next_filter = std::make_shared<CBlockedBloomFilter>(expected * 3 / 2 + TXINDEX_FILTER_HEADROOM, TXINDEX_FILTER_FP_RATE);
+            rebuild = true;
+        }
+    }
+    for (const auto& entry : pos_data.vPos) {
+        if (filter) filter->insert(entry.first);
+        if (next_filter) next_filter->insert(entry.first);
+    }
+    if (rebuild) {
+        // Blocks are written by one thread at a time, and this one started
+        // the previous build, which has finished as m_next_filter was null.
+        if (m_filter_thread.joinable()) {
+            m_filter_thread.join();
+        }
+        LogPrintf("txindex lookup filter holds %u transactions, more than the %u it was sized for; rebuilding it\n",
+                  filter->GetInsertCount(), filter->GetCapacity());
+        m_filter_thread = std::thread(&TraceThread<std::function<void()>>, "txindexfilter",
+                                      std::bind(&TxIndex::ThreadBuildFilter, this));
+    }
+    return m_db->WriteTxs(pos_data.vPos);
 }
 
 BaseIndex::DB& TxIndex::GetDB() const { return *m_db; }
 
 bool TxIndex::FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const
 {
+    const std::shared_ptr<const CBlockedBloomFilter> filter = WITH_LOCK(m_filter_mutex, return m_filter);
+    const bool filter_ready = filter != nullptr;
+    if (filter_ready && !filter->contains(tx_hash)) {
+        ++m_filter_skipped;
+        return false;
+    }
+
     CDiskTxPos postx;
     if (!m_db->ReadTxPos(tx_hash, postx)) {
+        if (filter_ready) ++m_filter_false_positives;
         return false;
     }
 
@@ -263,3 +383,23 @@ bool TxIndex::FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRe
     block_hash = header.GetHash();
     return true;
 }
+
+TxIndex::FilterStats TxIndex::GetFilterStats() const
+{
+    FilterStats stats;
+    LOCK(m_filter_mutex);
+    if (!m_filter && !m_next_filter) return stats;
+    stats.enabled = true;
+    if (m_filter) {
+        stats.ready = true;
+        stats.memory_usage += m_filter->DynamicMemoryUsage();
+        stats.entries = m_filter->GetInsertCount();
+        stats.capacity = m_filter->GetCapacity();
+    }
+    if (m_next_filter) {
+        stats.memory_usage += m_next_filter->DynamicMemoryUsage();
+    }
+    stats.skipped_lookups = m_filter_skipped;
+    stats.false_positives = m_filter_false_positives;
+    return stats;
+}
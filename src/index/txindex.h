@@ -5,10 +5,24 @@
 #ifndef BITCOIN_INDEX_TXINDEX_H
 #define BITCOIN_INDEX_TXINDEX_H
 
+#include <bloom.h>
 #include <chain.h>
 #include <index/base.h>
+#include <sync.h>
+#include <threadinterrupt.h>
 #include <txdb.h>
 
+#include <atomic>
+#include <memory>
+#include <thread>
+
+//! -txindexfilter default
+static const bool DEFAULT_TXINDEX_FILTER = true;
+//! Target false positive rate of the txindex lookup filter
+static const double TXINDEX_FILTER_FP_RATE = 0.001;
+//! Transactions a txindex lookup filter is sized for on top of the ones it must hold
+static const uint64_t TXINDEX_FILTER_HEADROOM = 1000000;
+
 /**
  * TxIndex is used to look up transactions included in the blockchain by hash.
  * The index is written to a LevelDB database and records the filesystem
@@ -22,11 +36,32 @@ protected:
 private:
     const std::unique_ptr<DB> m_db;
 
+    mutable Mutex m_filter_mutex;
+    /// Filter over all indexed txids, so that lookups of unknown transactions
+    /// can be answered without reading the database. Null until
+    /// m_filter_thread has first built it.
+    std::shared_ptr<CBlockedBloomFilter> m_filter GUARDED_BY(m_filter_mutex);
+    /// Filter being built from the database by m_filter_thread, which then
+    /// replaces m_filter with it: after Init, and again with a larger one
+    /// whenever m_filter holds more txids than it was sized for.
+    std::shared_ptr<CBlockedBloomFilter> m_next_filter GUARDED_BY(m_filter_mutex);
+    std::thread m_filter_thread;
+    CThreadInterrupt m_filter_interrupt;
+
+    mutable std::atomic<uint64_t> m_filter_skipped{0};
+    mutable std::atomic<uint64_t> m_filter_false_positives{0};
+
+    /// Insert all txids in the database into m_next_filter and make it the
+    /// lookup filter. Runs in m_filter_thread.
+    void ThreadBuildFilter();
+
 protected:
     /// Override base class init to migrate from old database.
     bool Init() override;
 
-    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+    std::unique_ptr<BlockData> PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const override;
+
+    bool WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex, std::unique_ptr<BlockData> data) override;
 
     BaseIndex::DB& GetDB() const override;
 
@@ -46,6 +81,22 @@ public:
     /// @param[out]  tx  The transaction itself.
     /// @return  true if transaction is found, false otherwise
     bool FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const;
+
+    struct FilterStats {
+        bool enabled{false};
+        bool ready{false};
+        size_t memory_usage{0};
+        uint64_t entries{0};
+        //! Number of entries the filter was sized for
+        uint64_t capacity{0};
+        //! Lookups answered by the filter alone
+        uint64_t skipped_lookups{0};
+        //! Lookups the filter let through for transactions that are not indexed
+        uint64_t false_positives{0};
+    };
+
+    /// Get the state of the lookup filter.
+    FilterStats GetFilterStats() const;
 };
 
 /// The global transaction index, used in GetTransaction. May be null.
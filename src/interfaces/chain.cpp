@@ -6,6 +6,7 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <index/blockfilterindex.h>
 #include <interfaces/handler.h>
 #include <interfaces/wallet.h>
 #include <net.h>
@@ -273,6 +274,24 @@ public:
         }
         return true;
     }
+    bool hasBlockFilterIndex(BlockFilterType filter_type) override
+    {
+        return GetBlockFilterIndex(filter_type) != nullptr;
+    }
+    Optional<bool> blockFilterMatchesAny(BlockFilterType filter_type, const uint256& block_hash, const GCSFilter::ElementSet& filter_set) override
+    {
+        const BlockFilterIndex* block_filter_index = GetBlockFilterIndex(filter_type);
+        if (!block_filter_index) return nullopt;
+
+        const CBlockIndex* index;
+        {
+            LOCK(cs_main);
+            index = LookupBlockIndex(block_hash);
+        }
+        BlockFilter filter;
+        if (!index || !block_filter_index->LookupFilter(index, filter)) return nullopt;
+        return filter.GetFilter().MatchAny(filter_set);
+    }
     void findCoins(std::map<COutPoint, Coin>& coins) override { return FindCoins(m_node, coins); }
     double guessVerificationProgress(const uint256& block_hash) override
     {
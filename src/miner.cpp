@@ -1693,15 +1693,12 @@ protected:
     void SloveBlock(uint32_t blockTime, size_t delegateSize, size_t from, size_t to)
     {
         std::multimap<uint256, SolveItem> tmpSolvedBlock;
-        for(size_t i = from; i < to; i++)
+        std::vector<std::pair<size_t, uint256>> found;
+        CheckKernelCacheBatch(d->pindexPrev, d->pblock->nBits, blockTime, d->prevouts, from, to, d->pwallet->minerStakeCache, found);
+        for(const std::pair<size_t, uint256>& item : found)
         {
-            const COutPoint &prevoutStake = d->prevouts[i];
-            uint256 hashProofOfStake;
-            if (CheckKernelCache(d->pindexPrev, d->pblock->nBits, blockTime, prevoutStake, d->pwallet->minerStakeCache, hashProofOfStake))
-            {
-                bool delegate = i < delegateSize;
-                tmpSolvedBlock.insert(std::make_pair(hashProofOfStake, SolveItem(prevoutStake, blockTime, delegate)));
-            }
+            bool delegate = item.first < delegateSize;
+            tmpSolvedBlock.insert(std::make_pair(item.second, SolveItem(d->prevouts[item.first], blockTime, delegate)));
         }
 
         if(tmpSolvedBlock.size() > 0)
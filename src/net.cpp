@@ -26,12 +26,17 @@
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
 #endif
 
 #ifdef USE_POLL
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/upnpcommands.h>
@@ -51,6 +56,9 @@ static constexpr std::chrono::minutes DUMP_PEERS_INTERVAL{15};
 /** Number of DNS seeds to query when the number of connections is low. */
 static constexpr int DNSSEEDS_TO_QUERY_AT_ONCE = 3;
 
+/** Maximum number of queued buffers handed to a single sendmsg() call (POSIX guarantees at least 16). */
+static constexpr int MAX_SEND_IOVECS = 16;
+
 // We add a random period time (0 to 1 seconds) to feeler connections to prevent synchronization.
 #define FEELER_SLEEP_WINDOW 1
 
@@ -75,6 +83,13 @@ enum BindFlags {
 // The sleep time needs to be small to avoid new sockets stalling
 static const uint64_t SELECT_TIMEOUT_MILLISECONDS = 50;
 
+#ifdef USE_EPOLL
+// Maximum number of events returned by a single epoll_wait
+static const int MAX_EPOLL_EVENTS = 256;
+// Marks epoll events of listening sockets; all other events carry a NodeId
+static const uint64_t EPOLL_LISTEN_TAG = 1ULL << 63;
+#endif
+
 const std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
@@ -542,6 +557,10 @@ void CNode::copyStats(CNodeStats &stats, const std::vector<bool> &m_asmap)
     } else {
         stats.minFeeFilter = 0;
     }
+    if (m_tx_relay != nullptr) {
+        LOCK(m_tx_relay->cs_tx_inventory);
+        stats.m_recon_stats = m_tx_relay->m_recon ? m_tx_relay->m_recon->m_stats : TxReconciliationStats();
+    }
 
     // It is common for nodes with good ping times to suddenly become lagged,
     // due to a new block arriving or other large transfer.
@@ -602,6 +621,12 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
     return true;
 }
 
+bool CNode::PopStreamedBlockHeader(CBlockHeader& header)
+{
+    LOCK(cs_vRecv);
+    return m_deserializer->PopBlockHeader(header);
+}
+
 void CNode::SetSendVersion(int nVersionIn)
 {
     // Send version may only be changed in the version message, and
@@ -654,6 +679,11 @@ int V1TransportDeserializer::readHeader(const char *pch, unsigned int nBytes)
         return -1;
     }
 
+    // parse large blocks while they are being received
+    if (hdr.nMessageSize >= MIN_STREAMED_BLOCK_SIZE && hdr.GetCommand() == NetMsgType::BLOCK) {
+        m_block_parser = MakeUnique<BlockStreamParser>(vRecv.GetType(), vRecv.GetVersion(), hdr.nMessageSize);
+    }
+
     // switch state to reading message data
     in_data = true;
 
@@ -674,9 +704,24 @@ int V1TransportDeserializer::readData(const char *pch, unsigned int nBytes)
     memcpy(&vRecv[nDataPos], pch, nCopy);
     nDataPos += nCopy;
 
+    // stop receiving a block as soon as it is known to be invalid
+    if (m_block_parser && !m_block_parser->Update(vRecv.data(), nDataPos)) {
+        LogPrint(BCLog::NET, "invalid block received (%s) after %u of %u bytes\n", m_block_parser->GetRejectReason(), nDataPos, hdr.nMessageSize);
+        return -1;
+    }
+
     return nCopy;
 }
 
+bool V1TransportDeserializer::PopBlockHeader(CBlockHeader& header)
+{
+    if (!m_block_parser || !m_block_parser->HasHeader() || m_block_header_popped)
+        return false;
+    header = m_block_parser->GetBlock().GetBlockHeader();
+    m_block_header_popped = true;
+    return true;
+}
+
 const uint256& V1TransportDeserializer::GetMessageHash() const
 {
     assert(Complete());
@@ -710,6 +755,11 @@ CNetMessage V1TransportDeserializer::GetMessage(const CMessageHeader::MessageSta
                  HexStr(hdr.pchChecksum, hdr.pchChecksum+CMessageHeader::CHECKSUM_SIZE));
     }
 
+    // hand over a block that was already parsed while it was received
+    if (m_block_parser && m_block_parser->GetState() == BlockStreamParser::State::COMPLETE) {
+        msg.m_block = m_block_parser->TakeBlock();
+    }
+
     // store receive time
     msg.m_time = time;
 
@@ -719,11 +769,11 @@ CNetMessage V1TransportDeserializer::GetMessage(const CMessageHeader::MessageSta
 }
 
 void V1TransportSerializer::prepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header) {
-    // create dbl-sha256 checksum
-    uint256 hash = Hash(msg.data.begin(), msg.data.end());
+    // create dbl-sha256 checksum, which shared payloads only compute once
+    const uint256 hash = msg.shared_data ? msg.shared_data->hash : Hash(msg.data.begin(), msg.data.end());
 
     // create header
-    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), msg.data.size());
+    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), msg.Payload().size());
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
     // serialize header
@@ -737,26 +787,47 @@ size_t CConnman::SocketSendData(CNode *pnode) const EXCLUSIVE_LOCKS_REQUIRED(pno
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert((*it)->size() > pnode->nSendOffset);
         int nBytes = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
+#ifdef WIN32
+            const auto &data = **it;
             nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            // Hand as many queued buffers as possible to the kernel in one call.
+            struct iovec iov[MAX_SEND_IOVECS];
+            int nBuffers = 0;
+            size_t nOffset = pnode->nSendOffset;
+            for (auto buf = it; buf != pnode->vSendMsg.end() && nBuffers < MAX_SEND_IOVECS; ++buf) {
+                iov[nBuffers].iov_base = const_cast<unsigned char*>((*buf)->data()) + nOffset;
+                iov[nBuffers].iov_len = (*buf)->size() - nOffset;
+                nOffset = 0;
+                ++nBuffers;
+            }
+            struct msghdr msg = {};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = nBuffers;
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            // Retire the buffers that went out completely.
+            size_t nLeft = nBytes;
+            while (nLeft > 0 && nLeft >= (*it)->size() - pnode->nSendOffset) {
+                nLeft -= (*it)->size() - pnode->nSendOffset;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+                pnode->nSendSize -= (*it)->size();
                 it++;
-            } else {
+            }
+            pnode->nSendOffset += nLeft;
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if (pnode->nSendOffset != 0) {
                 // could not send full message; stop sending more
                 break;
             }
@@ -1324,9 +1395,110 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
 }
 #endif
 
+#ifdef USE_EPOLL
+void CConnman::SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+{
+    // Peers are registered once, edge-triggered for both directions, and stay
+    // registered until their socket is closed. Instead of rebuilding a set of
+    // descriptors every iteration, we remember per peer whether the socket may
+    // still have data to read or room to write, and only wait when no peer has
+    // work left. The selection policy is the same as in GenerateSelectSet.
+    bool pending = false;
+    {
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodes) {
+            bool select_send;
+            {
+                LOCK(pnode->cs_vSend);
+                select_send = !pnode->vSendMsg.empty();
+            }
+
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+
+            if (!pnode->m_epoll_registered) {
+                struct epoll_event event = {};
+                event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                event.data.u64 = pnode->GetId();
+                if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, pnode->hSocket, &event) != 0) {
+                    LogPrintf("epoll_ctl failed for peer=%d: %s\n", pnode->GetId(), NetworkErrorString(WSAGetLastError()));
+                    pnode->fDisconnect = true;
+                    continue;
+                }
+                pnode->m_epoll_registered = true;
+            }
+
+            if (select_send ? pnode->m_epoll_send_ready : (pnode->m_epoll_recv_ready && !pnode->fPauseRecv)) {
+                pending = true;
+            }
+        }
+    }
+
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int nEvents = epoll_wait(m_epoll_fd, events, MAX_EPOLL_EVENTS, pending ? 0 : SELECT_TIMEOUT_MILLISECONDS);
+
+    if (interruptNet) return;
+
+    if (nEvents < 0) {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEINTR) {
+            LogPrintf("socket epoll error %s\n", NetworkErrorString(nErr));
+        }
+        nEvents = 0;
+    }
+
+    std::unordered_map<NodeId, uint32_t> node_events;
+    for (int i = 0; i < nEvents; ++i) {
+        if (events[i].data.u64 & EPOLL_LISTEN_TAG) {
+            recv_set.insert((SOCKET)(events[i].data.u64 & ~EPOLL_LISTEN_TAG));
+        } else {
+            node_events[(NodeId)events[i].data.u64] |= events[i].events;
+        }
+    }
+
+    LOCK(cs_vNodes);
+    for (CNode* pnode : vNodes) {
+        uint32_t revents = 0;
+        auto it = node_events.find(pnode->GetId());
+        if (it != node_events.end()) {
+            revents = it->second;
+            if (revents & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) pnode->m_epoll_recv_ready = true;
+            if (revents & EPOLLOUT) pnode->m_epoll_send_ready = true;
+        }
+
+        bool select_send;
+        {
+            LOCK(pnode->cs_vSend);
+            select_send = !pnode->vSendMsg.empty();
+        }
+
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET)
+            continue;
+
+        if (revents & (EPOLLERR | EPOLLHUP)) {
+            error_set.insert(pnode->hSocket);
+        }
+        if (select_send) {
+            if (pnode->m_epoll_send_ready) send_set.insert(pnode->hSocket);
+            continue;
+        }
+        if (pnode->m_epoll_recv_ready && !pnode->fPauseRecv) {
+            recv_set.insert(pnode->hSocket);
+        }
+    }
+}
+#endif
+
 void CConnman::SocketHandler()
 {
     std::set<SOCKET> recv_set, send_set, error_set;
+#ifdef USE_EPOLL
+    if (m_epoll_fd != -1) {
+        SocketEventsEpoll(recv_set, send_set, error_set);
+    } else
+#endif
     SocketEvents(recv_set, send_set, error_set);
 
     if (interruptNet) return;
@@ -1382,12 +1554,20 @@ void CConnman::SocketHandler()
                     continue;
                 nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
             }
+            // A short read drained the socket; the next arrival triggers a new edge.
+            if (nBytes > 0 && (size_t)nBytes < sizeof(pchBuf)) {
+                pnode->m_epoll_recv_ready = false;
+            }
             if (nBytes > 0)
             {
                 bool notify = false;
                 if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
                     pnode->CloseSocketDisconnect();
                 RecordBytesRecv(nBytes);
+                CBlockHeader streamed_header;
+                if (pnode->PopStreamedBlockHeader(streamed_header)) {
+                    m_msgproc->CheckStreamedBlockHeader(pnode, streamed_header);
+                }
                 if (notify) {
                     size_t nSizeAdded = 0;
                     auto it(pnode->vRecvMsg.begin());
@@ -1417,6 +1597,9 @@ void CConnman::SocketHandler()
             {
                 // error
                 int nErr = WSAGetLastError();
+                if (nErr == WSAEWOULDBLOCK) {
+                    pnode->m_epoll_recv_ready = false;
+                }
                 if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
                 {
                     if (!pnode->fDisconnect) {
@@ -1437,6 +1620,10 @@ void CConnman::SocketHandler()
             if (nBytes) {
                 RecordBytesSent(nBytes);
             }
+            // Anything left over means the kernel buffer is full; wait for the next EPOLLOUT edge.
+            if (!pnode->vSendMsg.empty()) {
+                pnode->m_epoll_send_ready = false;
+            }
         }
 
         InactivityCheck(pnode);
@@ -2036,11 +2223,17 @@ void CConnman::ThreadMessageHandler()
 
         bool fMoreWork = false;
 
+        m_msgproc->PrepareProcessingRound(vNodesCopy);
+
         for (CNode* pnode : vNodesCopy)
         {
             if (pnode->fDisconnect)
                 continue;
 
+            // A worker is processing messages for this node; it wakes us up when done.
+            if (pnode->m_async_processing)
+                continue;
+
             // Receive messages
             bool fMoreNodeWork = m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc);
             fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
@@ -2070,6 +2263,38 @@ void CConnman::ThreadMessageHandler()
     }
 }
 
+bool CConnman::ProcessMessagesAsync(CNode* pnode, std::function<void()> func)
+{
+    if (m_msgproc_workers.empty()) return false;
+    pnode->AddRef();
+    pnode->m_async_processing = true;
+    {
+        LOCK(m_msgproc_work_mutex);
+        m_msgproc_work.emplace_back(pnode, std::move(func));
+    }
+    m_msgproc_work_cv.notify_one();
+    return true;
+}
+
+void CConnman::ThreadMessageWorker()
+{
+    while (true) {
+        std::pair<CNode*, std::function<void()>> work;
+        {
+            WAIT_LOCK(m_msgproc_work_mutex, lock);
+            m_msgproc_work_cv.wait(lock, [this] { return flagInterruptMsgProc || !m_msgproc_work.empty(); });
+            if (flagInterruptMsgProc) return;
+            work = std::move(m_msgproc_work.front());
+            m_msgproc_work.pop_front();
+        }
+        CNode* pnode = work.first;
+        work.second();
+        pnode->m_async_processing = false;
+        pnode->Release();
+        WakeMessageHandler();
+    }
+}
+
 
 
 
@@ -2278,6 +2503,24 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         return false;
     }
 
+#ifdef USE_EPOLL
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll_fd == -1) {
+        LogPrintf("epoll_create1 failed: %s, falling back to poll\n", NetworkErrorString(WSAGetLastError()));
+    }
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        if (m_epoll_fd == -1) break;
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = EPOLL_LISTEN_TAG | hListenSocket.socket;
+        if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, hListenSocket.socket, &event) != 0) {
+            LogPrintf("epoll_ctl failed for listening socket: %s, falling back to poll\n", NetworkErrorString(WSAGetLastError()));
+            close(m_epoll_fd);
+            m_epoll_fd = -1;
+        }
+    }
+#endif
+
     for (const auto& strDest : connOptions.vSeedNodes) {
         AddOneShot(strDest);
     }
@@ -2348,6 +2591,9 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     // Process messages
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    for (int i = 0; i < m_msgproc_threads; ++i) {
+        m_msgproc_workers.emplace_back(&TraceThread<std::function<void()> >, "msgproc", std::function<void()>(std::bind(&CConnman::ThreadMessageWorker, this)));
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery([this] { DumpAddresses(); }, DUMP_PEERS_INTERVAL);
@@ -2377,6 +2623,11 @@ void CConnman::Interrupt()
         flagInterruptMsgProc = true;
     }
     condMsgProc.notify_all();
+    {
+        // Taking the lock makes sure no worker is between checking the flag and waiting.
+        LOCK(m_msgproc_work_mutex);
+    }
+    m_msgproc_work_cv.notify_all();
 
     interruptNet();
     InterruptSocks5(true);
@@ -2398,6 +2649,18 @@ void CConnman::StopThreads()
 {
     if (threadMessageHandler.joinable())
         threadMessageHandler.join();
+    for (std::thread& worker : m_msgproc_workers) {
+        worker.join();
+    }
+    m_msgproc_workers.clear();
+    {
+        LOCK(m_msgproc_work_mutex);
+        for (auto& work : m_msgproc_work) {
+            work.first->m_async_processing = false;
+            work.first->Release();
+        }
+        m_msgproc_work.clear();
+    }
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
@@ -2434,6 +2697,12 @@ void CConnman::StopNodes()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+#ifdef USE_EPOLL
+    if (m_epoll_fd != -1) {
+        close(m_epoll_fd);
+        m_epoll_fd = -1;
+    }
+#endif
     semOutbound.reset();
     semAddnode.reset();
 }
@@ -2743,7 +3012,7 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
 
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
-    size_t nMessageSize = msg.data.size();
+    size_t nMessageSize = msg.Payload().size();
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command), nMessageSize, pnode->GetId());
 
     // make sure we use the appropriate network transport format
@@ -2762,9 +3031,15 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+        pnode->vSendMsg.push_back(std::make_shared<const std::vector<unsigned char>>(std::move(serializedHeader)));
+        if (nMessageSize) {
+            if (msg.shared_data) {
+                // Share ownership of the payload rather than copying it.
+                pnode->vSendMsg.emplace_back(msg.shared_data, &msg.shared_data->data);
+            } else {
+                pnode->vSendMsg.push_back(std::make_shared<const std::vector<unsigned char>>(std::move(msg.data)));
+            }
+        }
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
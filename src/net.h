@@ -9,6 +9,7 @@
 #include <addrdb.h>
 #include <addrman.h>
 #include <amount.h>
+#include <blockstream.h>
 #include <bloom.h>
 #include <compat.h>
 #include <crypto/siphash.h>
@@ -23,6 +24,7 @@
 #include <sync.h>
 #include <uint256.h>
 #include <threadinterrupt.h>
+#include <txreconciliation.h>
 
 #include <atomic>
 #include <deque>
@@ -89,6 +91,10 @@ static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** -msgprocthreads default: with none, all messages are processed on the message handler thread */
+static const int DEFAULT_MSGPROC_THREADS = 0;
+/** Maximum number of -msgprocthreads */
+static const int MAX_MSGPROC_THREADS = 16;
 
 typedef int64_t NodeId;
 
@@ -103,6 +109,16 @@ struct AddedNodeInfo
 class CNodeStats;
 class CClientUIInterface;
 
+/** A serialized message payload that can be queued to many peers without being copied. */
+struct CSharedNetPayload
+{
+    explicit CSharedNetPayload(std::vector<unsigned char>&& data_in) : data(std::move(data_in)), hash(Hash(data.begin(), data.end())) {}
+
+    const std::vector<unsigned char> data;
+    //! Double-SHA256 of data, computed once for the message checksum of every copy sent
+    const uint256 hash;
+};
+
 struct CSerializedNetMsg
 {
     CSerializedNetMsg() = default;
@@ -113,7 +129,11 @@ struct CSerializedNetMsg
     CSerializedNetMsg& operator=(const CSerializedNetMsg&) = delete;
 
     std::vector<unsigned char> data;
+    //! When set, the payload is shared with other messages and data is unused
+    std::shared_ptr<const CSharedNetPayload> shared_data;
     std::string command;
+
+    const std::vector<unsigned char>& Payload() const { return shared_data ? shared_data->data : data; }
 };
 
 
@@ -146,6 +166,7 @@ public:
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
         int64_t m_peer_connect_timeout = DEFAULT_PEER_CONNECT_TIMEOUT;
+        int m_msgproc_threads = DEFAULT_MSGPROC_THREADS;
         std::vector<std::string> vSeedNodes;
         std::vector<NetWhitelistPermissions> vWhitelistedRange;
         std::vector<NetWhitebindPermissions> vWhiteBinds;
@@ -172,6 +193,7 @@ public:
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         m_peer_connect_timeout = connOptions.m_peer_connect_timeout;
+        m_msgproc_threads = std::min(connOptions.m_msgproc_threads, MAX_MSGPROC_THREADS);
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -322,6 +344,16 @@ public:
 
     void WakeMessageHandler();
 
+    /**
+     * Run part of a node's message processing on a worker thread. The message
+     * handler skips the node, for both receiving and sending, until func
+     * returns, so messages from one peer are still handled in order.
+     *
+     * @return false if there are no worker threads, in which case the caller
+     *         must do the work itself.
+     */
+    bool ProcessMessagesAsync(CNode* pnode, std::function<void()> func);
+
     /** Attempts to obfuscate tx time through exponentially distributed emitting.
         Works assuming that a single interval is used.
         Variable intervals will result in privacy decrease.
@@ -348,12 +380,16 @@ private:
     void ProcessOneShot();
     void ThreadOpenConnections(std::vector<std::string> connect);
     void ThreadMessageHandler();
+    void ThreadMessageWorker();
     void AcceptConnection(const ListenSocket& hListenSocket);
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
     void InactivityCheck(CNode *pnode);
     bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#ifdef USE_EPOLL
+    void SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#endif
     void SocketHandler();
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
@@ -406,6 +442,10 @@ private:
     unsigned int nReceiveFloodSize{0};
 
     std::vector<ListenSocket> vhListenSocket;
+#ifdef USE_EPOLL
+    //! epoll instance holding the listening sockets and one persistent registration per peer; -1 to use SocketEvents
+    int m_epoll_fd{-1};
+#endif
     std::atomic<bool> fNetworkActive{true};
     bool fAddressesInitialized{false};
     CAddrMan addrman;
@@ -471,6 +511,13 @@ private:
     std::thread threadOpenConnections;
     std::thread threadMessageHandler;
 
+    /** Message processing offloaded by ProcessMessagesAsync */
+    int m_msgproc_threads{0};
+    Mutex m_msgproc_work_mutex;
+    std::condition_variable m_msgproc_work_cv;
+    std::deque<std::pair<CNode*, std::function<void()>>> m_msgproc_work GUARDED_BY(m_msgproc_work_mutex);
+    std::vector<std::thread> m_msgproc_workers;
+
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of m_max_outbound_full_relay
      *  This takes the place of a feeler connection */
@@ -508,10 +555,14 @@ struct CombinerAll
 class NetEventsInterface
 {
 public:
+    /** Called once per message handler round, before ProcessMessages for each of the nodes */
+    virtual void PrepareProcessingRound(const std::vector<CNode*>& nodes) = 0;
     virtual bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) = 0;
     virtual bool SendMessages(CNode* pnode) = 0;
     virtual void InitializeNode(CNode* pnode) = 0;
     virtual void FinalizeNode(NodeId id, bool& update_connection_time) = 0;
+    /** Check the header of a block that is still being received. Called on the socket thread; must not block. */
+    virtual void CheckStreamedBlockHeader(CNode* pnode, const CBlockHeader& header) = 0;
 
 protected:
     /**
@@ -598,6 +649,7 @@ public:
     int64_t m_ping_wait_usec;
     int64_t m_min_ping_usec;
     CAmount minFeeFilter;
+    TxReconciliationStats m_recon_stats;
     // Our address, as reported by the peer
     std::string addrLocal;
     // Address of this peer
@@ -623,6 +675,8 @@ public:
     uint32_t m_message_size = 0;         // size of the payload
     uint32_t m_raw_message_size = 0;     // used wire size of the message (including header/checksum)
     std::string m_command;
+    std::shared_ptr<CBlock> m_block;     // "block" payload already parsed and pre-checked while it was received
+    CTransactionRef m_tx;                // "tx" payload already parsed for the batched script checks of its processing round
 
     CNetMessage(CDataStream&& recv_in) : m_recv(std::move(recv_in)) {}
 
@@ -646,6 +700,8 @@ public:
     virtual int Read(const char *data, unsigned int bytes) = 0;
     // decomposes a message from the context
     virtual CNetMessage GetMessage(const CMessageHeader::MessageStartChars& message_start, int64_t time) = 0;
+    // returns the header of a block that is still being received, once per block
+    virtual bool PopBlockHeader(CBlockHeader& header) = 0;
     virtual ~TransportDeserializer() {}
 };
 
@@ -660,6 +716,8 @@ private:
     CDataStream vRecv;              // received message data
     unsigned int nHdrPos;
     unsigned int nDataPos;
+    std::unique_ptr<BlockStreamParser> m_block_parser; // parses large "block" payloads as they arrive
+    bool m_block_header_popped;
 
     const uint256& GetMessageHash() const;
     int readHeader(const char *pch, unsigned int nBytes);
@@ -674,6 +732,8 @@ private:
         nDataPos = 0;
         data_hash.SetNull();
         hasher.Reset();
+        m_block_parser.reset();
+        m_block_header_popped = false;
     }
 
 public:
@@ -699,6 +759,7 @@ public:
         return ret;
     }
     CNetMessage GetMessage(const CMessageHeader::MessageStartChars& message_start, int64_t time) override;
+    bool PopBlockHeader(CBlockHeader& header) override;
 };
 
 /** The TransportSerializer prepares messages for the network transport
@@ -731,7 +792,8 @@ public:
     size_t nSendSize{0}; // total size of all vSendMsg entries
     size_t nSendOffset{0}; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::deque<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    // Headers and payloads queued for sending; payloads may be shared with other nodes
+    std::deque<std::shared_ptr<const std::vector<unsigned char>>> vSendMsg GUARDED_BY(cs_vSend);
     RecursiveMutex cs_vSend;
     RecursiveMutex cs_hSocket;
     RecursiveMutex cs_vRecv;
@@ -784,6 +846,12 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv{false};
     std::atomic_bool fPauseSend{false};
+    // Set while a message processing worker handles this node (see CConnman::ProcessMessagesAsync)
+    std::atomic_bool m_async_processing{false};
+    // Edge-triggered readiness state, only used by the socket handler thread (see CConnman::SocketEventsEpoll)
+    bool m_epoll_registered{false};
+    bool m_epoll_recv_ready{false};
+    bool m_epoll_send_ready{false};
 
 protected:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
@@ -828,6 +896,10 @@ public:
         // Last time a "MEMPOOL" request was serviced.
         std::atomic<std::chrono::seconds> m_last_mempool_req{std::chrono::seconds{0}};
         std::chrono::microseconds nNextInvSend{0};
+        // Salt we sent in "sendrecon", or 0 if we did not offer reconciliation
+        uint64_t m_recon_salt GUARDED_BY(cs_tx_inventory){0};
+        // Set once both sides offered reconciliation; announcements then go through it instead of setInventoryTxToSend
+        std::unique_ptr<TxReconciliationState> m_recon GUARDED_BY(cs_tx_inventory);
 
         RecursiveMutex cs_feeFilter;
         // Minimum fee rate with which to filter inv's to this node
@@ -918,6 +990,7 @@ public:
     }
 
     bool ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete);
+    bool PopStreamedBlockHeader(CBlockHeader& header);
 
     void SetRecvVersion(int nVersionIn)
     {
@@ -8,6 +8,7 @@
 #include <addrman.h>
 #include <banman.h>
 #include <blockencodings.h>
+#include <blockservecache.h>
 #include <chainparams.h>
 #include <consensus/validation.h>
 #include <hash.h>
@@ -24,6 +25,7 @@
 #include <scheduler.h>
 #include <tinyformat.h>
 #include <txmempool.h>
+#include <txreconciliation.h>
 #include <util/system.h>
 #include <util/strencodings.h>
 #include <checkpoints.h>
@@ -170,6 +172,12 @@ namespace {
     RecursiveMutex g_cs_recent_confirmed_transactions;
     std::unique_ptr<CRollingBloomFilter> g_recent_confirmed_transactions GUARDED_BY(g_cs_recent_confirmed_transactions);
 
+    /**
+     * Serialized recent blocks and compact blocks, shared by all peers that
+     * request them. Bounded by -blockservecache.
+     */
+    std::unique_ptr<BlockServeCache> g_block_serve_cache;
+
     /** Blocks that are in flight, and that are in the queue to be downloaded. */
     struct QueuedBlock {
         uint256 hash;
@@ -1278,6 +1286,8 @@ PeerLogicValidation::PeerLogicValidation(CConnman* connmanIn, BanMan* banman, CS
     // same probability that we have in the reject filter).
     g_recent_confirmed_transactions.reset(new CRollingBloomFilter(24000, 0.000001));
 
+    g_block_serve_cache = MakeUnique<BlockServeCache>(std::max<int64_t>(0, gArgs.GetArg("-blockservecache", DEFAULT_BLOCK_SERVE_CACHE_MB)) << 20);
+
     const Consensus::Params& consensusParams = Params().GetConsensus();
     // Stale tip checking and peer eviction are on two different timers, but we
     // don't want them to get out of sync due to drift in the scheduler, so we
@@ -1349,17 +1359,58 @@ void PeerLogicValidation::BlockDisconnected(const std::shared_ptr<const CBlock>
 // All of the following cache a recent block, and are protected by cs_most_recent_block
 static RecursiveMutex cs_most_recent_block;
 static std::shared_ptr<const CBlock> most_recent_block GUARDED_BY(cs_most_recent_block);
-static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_block GUARDED_BY(cs_most_recent_block);
 static uint256 most_recent_block_hash GUARDED_BY(cs_most_recent_block);
-static bool fWitnessesPresentInMostRecentCompactBlock GUARDED_BY(cs_most_recent_block);
+
+/**
+ * Get the serialized block or compact block for pindex, from the shared cache
+ * if possible. Otherwise it is built from pblock, or read from disk if that is
+ * null, and added to the cache if cache_recent is set.
+ * Returns null if the block cannot be read.
+ */
+static std::shared_ptr<const CSharedNetPayload> GetBlockPayload(const CBlockIndex* pindex, BlockServeCache::Kind kind, std::shared_ptr<const CBlock> pblock, bool cache_recent, const CChainParams& chainparams)
+{
+    const uint256 hash = pindex->GetBlockHash();
+    std::shared_ptr<const CSharedNetPayload> payload = g_block_serve_cache->Get(hash, kind);
+    if (payload) return payload;
+
+    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    if (kind == BlockServeCache::Kind::BLOCK && !pblock) {
+        // Fast-path: the network format matches the format on disk
+        std::vector<uint8_t> block_data;
+        if (!ReadRawBlockFromDisk(block_data, pindex, chainparams.MessageStart())) return nullptr;
+        payload = std::make_shared<const CSharedNetPayload>(std::move(block_data));
+    } else {
+        if (!pblock) {
+            std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+            if (!ReadBlockFromDisk(*pblockRead, pindex, chainparams.GetConsensus())) return nullptr;
+            pblock = pblockRead;
+        }
+        switch (kind) {
+        case BlockServeCache::Kind::BLOCK:
+            payload = msgMaker.MakePayload(0, *pblock);
+            break;
+        case BlockServeCache::Kind::BLOCK_NO_WITNESS:
+            payload = msgMaker.MakePayload(SERIALIZE_TRANSACTION_NO_WITNESS, *pblock);
+            break;
+        case BlockServeCache::Kind::CMPCT:
+            payload = msgMaker.MakePayload(0, CBlockHeaderAndShortTxIDs(*pblock, true));
+            break;
+        case BlockServeCache::Kind::CMPCT_NO_WITNESS:
+            payload = msgMaker.MakePayload(SERIALIZE_TRANSACTION_NO_WITNESS, CBlockHeaderAndShortTxIDs(*pblock, false));
+            break;
+        }
+    }
+    if (cache_recent) g_block_serve_cache->Put(hash, kind, payload);
+    return payload;
+}
 
 /**
  * Maintain state about the best-seen block and fast-announce a compact block
  * to compatible peers.
  */
 void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) {
-    std::shared_ptr<const CBlockHeaderAndShortTxIDs> pcmpctblock = std::make_shared<const CBlockHeaderAndShortTxIDs> (*pblock, true);
-    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    // Serialized once, shared by every peer we announce to and kept for later getdata requests
+    std::shared_ptr<const CSharedNetPayload> cmpctblock_payload = CNetMsgMaker(PROTOCOL_VERSION).MakePayload(0, CBlockHeaderAndShortTxIDs(*pblock, true));
 
     LOCK(cs_main);
 
@@ -1375,14 +1426,13 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
         LOCK(cs_most_recent_block);
         most_recent_block_hash = hashBlock;
         most_recent_block = pblock;
-        most_recent_compact_block = pcmpctblock;
-        fWitnessesPresentInMostRecentCompactBlock = fWitnessEnabled;
     }
 
-    connman->ForEachNode([this, &pcmpctblock, pindex, &msgMaker, fWitnessEnabled, &hashBlock](CNode* pnode) {
+    g_block_serve_cache->Put(hashBlock, BlockServeCache::Kind::CMPCT, cmpctblock_payload);
+
+    connman->ForEachNode([this, &cmpctblock_payload, pindex, fWitnessEnabled, &hashBlock](CNode* pnode) {
         AssertLockHeld(cs_main);
 
-        // TODO: Avoid the repeated-serialization here
         if (pnode->nVersion < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect)
             return;
         ProcessBlockAvailability(pnode->GetId());
@@ -1394,7 +1444,7 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
 
             LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->GetId());
-            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            connman->PushMessage(pnode, CNetMsgMaker::MakeShared(NetMsgType::CMPCTBLOCK, cmpctblock_payload));
             state.pindexBestHeaderSent = pindex;
         }
     });
@@ -1522,6 +1572,52 @@ void RelayTransaction(const uint256& txid, const CConnman& connman)
     });
 }
 
+/** Announce transactions left over from a reconciliation round that the peer does not know about yet. */
+static void AnnounceReconciledTransactions(CNode* pto, const std::vector<uint256>& txids, CConnman* connman) EXCLUSIVE_LOCKS_REQUIRED(pto->m_tx_relay->cs_tx_inventory)
+{
+    const CNetMsgMaker msgMaker(pto->GetSendVersion());
+    std::vector<CInv> vInv;
+    for (const uint256& txid : txids) {
+        if (pto->m_tx_relay->filterInventoryKnown.contains(txid)) continue;
+        pto->m_tx_relay->filterInventoryKnown.insert(txid);
+        vInv.push_back(CInv(MSG_TX, txid));
+        if (vInv.size() == MAX_INV_SZ) {
+            connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
+            vInv.clear();
+        }
+    }
+    if (!vInv.empty()) {
+        connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
+    }
+}
+
+/** Finish a reconciliation round: announce what the peer lacks and remember that it has the rest. */
+static void FinishReconciliation(CNode* pto, const std::set<uint32_t>* missing, CConnman* connman) EXCLUSIVE_LOCKS_REQUIRED(pto->m_tx_relay->cs_tx_inventory)
+{
+    TxReconciliationState& recon = *pto->m_tx_relay->m_recon;
+    std::vector<uint256> announce;
+    recon.m_stats.m_rounds++;
+    if (missing == nullptr) {
+        // Decoding failed; fall back to flooding.
+        recon.m_stats.m_failures++;
+        for (const auto& entry : recon.m_snapshot) {
+            announce.push_back(entry.second);
+        }
+    } else {
+        for (const auto& entry : recon.m_snapshot) {
+            if (missing->count(entry.first)) {
+                announce.push_back(entry.second);
+            } else {
+                pto->m_tx_relay->filterInventoryKnown.insert(entry.second);
+                recon.m_stats.m_announcements_saved++;
+            }
+        }
+    }
+    recon.m_snapshot.clear();
+    recon.m_in_round = false;
+    AnnounceReconciledTransactions(pto, announce, connman);
+}
+
 static void RelayAddress(const CAddress& addr, bool fReachable, const CConnman& connman)
 {
     unsigned int nRelayNodes = fReachable ? 2 : 1; // limited relaying of addresses outside our network(s)
@@ -1562,14 +1658,10 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
 {
     bool send = false;
     std::shared_ptr<const CBlock> a_recent_block;
-    std::shared_ptr<const CBlockHeaderAndShortTxIDs> a_recent_compact_block;
-    bool fWitnessesPresentInARecentCompactBlock;
     const Consensus::Params& consensusParams = chainparams.GetConsensus();
     {
         LOCK(cs_most_recent_block);
         a_recent_block = most_recent_block;
-        a_recent_compact_block = most_recent_compact_block;
-        fWitnessesPresentInARecentCompactBlock = fWitnessesPresentInMostRecentCompactBlock;
     }
 
     bool need_activate_chain = false;
@@ -1595,108 +1687,121 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
         }
     }
 
-    LOCK(cs_main);
-    const CBlockIndex* pindex = LookupBlockIndex(inv.hash);
-    if (pindex) {
-        send = BlockRequestAllowed(pindex, consensusParams);
-        if (!send) {
-            LogPrint(BCLog::NET, "%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom->GetId());
-        }
-    }
     const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
-    // disconnect node in case we have reached the outbound limit for serving historical blocks
-    // never disconnect whitelisted nodes
-    if (send && connman->OutboundTargetReached(true) && ( ((pindexBestHeader != nullptr) && (pindexBestHeader->GetBlockTime() - pindex->GetBlockTime() > HISTORICAL_BLOCK_AGE)) || inv.type == MSG_FILTERED_BLOCK) && !pfrom->HasPermission(PF_NOBAN))
+    const CBlockIndex* pindex;
+    // Everything that needs cs_main is decided up front, so that reading the
+    // block from disk does not hold up other peers.
+    bool fPeerWantsWitness = false;
+    bool send_cmpct = false;
+    bool cache_recent = false;
+    uint256 tip_hash;
     {
-        LogPrint(BCLog::NET, "historical block serving limit reached, disconnect peer=%d\n", pfrom->GetId());
+        LOCK(cs_main);
+        pindex = LookupBlockIndex(inv.hash);
+        if (pindex) {
+            send = BlockRequestAllowed(pindex, consensusParams);
+            if (!send) {
+                LogPrint(BCLog::NET, "%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom->GetId());
+            }
+        }
+        // disconnect node in case we have reached the outbound limit for serving historical blocks
+        // never disconnect whitelisted nodes
+        if (send && connman->OutboundTargetReached(true) && ( ((pindexBestHeader != nullptr) && (pindexBestHeader->GetBlockTime() - pindex->GetBlockTime() > HISTORICAL_BLOCK_AGE)) || inv.type == MSG_FILTERED_BLOCK) && !pfrom->HasPermission(PF_NOBAN))
+        {
+            LogPrint(BCLog::NET, "historical block serving limit reached, disconnect peer=%d\n", pfrom->GetId());
 
-        //disconnect node
-        pfrom->fDisconnect = true;
-        send = false;
-    }
-    // Avoid leaking prune-height by never sending blocks below the NODE_NETWORK_LIMITED threshold
-    if (send && !pfrom->HasPermission(PF_NOBAN) && (
-            (((pfrom->GetLocalServices() & NODE_NETWORK_LIMITED) == NODE_NETWORK_LIMITED) && ((pfrom->GetLocalServices() & NODE_NETWORK) != NODE_NETWORK) && (::ChainActive().Tip()->nHeight - pindex->nHeight > (int)NODE_NETWORK_LIMITED_MIN_BLOCKS + 2 /* add two blocks buffer extension for possible races */) )
-       )) {
-        LogPrint(BCLog::NET, "Ignore block request below NODE_NETWORK_LIMITED threshold from peer=%d\n", pfrom->GetId());
+            //disconnect node
+            pfrom->fDisconnect = true;
+            send = false;
+        }
+        // Avoid leaking prune-height by never sending blocks below the NODE_NETWORK_LIMITED threshold
+        if (send && !pfrom->HasPermission(PF_NOBAN) && (
+                (((pfrom->GetLocalServices() & NODE_NETWORK_LIMITED) == NODE_NETWORK_LIMITED) && ((pfrom->GetLocalServices() & NODE_NETWORK) != NODE_NETWORK) && (::ChainActive().Tip()->nHeight - pindex->nHeight > (int)NODE_NETWORK_LIMITED_MIN_BLOCKS + 2 /* add two blocks buffer extension for possible races */) )
+           )) {
+            LogPrint(BCLog::NET, "Ignore block request below NODE_NETWORK_LIMITED threshold from peer=%d\n", pfrom->GetId());
 
-        //disconnect node and prevent it from stalling (would otherwise wait for the missing block)
-        pfrom->fDisconnect = true;
-        send = false;
-    }
-    // Pruned nodes may have deleted the block, so check whether
-    // it's available before trying to send.
-    if (send && (pindex->nStatus & BLOCK_HAVE_DATA))
+            //disconnect node and prevent it from stalling (would otherwise wait for the missing block)
+            pfrom->fDisconnect = true;
+            send = false;
+        }
+        // Pruned nodes may have deleted the block, so check whether
+        // it's available before trying to send.
+        if (send && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            send = false;
+        }
+        if (send) {
+            fPeerWantsWitness = State(pfrom->GetId())->fWantsCmpctWitness;
+            send_cmpct = CanDirectFetch(consensusParams) && pindex->nHeight >= ::ChainActive().Height() - MAX_CMPCTBLOCK_DEPTH;
+            cache_recent = pindex->nHeight >= ::ChainActive().Height() - BLOCK_SERVE_CACHE_DEPTH;
+            tip_hash = ::ChainActive().Tip()->GetBlockHash();
+        }
+    } // release cs_main
+
+    if (send)
     {
         std::shared_ptr<const CBlock> pblock;
         if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
             pblock = a_recent_block;
-        } else if (inv.type == MSG_WITNESS_BLOCK) {
-            // Fast-path: in this case it is possible to serve the block directly from disk,
-            // as the network format matches the format on disk
-            std::vector<uint8_t> block_data;
-            if (!ReadRawBlockFromDisk(block_data, pindex, chainparams.MessageStart())) {
-                assert(!"cannot load block from disk");
-            }
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(block_data)));
-            // Don't set pblock as we've sent the block
-        } else {
-            // Send block from disk
-            std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
-            if (!ReadBlockFromDisk(*pblockRead, pindex, consensusParams))
-                assert(!"cannot load block from disk");
-            pblock = pblockRead;
         }
-        if (pblock) {
-            if (inv.type == MSG_BLOCK)
-                connman->PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock));
-            else if (inv.type == MSG_WITNESS_BLOCK)
-                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
-            else if (inv.type == MSG_FILTERED_BLOCK)
-            {
-                bool sendMerkleBlock = false;
-                CMerkleBlock merkleBlock;
-                if (pfrom->m_tx_relay != nullptr) {
-                    LOCK(pfrom->m_tx_relay->cs_filter);
-                    if (pfrom->m_tx_relay->pfilter) {
-                        sendMerkleBlock = true;
-                        merkleBlock = CMerkleBlock(*pblock, *pfrom->m_tx_relay->pfilter);
-                    }
+        if (inv.type == MSG_FILTERED_BLOCK) {
+            if (!pblock) {
+                std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+                if (!ReadBlockFromDisk(*pblockRead, pindex, consensusParams)) {
+                    LogPrint(BCLog::NET, "Cannot load block %s from disk, disconnect peer=%d\n", pindex->GetBlockHash().ToString(), pfrom->GetId());
+                    pfrom->fDisconnect = true;
+                    return;
                 }
-                if (sendMerkleBlock) {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MERKLEBLOCK, merkleBlock));
-                    // CMerkleBlock just contains hashes, so also push any transactions in the block the client did not see
-                    // This avoids hurting performance by pointlessly requiring a round-trip
-                    // Note that there is currently no way for a node to request any single transactions we didn't send here -
-                    // they must either disconnect and retry or request the full block.
-                    // Thus, the protocol spec specified allows for us to provide duplicate txn here,
-                    // however we MUST always provide at least what the remote peer needs
-                    typedef std::pair<unsigned int, uint256> PairType;
-                    for (PairType& pair : merkleBlock.vMatchedTxn)
-                        connman->PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::TX, *pblock->vtx[pair.first]));
+                pblock = pblockRead;
+            }
+            bool sendMerkleBlock = false;
+            CMerkleBlock merkleBlock;
+            if (pfrom->m_tx_relay != nullptr) {
+                LOCK(pfrom->m_tx_relay->cs_filter);
+                if (pfrom->m_tx_relay->pfilter) {
+                    sendMerkleBlock = true;
+                    merkleBlock = CMerkleBlock(*pblock, *pfrom->m_tx_relay->pfilter);
                 }
-                // else
-                    // no response
             }
-            else if (inv.type == MSG_CMPCT_BLOCK)
-            {
+            if (sendMerkleBlock) {
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MERKLEBLOCK, merkleBlock));
+                // CMerkleBlock just contains hashes, so also push any transactions in the block the client did not see
+                // This avoids hurting performance by pointlessly requiring a round-trip
+                // Note that there is currently no way for a node to request any single transactions we didn't send here -
+                // they must either disconnect and retry or request the full block.
+                // Thus, the protocol spec specified allows for us to provide duplicate txn here,
+                // however we MUST always provide at least what the remote peer needs
+                typedef std::pair<unsigned int, uint256> PairType;
+                for (PairType& pair : merkleBlock.vMatchedTxn)
+                    connman->PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::TX, *pblock->vtx[pair.first]));
+            }
+            // else
+                // no response
+        } else {
+            // Full and compact blocks are serialized once and the same buffer
+            // is queued for every peer that asks for them.
+            BlockServeCache::Kind kind = BlockServeCache::Kind::BLOCK;
+            if (inv.type == MSG_BLOCK) {
+                kind = BlockServeCache::Kind::BLOCK_NO_WITNESS;
+            } else if (inv.type == MSG_CMPCT_BLOCK) {
                 // If a peer is asking for old blocks, we're almost guaranteed
                 // they won't have a useful mempool to match against a compact block,
                 // and we don't feel like constructing the object for them, so
                 // instead we respond with the full, non-compact block.
-                bool fPeerWantsWitness = State(pfrom->GetId())->fWantsCmpctWitness;
-                int nSendFlags = fPeerWantsWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
-                if (CanDirectFetch(consensusParams) && pindex->nHeight >= ::ChainActive().Height() - MAX_CMPCTBLOCK_DEPTH) {
-                    if ((fPeerWantsWitness || !fWitnessesPresentInARecentCompactBlock) && a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
-                        connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
-                    } else {
-                        CBlockHeaderAndShortTxIDs cmpctblock(*pblock, fPeerWantsWitness);
-                        connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
-                    }
+                if (send_cmpct) {
+                    kind = fPeerWantsWitness ? BlockServeCache::Kind::CMPCT : BlockServeCache::Kind::CMPCT_NO_WITNESS;
                 } else {
-                    connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::BLOCK, *pblock));
+                    kind = fPeerWantsWitness ? BlockServeCache::Kind::BLOCK : BlockServeCache::Kind::BLOCK_NO_WITNESS;
                 }
             }
+            std::shared_ptr<const CSharedNetPayload> payload = GetBlockPayload(pindex, kind, pblock, cache_recent, chainparams);
+            if (!payload) {
+                // The block may have been pruned since we checked.
+                LogPrint(BCLog::NET, "Cannot load block %s from disk, disconnect peer=%d\n", pindex->GetBlockHash().ToString(), pfrom->GetId());
+                pfrom->fDisconnect = true;
+                return;
+            }
+            const bool cmpct = kind == BlockServeCache::Kind::CMPCT || kind == BlockServeCache::Kind::CMPCT_NO_WITNESS;
+            connman->PushMessage(pfrom, CNetMsgMaker::MakeShared(cmpct ? NetMsgType::CMPCTBLOCK : NetMsgType::BLOCK, payload));
         }
 
         // Trigger the peer node to send a getblocks request for the next batch of inventory
@@ -1706,7 +1811,7 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
             // and we want it right after the last block so they don't
             // wait for other stuff first.
             std::vector<CInv> vInv;
-            vInv.push_back(CInv(MSG_BLOCK, ::ChainActive().Tip()->GetBlockHash()));
+            vInv.push_back(CInv(MSG_BLOCK, tip_hash));
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::INV, vInv));
             pfrom->hashContinue.SetNull();
         }
@@ -2077,7 +2182,7 @@ void static ProcessOrphanTx(CConnman* connman, CTxMemPool& mempool, std::set<uin
     }
 }
 
-bool ProcessMessage(CNode* pfrom, const std::string& msg_type, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CTxMemPool& mempool, CConnman* connman, BanMan* banman, const std::atomic<bool>& interruptMsgProc)
+bool ProcessMessage(CNode* pfrom, const std::string& msg_type, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CTxMemPool& mempool, CConnman* connman, BanMan* banman, const std::atomic<bool>& interruptMsgProc, std::shared_ptr<CBlock> streamed_block, CTransactionRef prepared_tx)
 {
     LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(msg_type), vRecv.size(), pfrom->GetId());
     if (gArgs.IsArgSet("-dropmessagestest") && GetRand(gArgs.GetArg("-dropmessagestest", 0)) == 0)
@@ -2328,6 +2433,16 @@ bool ProcessMessage(CNode* pfrom, const std::string& msg_type, CDataStream& vRec
             nCMPCTBLOCKVersion = 1;
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDCMPCT, fAnnounceUsingCMPCTBLOCK, nCMPCTBLOCKVersion));
         }
+        if (pfrom->m_tx_relay != nullptr && gArgs.GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION)) {
+            // Offer to reconcile transaction announcements; peers that do not
+            // know "sendrecon" ignore it and keep being flooded.
+            uint64_t salt = GetRand(std::numeric_limits<uint64_t>::max() - 1) + 1;
+            {
+                LOCK(pfrom->m_tx_relay->cs_tx_inventory);
+                pfrom->m_tx_relay->m_recon_salt = salt;
+            }
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDRECON, TXRECONCILIATION_VERSION, salt));
+        }
         pfrom->fSuccessfullyConnected = true;
         return true;
     }
@@ -2400,6 +2515,89 @@ bool ProcessMessage(CNode* pfrom, const std::string& msg_type, CDataStream& vRec
         return true;
     }
 
+    if (msg_type == NetMsgType::SENDRECON) {
+        uint32_t version = 0;
+        uint64_t remote_salt = 0;
+        vRecv >> version >> remote_salt;
+        if (pfrom->m_tx_relay == nullptr || version == 0) return true;
+        LOCK(pfrom->m_tx_relay->cs_tx_inventory);
+        // Only reconcile if we offered it as well, and set it up once per connection.
+        if (pfrom->m_tx_relay->m_recon_salt == 0 || pfrom->m_tx_relay->m_recon != nullptr) return true;
+        // The side that opened the connection starts the rounds.
+        pfrom->m_tx_relay->m_recon = MakeUnique<TxReconciliationState>(!pfrom->fInbound, pfrom->m_tx_relay->m_recon_salt, remote_salt);
+        pfrom->m_tx_relay->m_recon->m_next_request = GetTime<std::chrono::microseconds>() + (pfrom->fInbound ? RECON_RESPONDER_TIMEOUT : RECON_REQUEST_INTERVAL);
+        LogPrint(BCLog::NET, "transaction reconciliation enabled with peer=%d (%s)\n", pfrom->GetId(), pfrom->fInbound ? "responder" : "initiator");
+        return true;
+    }
+
+    if (msg_type == NetMsgType::REQRECON) {
+        uint16_t remote_size = 0;
+        vRecv >> remote_size;
+        if (pfrom->m_tx_relay == nullptr) return true;
+        LOCK(pfrom->m_tx_relay->cs_tx_inventory);
+        auto& recon = pfrom->m_tx_relay->m_recon;
+        if (recon == nullptr || recon->m_initiator) {
+            LogPrint(BCLog::NET, "unexpected reqrecon from peer=%d\n", pfrom->GetId());
+            return true;
+        }
+        if (recon->m_in_round) {
+            // The initiator gave up on the previous round.
+            FinishReconciliation(pfrom, nullptr, connman);
+        }
+        recon->TakeSnapshot();
+        recon->m_in_round = true;
+        recon->m_next_request = GetTime<std::chrono::microseconds>() + RECON_RESPONDER_TIMEOUT;
+        const ReconSketch sketch = recon->MakeSketch(TxReconciliationState::EstimateCells(recon->m_snapshot.size(), remote_size));
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SKETCH, sketch));
+        return true;
+    }
+
+    if (msg_type == NetMsgType::SKETCH) {
+        ReconSketch remote_sketch;
+        vRecv >> remote_sketch;
+        if (pfrom->m_tx_relay == nullptr) return true;
+        LOCK(pfrom->m_tx_relay->cs_tx_inventory);
+        auto& recon = pfrom->m_tx_relay->m_recon;
+        if (recon == nullptr || !recon->m_initiator || !recon->m_in_round) {
+            LogPrint(BCLog::NET, "unexpected sketch from peer=%d\n", pfrom->GetId());
+            return true;
+        }
+        std::vector<uint32_t> ours, theirs;
+        bool decoded = false;
+        if (remote_sketch.IsValid()) {
+            ReconSketch diff = recon->MakeSketch(remote_sketch.GetCells());
+            diff.Subtract(remote_sketch);
+            decoded = diff.Decode(ours, theirs);
+        }
+        if (!decoded) {
+            LogPrint(BCLog::NET, "reconciliation with peer=%d failed, flooding %u transactions\n", pfrom->GetId(), recon->m_snapshot.size());
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::RECONCILDIFF, false, std::vector<uint32_t>()));
+            FinishReconciliation(pfrom, nullptr, connman);
+            return true;
+        }
+        // Ask for what only the peer has, announce what only we have.
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::RECONCILDIFF, true, theirs));
+        const std::set<uint32_t> missing(ours.begin(), ours.end());
+        FinishReconciliation(pfrom, &missing, connman);
+        return true;
+    }
+
+    if (msg_type == NetMsgType::RECONCILDIFF) {
+        bool success = false;
+        std::vector<uint32_t> missing_ids;
+        vRecv >> success >> missing_ids;
+        if (pfrom->m_tx_relay == nullptr) return true;
+        LOCK(pfrom->m_tx_relay->cs_tx_inventory);
+        auto& recon = pfrom->m_tx_relay->m_recon;
+        if (recon == nullptr || recon->m_initiator || !recon->m_in_round) {
+            LogPrint(BCLog::NET, "unexpected reconcildiff from peer=%d\n", pfrom->GetId());
+            return true;
+        }
+        const std::set<uint32_t> missing(missing_ids.begin(), missing_ids.end());
+        FinishReconciliation(pfrom, success ? &missing : nullptr, connman);
+        return true;
+    }
+
     if (msg_type == NetMsgType::SENDCMPCT) {
         bool fAnnounceUsingCMPCTBLOCK = false;
         uint64_t nCMPCTBLOCKVersion = 0;
@@ -2594,30 +2792,33 @@ bool ProcessMessage(CNode* pfrom, const std::string& msg_type, CDataStream& vRec
             return true;
         }
 
-        LOCK(cs_main);
+        const CBlockIndex* pindex;
+        {
+            LOCK(cs_main);
 
-        const CBlockIndex* pindex = LookupBlockIndex(req.blockhash);
-        if (!pindex || !(pindex->nStatus & BLOCK_HAVE_DATA)) {
-            LogPrint(BCLog::NET, "Peer %d sent us a getblocktxn for a block we don't have\n", pfrom->GetId());
-            return true;
-        }
+            pindex = LookupBlockIndex(req.blockhash);
+            if (!pindex || !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+                LogPrint(BCLog::NET, "Peer %d sent us a getblocktxn for a block we don't have\n", pfrom->GetId());
+                return true;
+            }
 
-        if (pindex->nHeight < ::ChainActive().Height() - MAX_BLOCKTXN_DEPTH) {
-            // If an older block is requested (should never happen in practice,
-            // but can happen in tests) send a block response instead of a
-            // blocktxn response. Sending a full block response instead of a
-            // small blocktxn response is preferable in the case where a peer
-            // might maliciously send lots of getblocktxn requests to trigger
-            // expensive disk reads, because it will require the peer to
-            // actually receive all the data read from disk over the network.
-            LogPrint(BCLog::NET, "Peer %d sent us a getblocktxn for a block > %i deep\n", pfrom->GetId(), MAX_BLOCKTXN_DEPTH);
-            CInv inv;
-            inv.type = State(pfrom->GetId())->fWantsCmpctWitness ? MSG_WITNESS_BLOCK : MSG_BLOCK;
-            inv.hash = req.blockhash;
-            pfrom->vRecvGetData.push_back(inv);
-            // The message processing loop will go around again (without pausing) and we'll respond then (without cs_main)
-            return true;
-        }
+            if (pindex->nHeight < ::ChainActive().Height() - MAX_BLOCKTXN_DEPTH) {
+                // If an older block is requested (should never happen in practice,
+                // but can happen in tests) send a block response instead of a
+                // blocktxn response. Sending a full block response instead of a
+                // small blocktxn response is preferable in the case where a peer
+                // might maliciously send lots of getblocktxn requests to trigger
+                // expensive disk reads, because it will require the peer to
+                // actually receive all the data read from disk over the network.
+                LogPrint(BCLog::NET, "Peer %d sent us a getblocktxn for a block > %i deep\n", pfrom->GetId(), MAX_BLOCKTXN_DEPTH);
+                CInv inv;
+                inv.type = State(pfrom->GetId())->fWantsCmpctWitness ? MSG_WITNESS_BLOCK : MSG_BLOCK;
+                inv.hash = req.blockhash;
+                pfrom->vRecvGetData.push_back(inv);
+                // The message processing loop will go around again (without pausing) and we'll respond then (without cs_main)
+                return true;
+            }
+        } // release cs_main
 
         CBlock block;
         bool ret = ReadBlockFromDisk(block, pindex, chainparams.GetConsensus());
@@ -2705,8 +2906,9 @@ bool ProcessMessage(CNode* pfrom, const std::string& msg_type, CDataStream& vRec
             return true;
         }
 
-        CTransactionRef ptx;
-        vRecv >> ptx;
+        // Parsed already if it was part of a batch of transactions
+        CTransactionRef ptx = std::move(prepared_tx);
+        if (!ptx) vRecv >> ptx;
         const CTransaction& tx = *ptx;
 
         CInv inv(MSG_TX, tx.GetHash());
@@ -3015,7 +3217,7 @@ bool ProcessMessage(CNode* pfrom, const std::string& msg_type, CDataStream& vRec
         } // cs_main
 
         if (fProcessBLOCKTXN)
-            return ProcessMessage(pfrom, NetMsgType::BLOCKTXN, blockTxnMsg, nTimeReceived, chainparams, mempool, connman, banman, interruptMsgProc);
+            return ProcessMessage(pfrom, NetMsgType::BLOCKTXN, blockTxnMsg, nTimeReceived, chainparams, mempool, connman, banman, interruptMsgProc, nullptr, nullptr);
 
         if (fRevertToHeaderProcessing) {
             // Headers received from HB compact block peers are permitted to be
@@ -3178,8 +3380,12 @@ bool ProcessMessage(CNode* pfrom, const std::string& msg_type, CDataStream& vRec
             return true;
         }
 
-        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-        vRecv >> *pblock;
+        // Large blocks have already been deserialized while they were received.
+        std::shared_ptr<CBlock> pblock = std::move(streamed_block);
+        if (!pblock) {
+            pblock = std::make_shared<CBlock>();
+            vRecv >> *pblock;
+        }
 
         LogPrint(BCLog::NET, "received block %s peer=%d\n", pblock->GetHash().ToString(), pfrom->GetId());
 
@@ -3444,6 +3650,34 @@ bool ProcessMessage(CNode* pfrom, const std::string& msg_type, CDataStream& vRec
     return true;
 }
 
+void PeerLogicValidation::CheckStreamedBlockHeader(CNode* pfrom, const CBlockHeader& header)
+{
+    // This runs on the socket thread, so never wait for cs_main, and leave
+    // storing the header and disconnecting to the message handler thread: the
+    // complete block is validated as usual anyway. Orphans are left to the
+    // regular block processing as well.
+    TRY_LOCK(cs_main, lockMain);
+    if (!lockMain) return;
+    const CBlockIndex* pindexPrev = LookupBlockIndex(header.hashPrevBlock);
+    if (pindexPrev == nullptr) return;
+
+    BlockValidationState state;
+    if (TestBlockHeaderValidity(state, Params(), header, pindexPrev) || !state.IsInvalid()) return;
+    LogPrint(BCLog::NET, "peer=%d sent block %s with invalid header: %s\n", pfrom->GetId(), header.GetHash().ToString(), state.ToString());
+    switch (state.GetResult()) {
+    case BlockValidationResult::BLOCK_INVALID_HEADER:
+    case BlockValidationResult::BLOCK_CHECKPOINT:
+    case BlockValidationResult::BLOCK_INVALID_PREV:
+        // SendMessages disconnects the peer once this marks it for discouragement.
+        Misbehaving(pfrom->GetId(), 100, "invalid header of streamed block");
+        break;
+    default:
+        // Not necessarily the peer's fault (e.g. a timestamp too far ahead of
+        // ours); the block handler decides once the block is complete.
+        break;
+    }
+}
+
 bool PeerLogicValidation::MaybeDiscourageAndDisconnect(CNode* pnode)
 {
     AssertLockHeld(cs_main);
@@ -3474,6 +3708,54 @@ bool PeerLogicValidation::MaybeDiscourageAndDisconnect(CNode* pnode)
     return false;
 }
 
+/** Whether a message only reads chainstate and can be processed off the message handler thread. */
+static bool IsAsyncMessage(const std::string& msg_type)
+{
+    return msg_type == NetMsgType::GETHEADERS ||
+           msg_type == NetMsgType::GETBLOCKS ||
+           msg_type == NetMsgType::GETBLOCKTXN;
+}
+
+void PeerLogicValidation::PrepareProcessingRound(const std::vector<CNode*>& nodes)
+{
+    // Collect the transactions this round is going to process, i.e. those at
+    // the front of a peer's queue, with the same conditions as ProcessMessages.
+    // Each is parsed once, in place; its message then carries it to ProcessMessage.
+    std::vector<CTransactionRef> txs;
+    for (CNode* pnode : nodes) {
+        if (pnode->fDisconnect || pnode->m_async_processing || pnode->fPauseSend) continue;
+        if (!pnode->vRecvGetData.empty() || !pnode->orphan_work_set.empty()) continue;
+        if ((!g_relay_txes && !pnode->HasPermission(PF_RELAY)) || pnode->m_tx_relay == nullptr) continue;
+
+        LOCK(pnode->cs_vProcessMsg);
+        if (pnode->vProcessMsg.empty()) continue;
+        CNetMessage& msg = pnode->vProcessMsg.front();
+        // A message that is already parsed was also pre-verified already.
+        if (msg.m_command != NetMsgType::TX || !msg.m_valid_checksum || msg.m_tx) continue;
+        msg.SetVersion(pnode->GetRecvVersion());
+        const size_t payload_size = msg.m_recv.size();
+        try {
+            msg.m_recv >> msg.m_tx;
+            txs.push_back(msg.m_tx);
+        } catch (const std::exception&) {
+            // Leave the payload to fail again, and be reported, when the message is processed.
+            msg.m_tx = nullptr;
+            msg.m_recv.Rewind(payload_size - msg.m_recv.size());
+        }
+    }
+    if (txs.size() < 2) return;
+
+    // Verify their scripts together on the script check threads. Each
+    // transaction is then accepted by its own message as usual, finding its
+    // signatures in the cache, or its failure recorded so that its scripts
+    // are not verified a second time.
+    LOCK(cs_main);
+    txs.erase(std::remove_if(txs.begin(), txs.end(), [this](const CTransactionRef& ptx) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+        return AlreadyHave(CInv(MSG_TX, ptx->GetHash()), m_mempool);
+    }), txs.end());
+    PreVerifyTransactionScripts(m_mempool, txs);
+}
+
 bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
 {
     const CChainParams& chainparams = Params();
@@ -3487,8 +3769,14 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     //
     bool fMoreWork = false;
 
-    if (!pfrom->vRecvGetData.empty())
+    if (!pfrom->vRecvGetData.empty()) {
+        // Serving blocks may mean reading them from disk; hand that to a
+        // worker if there is one, so other peers are not held up.
+        if (connman->ProcessMessagesAsync(pfrom, [this, pfrom, &interruptMsgProc] { ProcessGetData(pfrom, Params(), connman, m_mempool, interruptMsgProc); })) {
+            return false;
+        }
         ProcessGetData(pfrom, chainparams, connman, m_mempool, interruptMsgProc);
+    }
 
     if (!pfrom->orphan_work_set.empty()) {
         std::list<CTransactionRef> removed_txn;
@@ -3544,7 +3832,6 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     unsigned int nMessageSize = msg.m_message_size;
 
     // Checksum
-    CDataStream& vRecv = msg.m_recv;
     if (!msg.m_valid_checksum)
     {
         LogPrint(BCLog::NET, "%s(%s, %u bytes): CHECKSUM ERROR peer=%d\n", __func__,
@@ -3552,11 +3839,30 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         return fMoreWork;
     }
 
+    // Requests that are answered from the block index or disk without
+    // changing chainstate can run on a worker, as long as the handshake is done.
+    if (pfrom->fSuccessfullyConnected && IsAsyncMessage(msg_type)) {
+        auto pmsg = std::make_shared<CNetMessage>(std::move(msg));
+        if (connman->ProcessMessagesAsync(pfrom, [this, pfrom, pmsg, &interruptMsgProc] { ProcessPeerMessage(pfrom, *pmsg, interruptMsgProc); })) {
+            return false;
+        }
+        return ProcessPeerMessage(pfrom, *pmsg, interruptMsgProc) || fMoreWork;
+    }
+
+    return ProcessPeerMessage(pfrom, msg, interruptMsgProc) || fMoreWork;
+}
+
+bool PeerLogicValidation::ProcessPeerMessage(CNode* pfrom, CNetMessage& msg, std::atomic<bool>& interruptMsgProc)
+{
+    const std::string& msg_type = msg.m_command;
+    unsigned int nMessageSize = msg.m_message_size;
+    bool fMoreWork = false;
+
     // Process message
     bool fRet = false;
     try
     {
-        fRet = ProcessMessage(pfrom, msg_type, vRecv, msg.m_time, chainparams, m_mempool, connman, m_banman, interruptMsgProc);
+        fRet = ProcessMessage(pfrom, msg_type, msg.m_recv, msg.m_time, Params(), m_mempool, connman, m_banman, interruptMsgProc, std::move(msg.m_block), std::move(msg.m_tx));
         if (interruptMsgProc)
             return false;
         if (!pfrom->vRecvGetData.empty())
@@ -3916,28 +4222,17 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                     LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", __func__,
                             vHeaders.front().GetHash().ToString(), pto->GetId());
 
-                    int nSendFlags = state.fWantsCmpctWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
-
-                    bool fGotBlockFromCache = false;
+                    std::shared_ptr<const CBlock> a_recent_block;
                     {
                         LOCK(cs_most_recent_block);
                         if (most_recent_block_hash == pBestIndex->GetBlockHash()) {
-                            if (state.fWantsCmpctWitness || !fWitnessesPresentInMostRecentCompactBlock)
-                                connman->PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *most_recent_compact_block));
-                            else {
-                                CBlockHeaderAndShortTxIDs cmpctblock(*most_recent_block, state.fWantsCmpctWitness);
-                                connman->PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
-                            }
-                            fGotBlockFromCache = true;
+                            a_recent_block = most_recent_block;
                         }
                     }
-                    if (!fGotBlockFromCache) {
-                        CBlock block;
-                        bool ret = ReadBlockFromDisk(block, pBestIndex, consensusParams);
-                        assert(ret);
-                        CBlockHeaderAndShortTxIDs cmpctblock(block, state.fWantsCmpctWitness);
-                        connman->PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
-                    }
+                    const BlockServeCache::Kind kind = state.fWantsCmpctWitness ? BlockServeCache::Kind::CMPCT : BlockServeCache::Kind::CMPCT_NO_WITNESS;
+                    std::shared_ptr<const CSharedNetPayload> payload = GetBlockPayload(pBestIndex, kind, a_recent_block, /* cache_recent */ true, Params());
+                    assert(payload);
+                    connman->PushMessage(pto, CNetMsgMaker::MakeShared(NetMsgType::CMPCTBLOCK, payload));
                     state.pindexBestHeaderSent = pBestIndex;
                 } else if (state.fPreferHeaders) {
                     if (vHeaders.size() > 1) {
@@ -4096,8 +4391,14 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                             continue;
                         }
                         if (pto->m_tx_relay->pfilter && !pto->m_tx_relay->pfilter->IsRelevantAndUpdate(*txinfo.tx)) continue;
+                        // Leave the announcement to the next reconciliation round, unless too many are queued already
+                        const bool reconcile = pto->m_tx_relay->m_recon != nullptr && pto->m_tx_relay->m_recon->m_local_set.size() < MAX_RECON_SET_SIZE;
                         // Send
-                        vInv.push_back(CInv(MSG_TX, hash));
+                        if (reconcile) {
+                            pto->m_tx_relay->m_recon->m_local_set.insert(hash);
+                        } else {
+                            vInv.push_back(CInv(MSG_TX, hash));
+                        }
                         nRelayedTransactions++;
                         {
                             // Expire old relay messages
@@ -4116,8 +4417,32 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                             connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
                             vInv.clear();
                         }
-                        pto->m_tx_relay->filterInventoryKnown.insert(hash);
+                        if (!reconcile) pto->m_tx_relay->filterInventoryKnown.insert(hash);
+                    }
+                }
+
+                // Start a reconciliation round if we are the initiating side
+                auto& recon = pto->m_tx_relay->m_recon;
+                if (recon != nullptr && recon->m_initiator && recon->m_next_request < current_time) {
+                    if (recon->m_in_round) {
+                        // The peer did not answer the previous request in time.
+                        FinishReconciliation(pto, nullptr, connman);
+                    }
+                    recon->TakeSnapshot();
+                    recon->m_in_round = true;
+                    recon->m_next_request = current_time + RECON_REQUEST_INTERVAL;
+                    connman->PushMessage(pto, msgMaker.Make(NetMsgType::REQRECON, (uint16_t)std::min<size_t>(recon->m_snapshot.size(), std::numeric_limits<uint16_t>::max())));
+                } else if (recon != nullptr && !recon->m_initiator && recon->m_next_request < current_time) {
+                    // The initiator stopped driving rounds; do not hold on to
+                    // transactions the peer may never ask about.
+                    if (recon->m_in_round) {
+                        FinishReconciliation(pto, nullptr, connman);
+                    }
+                    if (!recon->m_local_set.empty()) {
+                        recon->TakeSnapshot();
+                        FinishReconciliation(pto, nullptr, connman);
                     }
+                    recon->m_next_request = current_time + RECON_RESPONDER_TIMEOUT;
                 }
             }
         }
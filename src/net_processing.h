@@ -47,6 +47,8 @@ private:
     CTxMemPool& m_mempool;
 
     bool MaybeDiscourageAndDisconnect(CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /** Process one message and act on any misbehavior. Returns true if the peer has more work queued, e.g. getdata. */
+    bool ProcessPeerMessage(CNode* pfrom, CNetMessage& msg, std::atomic<bool>& interrupt);
 
 public:
     PeerLogicValidation(CConnman* connman, BanMan* banman, CScheduler& scheduler, CTxMemPool& pool);
@@ -73,6 +75,8 @@ public:
     void InitializeNode(CNode* pnode) override;
     /** Handle removal of a peer by updating various state and removing it from mapNodeState */
     void FinalizeNode(NodeId nodeid, bool& fUpdateConnectionTime) override;
+    /** Validate the header of a large block while its transactions are still being received */
+    void CheckStreamedBlockHeader(CNode* pfrom, const CBlockHeader& header) override;
     /**
     * Process protocol messages received from a given node
     *
@@ -80,6 +84,8 @@ public:
     * @param[in]   interrupt       Interrupt condition for processing threads
     */
     bool ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt) override;
+    /** Verify the scripts of the transactions about to be processed in one round of ProcessMessages calls together */
+    void PrepareProcessingRound(const std::vector<CNode*>& nodes) override;
     /**
     * Send queued protocol messages to be sent to a give node.
     *
@@ -482,6 +482,11 @@ bool CBlockPolicyEstimator::removeTx(uint256 hash, bool inBlock)
         shortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         longStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         mapMemPoolTxs.erase(hash);
+        std::map<uint256, TxStatsInfo>::iterator gasPos = mapMemPoolGasTxs.find(hash);
+        if (gasPos != mapMemPoolGasTxs.end()) {
+            gasStats->removeTx(gasPos->second.blockHeight, nBestSeenHeight, gasPos->second.bucketIndex, inBlock);
+            mapMemPoolGasTxs.erase(gasPos);
+        }
         return true;
     } else {
         return false;
@@ -489,7 +494,8 @@ bool CBlockPolicyEstimator::removeTx(uint256 hash, bool inBlock)
 }
 
 CBlockPolicyEstimator::CBlockPolicyEstimator()
-    : nBestSeenHeight(0), firstRecordedHeight(0), historicalFirst(0), historicalBest(0), trackedTxs(0), untrackedTxs(0)
+    : nBestSeenHeight(0), firstRecordedHeight(0), historicalFirst(0), historicalBest(0), trackedTxs(0), untrackedTxs(0),
+      firstGasRecordedHeight(0), gasUtilizationSum(0), gasUtilizationWeight(0)
 {
     static_assert(MIN_BUCKET_FEERATE > 0, "Min feerate must be nonzero");
     size_t bucketIndex = 0;
@@ -504,6 +510,18 @@ CBlockPolicyEstimator::CBlockPolicyEstimator()
     feeStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
     shortStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
     longStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
+
+    static_assert(MIN_BUCKET_GASPRICE > 0, "Min gas price must be nonzero");
+    bucketIndex = 0;
+    for (double bucketBoundary = MIN_BUCKET_GASPRICE; bucketBoundary <= MAX_BUCKET_GASPRICE; bucketBoundary *= GAS_PRICE_SPACING, bucketIndex++) {
+        gasBuckets.push_back(bucketBoundary);
+        gasBucketMap[bucketBoundary] = bucketIndex;
+    }
+    gasBuckets.push_back(INF_FEERATE);
+    gasBucketMap[INF_FEERATE] = bucketIndex;
+    assert(gasBucketMap.size() == gasBuckets.size());
+
+    gasStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(gasBuckets, gasBucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
 }
 
 CBlockPolicyEstimator::~CBlockPolicyEstimator()
@@ -547,6 +565,12 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     assert(bucketIndex == bucketIndex2);
     unsigned int bucketIndex3 = longStats->NewTx(txHeight, (double)feeRate.GetFeePerK());
     assert(bucketIndex == bucketIndex3);
+
+    // Contract transactions are also tracked by the lowest gas price of their executions
+    if (entry.GetTx().HasCreateOrCall() && entry.GetMinGasPrice() > 0) {
+        mapMemPoolGasTxs[hash].blockHeight = txHeight;
+        mapMemPoolGasTxs[hash].bucketIndex = gasStats->NewTx(txHeight, (double)entry.GetMinGasPrice());
+    }
 }
 
 bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry)
@@ -556,11 +580,6 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
         return false;
     }
 
-    if(entry->GetTx().HasCreateOrCall()){
-    	//Exclude contract transactions
-    	return false;
-    }
-
     // How many blocks did it take for miners to include this transaction?
     // blocksToConfirm is 1-based, so a transaction included in the earliest
     // possible block has confirmation count of 1
@@ -572,6 +591,14 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
         return false;
     }
 
+    if(entry->GetTx().HasCreateOrCall()){
+        // Contract transactions are ordered by gas price, not feerate
+        if (entry->GetMinGasPrice() > 0) {
+            gasStats->Record(blocksToConfirm, (double)entry->GetMinGasPrice());
+        }
+        return false;
+    }
+
     // Feerates are stored and reported as BTC-per-kb:
     CFeeRate feeRate(entry->GetFee(), entry->GetTxSize());
 
@@ -603,23 +630,33 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     feeStats->ClearCurrent(nBlockHeight);
     shortStats->ClearCurrent(nBlockHeight);
     longStats->ClearCurrent(nBlockHeight);
+    gasStats->ClearCurrent(nBlockHeight);
 
     // Decay all exponential averages
     feeStats->UpdateMovingAverages();
     shortStats->UpdateMovingAverages();
     longStats->UpdateMovingAverages();
+    gasStats->UpdateMovingAverages();
 
     unsigned int countedTxs = 0;
+    unsigned int countedGasTxs = 0;
     // Update averages with data points from current block
     for (const auto& entry : entries) {
+        const bool gasTracked = mapMemPoolGasTxs.count(entry->GetTx().GetHash());
         if (processBlockTx(nBlockHeight, entry))
             countedTxs++;
+        else if (gasTracked)
+            countedGasTxs++;
     }
 
     if (firstRecordedHeight == 0 && countedTxs > 0) {
         firstRecordedHeight = nBestSeenHeight;
         LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy first recorded height %u\n", firstRecordedHeight);
     }
+    if (firstGasRecordedHeight == 0 && countedGasTxs > 0) {
+        firstGasRecordedHeight = nBestSeenHeight;
+        LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy first recorded gas price height %u\n", firstGasRecordedHeight);
+    }
 
 
     LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy estimates updated by %u of %u block txs, since last block %u of %u tracked, mempool map size %u, max target %u from %s\n",
@@ -630,6 +667,19 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     untrackedTxs = 0;
 }
 
+void CBlockPolicyEstimator::processBlockGas(unsigned int nBlockHeight, uint64_t gasUsed, uint64_t gasLimit)
+{
+    LOCK(m_cs_fee_estimator);
+    // The block is processed before its transactions leave the mempool, so
+    // anything at or below the best seen height is a side chain or re-org.
+    if (nBlockHeight <= nBestSeenHeight || gasLimit == 0) {
+        return;
+    }
+
+    gasUtilizationSum = gasUtilizationSum * GAS_UTILIZATION_DECAY + std::min(1.0, (double)gasUsed / gasLimit);
+    gasUtilizationWeight = gasUtilizationWeight * GAS_UTILIZATION_DECAY + 1;
+}
+
 CFeeRate CBlockPolicyEstimator::estimateFee(int confTarget) const
 {
     // It's not possible to get reasonable estimates for confTarget of 1
@@ -696,6 +746,12 @@ unsigned int CBlockPolicyEstimator::HighestTargetTracked(FeeEstimateHorizon hori
     }
 }
 
+unsigned int CBlockPolicyEstimator::HighestGasTargetTracked() const
+{
+    LOCK(m_cs_fee_estimator);
+    return gasStats->GetMaxConfirms();
+}
+
 unsigned int CBlockPolicyEstimator::BlockSpan() const
 {
     if (firstRecordedHeight == 0) return 0;
@@ -720,6 +776,15 @@ unsigned int CBlockPolicyEstimator::MaxUsableEstimate() const
     return std::min(longStats->GetMaxConfirms(), std::max(BlockSpan(), HistoricalBlockSpan()) / 2);
 }
 
+unsigned int CBlockPolicyEstimator::MaxUsableGasEstimate() const
+{
+    if (firstGasRecordedHeight == 0) return 0;
+    assert(nBestSeenHeight >= firstGasRecordedHeight);
+
+    // As for feerates, leave room for failing data points at the target
+    return std::min(gasStats->GetMaxConfirms(), (nBestSeenHeight - firstGasRecordedHeight) / 2);
+}
+
 /** Return a fee estimate at the required successThreshold from the shortest
  * time horizon which tracks confirmations up to the desired target.  If
  * checkShorterHorizon is requested, also allow short time horizon estimates
@@ -865,6 +930,81 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
     return CFeeRate(llround(median));
 }
 
+CAmount CBlockPolicyEstimator::estimateSmartGasPrice(int confTarget, CAmount minGasPrice, FeeCalculation *feeCalc, bool conservative) const
+{
+    LOCK(m_cs_fee_estimator);
+
+    if (feeCalc) {
+        feeCalc->desiredTarget = confTarget;
+        feeCalc->returnedTarget = confTarget;
+    }
+
+    // Return failure if trying to analyze a target we're not tracking
+    if (confTarget <= 0 || (unsigned int)confTarget > gasStats->GetMaxConfirms()) {
+        return 0;  // error condition
+    }
+
+    // It's not possible to get reasonable estimates for confTarget of 1
+    if (confTarget == 1) confTarget = 2;
+    if (feeCalc) feeCalc->returnedTarget = confTarget;
+
+    double median = -1;
+    const unsigned int maxUsableEstimate = MaxUsableGasEstimate();
+    const int usableTarget = std::min<int>(confTarget, maxUsableEstimate);
+    if (usableTarget > 1) {
+        // All three thresholds come from the single medium horizon, the
+        // conservative estimate additionally has to hold at twice the target.
+        EstimationResult tempResult;
+        double halfEst = gasStats->EstimateMedianVal(usableTarget / 2, SUFFICIENT_FEETXS, HALF_SUCCESS_PCT, true, nBestSeenHeight, &tempResult);
+        if (feeCalc) {
+            feeCalc->est = tempResult;
+            feeCalc->reason = FeeReason::HALF_ESTIMATE;
+        }
+        median = halfEst;
+        double actualEst = gasStats->EstimateMedianVal(usableTarget, SUFFICIENT_FEETXS, SUCCESS_PCT, true, nBestSeenHeight, &tempResult);
+        if (actualEst > median) {
+            median = actualEst;
+            if (feeCalc) {
+                feeCalc->est = tempResult;
+                feeCalc->reason = FeeReason::FULL_ESTIMATE;
+            }
+        }
+        if (conservative && (unsigned int)(2 * usableTarget) <= gasStats->GetMaxConfirms()) {
+            double doubleEst = gasStats->EstimateMedianVal(2 * usableTarget, SUFFICIENT_FEETXS, DOUBLE_SUCCESS_PCT, true, nBestSeenHeight, &tempResult);
+            if (doubleEst > median) {
+                median = doubleEst;
+                if (feeCalc) {
+                    feeCalc->est = tempResult;
+                    feeCalc->reason = FeeReason::DOUBLE_ESTIMATE;
+                }
+            }
+        }
+    }
+
+    if (median >= 0) {
+        if (feeCalc) feeCalc->returnedTarget = usableTarget;
+        if (median > minGasPrice) return llround(median);
+        if (feeCalc) feeCalc->reason = FeeReason::MIN_GAS_PRICE;
+        return minGasPrice;
+    }
+
+    // Without enough contract transactions to go by, blocks that leave most of
+    // their gas limit unused take anything paying the minimum gas price.
+    if (gasUtilizationWeight > 0 && gasUtilizationSum / gasUtilizationWeight < GAS_UTILIZATION_CONGESTED) {
+        if (feeCalc) feeCalc->reason = FeeReason::MIN_GAS_PRICE;
+        return minGasPrice;
+    }
+
+    return 0; // error condition
+}
+
+double CBlockPolicyEstimator::GetBlockGasUtilization() const
+{
+    LOCK(m_cs_fee_estimator);
+    if (gasUtilizationWeight <= 0) return -1;
+    return gasUtilizationSum / gasUtilizationWeight;
+}
+
 
 bool CBlockPolicyEstimator::Write(CAutoFile& fileout) const
 {
@@ -883,6 +1023,10 @@ bool CBlockPolicyEstimator::Write(CAutoFile& fileout) const
         feeStats->Write(fileout);
         shortStats->Write(fileout);
         longStats->Write(fileout);
+        // Gas price data is appended so that older versions can still read the file
+        fileout << gasBuckets;
+        gasStats->Write(fileout);
+        fileout << firstGasRecordedHeight << gasUtilizationSum << gasUtilizationWeight;
     }
     catch (const std::exception&) {
         LogPrintf("CBlockPolicyEstimator::Write(): unable to write policy estimator data (non-fatal)\n");
@@ -926,6 +1070,27 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
             fileShortStats->Read(filein, nVersionThatWrote, numBuckets);
             fileLongStats->Read(filein, nVersionThatWrote, numBuckets);
 
+            // Files written before gas prices were tracked end here, leave
+            // the gas price estimator empty for those.
+            std::vector<double> fileGasBuckets;
+            std::unique_ptr<TxConfirmStats> fileGasStats;
+            unsigned int nFileFirstGasRecordedHeight = 0;
+            double fileGasUtilizationSum = 0, fileGasUtilizationWeight = 0;
+            try {
+                filein >> fileGasBuckets;
+                size_t numGasBuckets = fileGasBuckets.size();
+                if (numGasBuckets <= 1 || numGasBuckets > 1000)
+                    throw std::runtime_error("Corrupt estimates file. Must have between 2 and 1000 gas price buckets");
+                fileGasStats.reset(new TxConfirmStats(gasBuckets, gasBucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
+                fileGasStats->Read(filein, nVersionThatWrote, numGasBuckets);
+                filein >> nFileFirstGasRecordedHeight >> fileGasUtilizationSum >> fileGasUtilizationWeight;
+                if (nFileFirstGasRecordedHeight > nFileBestSeenHeight || fileGasUtilizationSum < 0 || fileGasUtilizationSum > fileGasUtilizationWeight)
+                    throw std::runtime_error("Corrupt estimates file. Gas price data is invalid");
+            } catch (const std::exception& e) {
+                LogPrintf("CBlockPolicyEstimator::Read(): no gas price estimation data (non-fatal): %s\n", e.what());
+                fileGasStats.reset();
+            }
+
             // Fee estimates file parsed correctly
             // Copy buckets from file and refresh our bucketmap
             buckets = fileBuckets;
@@ -939,6 +1104,18 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
             shortStats = std::move(fileShortStats);
             longStats = std::move(fileLongStats);
 
+            if (fileGasStats) {
+                gasBuckets = fileGasBuckets;
+                gasBucketMap.clear();
+                for (unsigned int i = 0; i < gasBuckets.size(); i++) {
+                    gasBucketMap[gasBuckets[i]] = i;
+                }
+                gasStats = std::move(fileGasStats);
+                firstGasRecordedHeight = nFileFirstGasRecordedHeight;
+                gasUtilizationSum = fileGasUtilizationSum;
+                gasUtilizationWeight = fileGasUtilizationWeight;
+            }
+
             nBestSeenHeight = nFileBestSeenHeight;
             historicalFirst = nFileHistoricalFirst;
             historicalBest = nFileHistoricalBest;
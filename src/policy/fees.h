@@ -43,6 +43,7 @@ enum class FeeReason {
     PAYTXFEE,
     FALLBACK,
     REQUIRED,
+    MIN_GAS_PRICE,
 };
 
 /* Used to determine type of fee estimation requested */
@@ -179,6 +180,21 @@ private:
      */
     static constexpr double FEE_SPACING = 1.05;
 
+    /** Minimum and Maximum values for tracking gas prices of contract
+     * transactions, in satoshis per unit of gas. The DGP minimum gas price
+     * is bounded to the same range. */
+    static constexpr double MIN_BUCKET_GASPRICE = 1;
+    static constexpr double MAX_BUCKET_GASPRICE = 1e5;
+
+    /** Spacing of gas price buckets */
+    static constexpr double GAS_PRICE_SPACING = 1.05;
+
+    /** Decay of the moving average of block gas utilization, same as the short horizon */
+    static constexpr double GAS_UTILIZATION_DECAY = SHORT_DECAY;
+    /** Below this average share of the block gas limit in use, blocks are taken
+     * to have room for any contract transaction paying the minimum gas price */
+    static constexpr double GAS_UTILIZATION_CONGESTED = .5;
+
 public:
     /** Create new BlockPolicyEstimator and initialize stats tracking classes with default values */
     CBlockPolicyEstimator();
@@ -188,6 +204,9 @@ public:
     void processBlock(unsigned int nBlockHeight,
                       std::vector<const CTxMemPoolEntry*>& entries);
 
+    /** Process the gas used by the contract executions of a block about to be connected */
+    void processBlockGas(unsigned int nBlockHeight, uint64_t gasUsed, uint64_t gasLimit);
+
     /** Process a transaction accepted to the mempool*/
     void processTransaction(const CTxMemPoolEntry& entry, bool validFeeEstimate);
 
@@ -210,6 +229,21 @@ public:
      */
     CFeeRate estimateRawFee(int confTarget, double successThreshold, FeeEstimateHorizon horizon, EstimationResult *result = nullptr) const;
 
+    /** Estimate the gas price, in satoshis per unit of gas, a contract
+     *  transaction needs to be included in a block within confTarget blocks.
+     *  The answer is never below minGasPrice, the current DGP minimum, which
+     *  is also returned when there are too few contract transactions to go
+     *  by but blocks are far from their gas limit. Returns 0 if no estimate
+     *  can be given.
+     */
+    CAmount estimateSmartGasPrice(int confTarget, CAmount minGasPrice, FeeCalculation *feeCalc, bool conservative) const;
+
+    /** Moving average of the share of the block gas limit used by recent blocks, or -1 if none were seen */
+    double GetBlockGasUtilization() const;
+
+    /** Calculation of highest target that gas price estimates are tracked for */
+    unsigned int HighestGasTargetTracked() const;
+
     /** Write estimation data to a file */
     bool Write(CAutoFile& fileout) const;
 
@@ -251,6 +285,20 @@ private:
     std::vector<double> buckets GUARDED_BY(m_cs_fee_estimator); // The upper-bound of the range for the bucket (inclusive)
     std::map<double, unsigned int> bucketMap GUARDED_BY(m_cs_fee_estimator); // Map of bucket upper-bound to index into all vectors by bucket
 
+    // map of txids of contract transactions to information about their gas price
+    std::map<uint256, TxStatsInfo> mapMemPoolGasTxs GUARDED_BY(m_cs_fee_estimator);
+
+    /** Confirmation history of contract transactions by gas price, over the medium horizon */
+    std::unique_ptr<TxConfirmStats> gasStats PT_GUARDED_BY(m_cs_fee_estimator);
+
+    std::vector<double> gasBuckets GUARDED_BY(m_cs_fee_estimator); // Upper-bounds of the gas price buckets
+    std::map<double, unsigned int> gasBucketMap GUARDED_BY(m_cs_fee_estimator);
+
+    unsigned int firstGasRecordedHeight GUARDED_BY(m_cs_fee_estimator);
+    /** Decaying sums of block gas utilization and of the number of blocks it was taken over */
+    double gasUtilizationSum GUARDED_BY(m_cs_fee_estimator);
+    double gasUtilizationWeight GUARDED_BY(m_cs_fee_estimator);
+
     /** Process a transaction confirmed in a block*/
     bool processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry) EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
 
@@ -264,6 +312,8 @@ private:
     unsigned int HistoricalBlockSpan() const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Calculation of highest target that reasonable estimate can be provided for */
     unsigned int MaxUsableEstimate() const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+    /** Calculation of highest target that a reasonable gas price estimate can be provided for */
+    unsigned int MaxUsableGasEstimate() const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
 };
 
 class FeeFilterRounder
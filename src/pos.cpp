@@ -10,6 +10,7 @@
 #include <validation.h>
 #include <arith_uint256.h>
 #include <hash.h>
+#include <crypto/sha256.h>
 #include <timedata.h>
 #include <chainparams.h>
 #include <script/sign.h>
@@ -62,13 +63,9 @@ uint256 ComputeStakeModifier(const CBlockIndex* pindexPrev, const uint256& kerne
 //   quantities so as to generate blocks faster, degrading the system back into
 //   a proof-of-work situation.
 //
-bool CheckStakeKernelHash(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t blockFromTime, CAmount prevoutValue, const COutPoint& prevout, unsigned int nTimeBlock, uint256& hashProofOfStake, uint256& targetProofOfStake, bool fPrintProofOfStake)
+// Check whether a kernel hash meets the target weighted by the value of the prevout
+static bool CheckStakeKernelTarget(int nHeight, unsigned int nBits, CAmount prevoutValue, const uint256& hashProofOfStake, uint256& targetProofOfStake)
 {
-    if (nTimeBlock < blockFromTime)  // Transaction timestamp violation
-        return error("CheckStakeKernelHash() : nTime violation");
-
-    // Get height
-    int nHeight = pindexPrev->nHeight + 1;
     bool fNoBNOverflow = nHeight >= Params().GetConsensus().nReduceBlocktimeHeight;
 
     // Base target
@@ -83,6 +80,22 @@ bool CheckStakeKernelHash(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t
 
     targetProofOfStake = ArithToUint256(bnTarget);
 
+    // Now check if proof-of-stake hash meets target protocol
+    arith_uint256 bnProofOfStake = UintToArith256(hashProofOfStake);
+    if(fNoBNOverflow)
+        bnProofOfStake /= bnWeight;
+
+    return bnProofOfStake <= bnTarget;
+}
+
+bool CheckStakeKernelHash(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t blockFromTime, CAmount prevoutValue, const COutPoint& prevout, unsigned int nTimeBlock, uint256& hashProofOfStake, uint256& targetProofOfStake, bool fPrintProofOfStake)
+{
+    if (nTimeBlock < blockFromTime)  // Transaction timestamp violation
+        return error("CheckStakeKernelHash() : nTime violation");
+
+    // Get height
+    int nHeight = pindexPrev->nHeight + 1;
+
     uint256 nStakeModifier = pindexPrev->nStakeModifier;
 
     // Calculate hash
@@ -99,12 +112,7 @@ bool CheckStakeKernelHash(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t
             hashProofOfStake.ToString());
     }
 
-    // Now check if proof-of-stake hash meets target protocol
-    arith_uint256 bnProofOfStake = UintToArith256(hashProofOfStake);
-    if(fNoBNOverflow)
-        bnProofOfStake /= bnWeight;
-
-    if (bnProofOfStake > bnTarget)
+    if (!CheckStakeKernelTarget(nHeight, nBits, prevoutValue, hashProofOfStake, targetProofOfStake))
         return false;
 
     if (LogInstance().WillLogCategory(BCLog::COINSTAKE) && !fPrintProofOfStake)
@@ -456,6 +464,45 @@ bool CheckKernelCache(CBlockIndex *pindexPrev, unsigned int nBits, uint32_t nTim
     return false;
 }
 
+void CheckKernelCacheBatch(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const std::vector<COutPoint>& prevouts, size_t from, size_t to, const std::map<COutPoint, CStakeCache>& cache, std::vector<std::pair<size_t, uint256>>& found)
+{
+    int nHeight = pindexPrev->nHeight + 1;
+    const uint256& nStakeModifier = pindexPrev->nStakeModifier;
+
+    // Serialize the kernels back to back, they all have the same size
+    CDataStream ss(SER_GETHASH, 0);
+    std::vector<size_t> indexes;
+    std::vector<CAmount> amounts;
+    for(size_t i = from; i < to; i++)
+    {
+        const COutPoint& prevout = prevouts[i];
+        auto it = cache.find(prevout);
+        if(it == cache.end() || nTimeBlock < it->second.blockFromTime)
+            continue;
+        ss << nStakeModifier;
+        ss << it->second.blockFromTime << prevout.hash << prevout.n << nTimeBlock;
+        indexes.push_back(i);
+        amounts.push_back(it->second.amount);
+    }
+    if(indexes.empty())
+        return;
+
+    const size_t kernelSize = ss.size() / indexes.size();
+    assert(kernelSize * indexes.size() == ss.size());
+    std::vector<unsigned char> hashes(32 * indexes.size());
+    SHA256D(hashes.data(), (const unsigned char*)ss.data(), kernelSize, indexes.size());
+
+    for(size_t j = 0; j < indexes.size(); j++)
+    {
+        uint256 hashProofOfStake, targetProofOfStake;
+        std::copy(hashes.begin() + 32 * j, hashes.begin() + 32 * (j + 1), hashProofOfStake.begin());
+        if(CheckStakeKernelTarget(nHeight, nBits, amounts[j], hashProofOfStake, targetProofOfStake))
+        {
+            found.emplace_back(indexes[j], hashProofOfStake);
+        }
+    }
+}
+
 void CacheKernel(std::map<COutPoint, CStakeCache>& cache, const COutPoint& prevout, CBlockIndex* pindexPrev, CCoinsViewCache& view){
     if(cache.find(prevout) != cache.end()){
         //already in cache
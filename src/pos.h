@@ -53,6 +53,10 @@ bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBloc
 bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint& prevout, CCoinsViewCache& view, const std::map<COutPoint, CStakeCache>& cache);
 bool CheckKernelCache(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint& prevout, const std::map<COutPoint, CStakeCache>& cache, uint256& hashProofOfStake);
 
+// Batched CheckKernelCache() over prevouts[from, to), hashing the kernels together
+// Appends the index and hashProofOfStake of every prevout whose kernel meets the target
+void CheckKernelCacheBatch(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const std::vector<COutPoint>& prevouts, size_t from, size_t to, const std::map<COutPoint, CStakeCache>& cache, std::vector<std::pair<size_t, uint256>>& found);
+
 unsigned int GetStakeMaxCombineInputs();
 
 int64_t GetStakeCombineThreshold();
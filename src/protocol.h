@@ -234,6 +234,28 @@ extern const char *GETBLOCKTXN;
  * @since protocol version 70014 as described by BIP 152
  */
 extern const char *BLOCKTXN;
+/**
+ * Contains a 4-byte version number and an 8-byte salt.
+ * Indicates that a node is willing to reconcile transaction announcements
+ * instead of flooding them; sent after "verack" when -txreconciliation is set.
+ */
+extern const char *SENDRECON;
+/**
+ * Contains the 2-byte size of the sender's reconciliation set.
+ * Sent by the side that opened the connection to start a reconciliation round.
+ * Peer should respond with a "sketch" message.
+ */
+extern const char *REQRECON;
+/**
+ * Contains a sketch of the short ids of the sender's reconciliation set.
+ * Sent in response to a "reqrecon" message.
+ */
+extern const char *SKETCH;
+/**
+ * Contains a 1-byte success flag and the short ids the sender is missing.
+ * Sent after decoding a "sketch"; on failure both sides flood their sets.
+ */
+extern const char *RECONCILDIFF;
 };
 
 /* Get a vector of all valid message types (see above) */
@@ -62,89 +62,11 @@ class TokenTxWorker : public QObject
     Q_OBJECT
 public:
     WalletModel *walletModel;
-    bool first;
     Token tokenAbi;
     TokenTxWorker(WalletModel *_walletModel):
-        walletModel(_walletModel), first(true) {}
+        walletModel(_walletModel) {}
 
 private Q_SLOTS:
-    void updateTokenTx(const QString &hash)
-    {
-        if(walletModel && walletModel->node().shutdownRequested())
-            return;
-
-        // Initialize variables
-        uint256 tokenHash = uint256S(hash.toStdString());
-        int64_t fromBlock = 0;
-        int64_t toBlock = -1;
-        interfaces::TokenInfo tokenInfo;
-        uint256 blockHash;
-        bool found = false;
-
-        int64_t backInPast = first ? Params().GetConsensus().MaxCheckpointSpan() : 10;
-        first = false;
-
-        // Get current height and block hash
-        toBlock = walletModel->node().getNumBlocks();
-        blockHash = walletModel->node().getBlockHash(toBlock);
-
-        if(toBlock > -1)
-        {
-            // Find the token tx in the wallet
-            tokenInfo = walletModel->wallet().getToken(tokenHash);
-            found = tokenInfo.hash == tokenHash;
-            if(found)
-            {
-                // Get the start location for search the event log
-                if(tokenInfo.block_number < toBlock)
-                {
-                    if(walletModel->node().getBlockHash(tokenInfo.block_number) == tokenInfo.block_hash)
-                    {
-                        fromBlock = tokenInfo.block_number;
-                    }
-                    else
-                    {
-                        fromBlock = tokenInfo.block_number - backInPast;
-                    }
-                }
-                else
-                {
-                    fromBlock = toBlock - backInPast;
-                }
-                if(fromBlock < 0)
-                    fromBlock = 0;
-
-                tokenInfo.block_hash = blockHash;
-                tokenInfo.block_number = toBlock;
-            }
-        }
-
-        if(found)
-        {
-            // List the events and update the token tx
-            std::vector<TokenEvent> tokenEvents;
-            tokenAbi.setAddress(tokenInfo.contract_address);
-            tokenAbi.setSender(tokenInfo.sender_address);
-            tokenAbi.transferEvents(tokenEvents, fromBlock, toBlock);
-            tokenAbi.burnEvents(tokenEvents, fromBlock, toBlock);
-            for(size_t i = 0; i < tokenEvents.size(); i++)
-            {
-                TokenEvent event = tokenEvents[i];
-                interfaces::TokenTx tokenTx;
-                tokenTx.contract_address = event.address;
-                tokenTx.sender_address = event.sender;
-                tokenTx.receiver_address = event.receiver;
-                tokenTx.value = event.value;
-                tokenTx.tx_hash = event.transactionHash;
-                tokenTx.block_hash = event.blockHash;
-                tokenTx.block_number = event.blockNumber;
-                walletModel->wallet().addTokenTxEntry(tokenTx, false);
-            }
-
-            walletModel->wallet().addTokenEntry(tokenInfo);
-        }
-    }
-
     void cleanTokenTxEntries()
     {
         if(walletModel && walletModel->node().shutdownRequested())
@@ -456,24 +378,12 @@ void TokenItemModel::checkTokenBalanceChanged()
         updateBalance(tokenEntry);
     }
 
-    // Update token transactions
-    if(fLogEvents)
+    // Token transactions are recorded by the wallet as blocks connect,
+    // clean the duplicated entries once
+    if(fLogEvents && !tokenTxCleaned)
     {
-        // Search for token transactions
-        for(int i = 0; i < priv->cachedTokenItem.size(); i++)
-        {
-            TokenItemEntry tokenEntry = priv->cachedTokenItem[i];
-            QString hash = QString::fromStdString(tokenEntry.hash.ToString());
-            QMetaObject::invokeMethod(worker, "updateTokenTx", Qt::QueuedConnection,
-                                      Q_ARG(QString, hash));
-        }
-
-        // Clean token transactions
-        if(!tokenTxCleaned)
-        {
-            tokenTxCleaned = true;
-            QMetaObject::invokeMethod(worker, "cleanTokenTxEntries", Qt::QueuedConnection);
-        }
+        tokenTxCleaned = true;
+        QMetaObject::invokeMethod(worker, "cleanTokenTxEntries", Qt::QueuedConnection);
     }
 }
 
@@ -8,19 +8,23 @@
 #include <core_io.h>
 #include <httpserver.h>
 #include <index/txindex.h>
+#include <key_io.h>
 #include <node/context.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <rpc/blockchain.h>
+#include <rpc/contract_util.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <streams.h>
 #include <sync.h>
 #include <txmempool.h>
 #include <util/check.h>
+#include <util/convert.h>
 #include <util/strencodings.h>
 #include <validation.h>
 #include <version.h>
+#include <yupost/storageresults.h>
 
 #include <boost/algorithm/string.hpp>
 
@@ -64,6 +68,143 @@ struct CCoin {
     }
 };
 
+/** Log entry of a contract receipt, in the binary REST format */
+struct CRestLogEntry {
+    uint160 address;
+    std::vector<uint256> topics;
+    std::vector<unsigned char> data;
+
+    ADD_SERIALIZE_METHODS;
+
+    CRestLogEntry() {}
+    explicit CRestLogEntry(const dev::eth::LogEntry& log) : address(h160Touint(log.address)), data(log.data)
+    {
+        for (const dev::h256& topic : log.topics) {
+            topics.push_back(h256Touint(topic));
+        }
+    }
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(address);
+        READWRITE(topics);
+        READWRITE(data);
+    }
+};
+
+/** Contract receipt, in the binary REST format */
+struct CRestReceipt {
+    uint256 blockHash;
+    uint32_t blockNumber{0};
+    uint256 transactionHash;
+    uint32_t transactionIndex{0};
+    uint32_t outputIndex{0};
+    uint160 from;
+    uint160 to;
+    uint64_t cumulativeGasUsed{0};
+    uint64_t gasUsed{0};
+    uint160 contractAddress;
+    uint32_t excepted{0};
+    std::string exceptedMessage;
+    std::vector<unsigned char> bloom;
+    uint256 stateRoot;
+    uint256 utxoRoot;
+    std::vector<CRestLogEntry> logs;
+
+    ADD_SERIALIZE_METHODS;
+
+    CRestReceipt() {}
+    explicit CRestReceipt(const TransactionReceiptInfo& info)
+        : blockHash(info.blockHash), blockNumber(info.blockNumber),
+          transactionHash(info.transactionHash), transactionIndex(info.transactionIndex),
+          outputIndex(info.outputIndex), from(h160Touint(info.from)), to(h160Touint(info.to)),
+          cumulativeGasUsed(info.cumulativeGasUsed), gasUsed(info.gasUsed),
+          contractAddress(h160Touint(info.contractAddress)), excepted(static_cast<uint32_t>(info.excepted)),
+          exceptedMessage(info.exceptedMessage), bloom(info.bloom.asBytes()),
+          stateRoot(h256Touint(info.stateRoot)), utxoRoot(h256Touint(info.utxoRoot))
+    {
+        for (const dev::eth::LogEntry& log : info.logs) {
+            logs.emplace_back(log);
+        }
+    }
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(blockHash);
+        READWRITE(blockNumber);
+        READWRITE(transactionHash);
+        READWRITE(transactionIndex);
+        READWRITE(outputIndex);
+        READWRITE(from);
+        READWRITE(to);
+        READWRITE(cumulativeGasUsed);
+        READWRITE(gasUsed);
+        READWRITE(contractAddress);
+        READWRITE(excepted);
+        READWRITE(exceptedMessage);
+        READWRITE(bloom);
+        READWRITE(stateRoot);
+        READWRITE(utxoRoot);
+        READWRITE(logs);
+    }
+};
+
+/** Address index entry, in the binary REST format */
+struct CRestAddressDelta {
+    uint256 txid;
+    uint32_t index{0};
+    int32_t height{0};
+    uint32_t blockindex{0};
+    int64_t satoshis{0};
+
+    ADD_SERIALIZE_METHODS;
+
+    CRestAddressDelta() {}
+    explicit CRestAddressDelta(const std::pair<CAddressIndexKey, CAmount>& entry)
+        : txid(entry.first.txhash), index(entry.first.index), height(entry.first.blockHeight),
+          blockindex(entry.first.txindex), satoshis(entry.second) {}
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(txid);
+        READWRITE(index);
+        READWRITE(height);
+        READWRITE(blockindex);
+        READWRITE(satoshis);
+    }
+};
+
+/** Unspent output of an address, in the binary REST format */
+struct CRestAddressUtxo {
+    uint256 txid;
+    uint32_t index{0};
+    int64_t satoshis{0};
+    CScript script;
+    int32_t height{0};
+    bool isStake{false};
+
+    ADD_SERIALIZE_METHODS;
+
+    CRestAddressUtxo() {}
+    explicit CRestAddressUtxo(const std::pair<CAddressUnspentKey, CAddressUnspentValue>& entry)
+        : txid(entry.first.txhash), index(entry.first.index), satoshis(entry.second.satoshis),
+          script(entry.second.script), height(entry.second.blockHeight), isStake(entry.second.coinStake) {}
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(txid);
+        READWRITE(index);
+        READWRITE(satoshis);
+        READWRITE(script);
+        READWRITE(height);
+        READWRITE(isStake);
+    }
+};
+
 static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, std::string message)
 {
     req->WriteHeader("Content-Type", "text/plain");
@@ -646,6 +787,201 @@ static bool rest_blockhash_by_height(HTTPRequest* req,
     }
 }
 
+/**
+ * Write a list of entries in the requested format. The binary format is the
+ * serialized vector, JSON is produced by to_json for each entry.
+ */
+template <typename Entry, typename Source, typename ToJSON>
+static bool WriteRESTList(HTTPRequest* req, RetFormat rf, const std::vector<Source>& entries, ToJSON to_json)
+{
+    switch (rf) {
+    case RetFormat::BINARY:
+    case RetFormat::HEX: {
+        CDataStream ssEntries(SER_NETWORK, PROTOCOL_VERSION);
+        WriteCompactSize(ssEntries, entries.size());
+        for (const Source& entry : entries) {
+            ssEntries << Entry(entry);
+        }
+
+        if (rf == RetFormat::BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssEntries.str());
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssEntries.begin(), ssEntries.end()) + "\n");
+        }
+        return true;
+    }
+
+    case RetFormat::JSON: {
+        UniValue jsonEntries(UniValue::VARR);
+        for (const Source& entry : entries) {
+            jsonEntries.push_back(to_json(entry));
+        }
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, jsonEntries.write() + "\n");
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+static UniValue ReceiptToJSON(const TransactionReceiptInfo& info)
+{
+    UniValue entry(UniValue::VOBJ);
+    transactionReceiptInfoToJSON(info, entry);
+    return entry;
+}
+
+static bool rest_receipt(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    if (!fLogEvents)
+        return RESTERR(req, HTTP_NOT_FOUND, "Events indexing disabled");
+
+    std::string hashStr;
+    const RetFormat rf = ParseDataFormat(hashStr, strURIPart);
+
+    uint256 hash;
+    if (!ParseHashStr(hashStr, hash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
+
+    // As with gettransactionreceipt, a transaction without receipts gives an empty list
+    std::vector<TransactionReceiptInfo> receipts;
+    pstorageresult->readCommittedResult(uintToh256(hash), receipts);
+
+    return WriteRESTList<CRestReceipt>(req, rf, receipts, ReceiptToJSON);
+}
+
+static bool rest_block_receipts(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    if (!fLogEvents)
+        return RESTERR(req, HTTP_NOT_FOUND, "Events indexing disabled");
+
+    std::string hashStr;
+    const RetFormat rf = ParseDataFormat(hashStr, strURIPart);
+
+    uint256 hash;
+    if (!ParseHashStr(hashStr, hash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
+
+    CBlock block;
+    {
+        LOCK(cs_main);
+        CBlockIndex* pblockindex = LookupBlockIndex(hash);
+        if (!pblockindex) {
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        }
+
+        if (IsBlockPruned(pblockindex))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
+
+        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+    }
+
+    // The receipts of all contract transactions of the block, in block order.
+    // A transaction also keeps the receipts of any other block it was mined
+    // in, so only those of this block are returned.
+    std::vector<TransactionReceiptInfo> receipts;
+    std::vector<TransactionReceiptInfo> tx_receipts;
+    for (const CTransactionRef& tx : block.vtx) {
+        if (!tx->HasCreateOrCall()) continue;
+        tx_receipts.clear();
+        pstorageresult->readCommittedResult(uintToh256(tx->GetHash()), tx_receipts);
+        for (TransactionReceiptInfo& receipt : tx_receipts) {
+            if (receipt.blockHash == hash) receipts.push_back(std::move(receipt));
+        }
+    }
+
+    return WriteRESTList<CRestReceipt>(req, rf, receipts, ReceiptToJSON);
+}
+
+static bool rest_address_deltas(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    if (!fAddressIndex)
+        return RESTERR(req, HTTP_NOT_FOUND, "Address index not enabled");
+
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    int32_t start = 0;
+    int32_t end = 0;
+    if (path.size() == 3) {
+        if (!ParseInt32(path[0], &start) || !ParseInt32(path[1], &end) || start <= 0 || end < start)
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height range: " + SanitizeString(path[0] + "/" + path[1]));
+    } else if (path.size() != 1) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/addressdeltas/[<start>/<end>/]<address>.<ext>");
+    }
+
+    const std::string& addressStr = path.back();
+    uint256 hashBytes;
+    int type = 0;
+    if (!DecodeIndexKey(addressStr, hashBytes, type))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + SanitizeString(addressStr));
+
+    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+    if (!GetAddressIndex(hashBytes, type, addressIndex, start, end))
+        return RESTERR(req, HTTP_NOT_FOUND, "No information available for address");
+
+    return WriteRESTList<CRestAddressDelta>(req, rf, addressIndex, [&addressStr](const std::pair<CAddressIndexKey, CAmount>& entry) {
+        UniValue delta(UniValue::VOBJ);
+        delta.pushKV("satoshis", entry.second);
+        delta.pushKV("txid", entry.first.txhash.GetHex());
+        delta.pushKV("index", (int)entry.first.index);
+        delta.pushKV("blockindex", (int)entry.first.txindex);
+        delta.pushKV("height", entry.first.blockHeight);
+        delta.pushKV("address", addressStr);
+        return delta;
+    });
+}
+
+static bool rest_address_utxos(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    if (!fAddressIndex)
+        return RESTERR(req, HTTP_NOT_FOUND, "Address index not enabled");
+
+    std::string addressStr;
+    const RetFormat rf = ParseDataFormat(addressStr, strURIPart);
+
+    uint256 hashBytes;
+    int type = 0;
+    if (!DecodeIndexKey(addressStr, hashBytes, type))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + SanitizeString(addressStr));
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspentOutputs;
+    if (!GetAddressUnspent(hashBytes, type, unspentOutputs))
+        return RESTERR(req, HTTP_NOT_FOUND, "No information available for address");
+
+    std::sort(unspentOutputs.begin(), unspentOutputs.end(), [](const std::pair<CAddressUnspentKey, CAddressUnspentValue>& a, const std::pair<CAddressUnspentKey, CAddressUnspentValue>& b) {
+        return a.second.blockHeight < b.second.blockHeight;
+    });
+
+    return WriteRESTList<CRestAddressUtxo>(req, rf, unspentOutputs, [&addressStr](const std::pair<CAddressUnspentKey, CAddressUnspentValue>& entry) {
+        UniValue output(UniValue::VOBJ);
+        output.pushKV("address", addressStr);
+        output.pushKV("txid", entry.first.txhash.GetHex());
+        output.pushKV("outputIndex", (int)entry.first.index);
+        output.pushKV("script", HexStr(entry.second.script.begin(), entry.second.script.end()));
+        output.pushKV("satoshis", entry.second.satoshis);
+        output.pushKV("height", entry.second.blockHeight);
+        output.pushKV("isStake", entry.second.coinStake);
+        return output;
+    });
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -659,6 +995,10 @@ static const struct {
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/receipt/", rest_receipt},
+      {"/rest/blockreceipts/", rest_block_receipts},
+      {"/rest/addressdeltas/", rest_address_deltas},
+      {"/rest/addressutxos/", rest_address_utxos},
 };
 
 void StartREST()
@@ -302,6 +302,29 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIn
     return result;
 }
 
+void blockToJSONStream(JSONStreamWriter& writer, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex)
+{
+    // Take the other fields, and their order, from the summary
+    const UniValue summary = blockToJSON(block, tip, blockindex, false);
+    writer.BeginObject();
+    for (size_t i = 0; i < summary.size(); ++i) {
+        const std::string& key = summary.getKeys()[i];
+        writer.Key(key);
+        if (key != "tx") {
+            writer.Value(summary.getValues()[i]);
+            continue;
+        }
+        writer.BeginArray();
+        for (const auto& tx : block.vtx) {
+            UniValue objTx(UniValue::VOBJ);
+            TxToUniv(*tx, uint256(), objTx, true, RPCSerializationFlags());
+            writer.Value(objTx);
+        }
+        writer.EndArray();
+    }
+    writer.EndObject();
+}
+
 static UniValue getestimatedannualroi(const JSONRPCRequest& request)
 {
             RPCHelpMan{"getestimatedannualroi",
@@ -1184,6 +1207,11 @@ static UniValue getblock(const JSONRPCRequest& request)
         return strHex;
     }
 
+    if (verbosity >= 2 && request.resultStream && block.vtx.size() >= JSON_STREAM_MIN_ELEMENTS) {
+        blockToJSONStream(*request.resultStream, block, tip, pblockindex);
+        return NullUniValue;
+    }
+
     return blockToJSON(block, tip, pblockindex, verbosity >= 2);
 }
 
@@ -1478,7 +1506,7 @@ UniValue searchlogs(const JSONRPCRequest& request)
                 },
             }.Check(request);
 
-    return SearchLogs(request.params);
+    return SearchLogs(request.params, request.resultStream);
 }
 
 UniValue gettransactionreceipt(const JSONRPCRequest& request)
@@ -16,6 +16,7 @@ extern RecursiveMutex cs_main;
 class CBlock;
 class CBlockIndex;
 class CTxMemPool;
+class JSONStreamWriter;
 class UniValue;
 struct NodeContext;
 
@@ -35,6 +36,9 @@ void RPCNotifyBlockChange(bool ibd, const CBlockIndex *);
 /** Block description to JSON */
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails = false) LOCKS_EXCLUDED(cs_main);
 
+/** Write the same as blockToJSON with transaction details, one transaction at a time */
+void blockToJSONStream(JSONStreamWriter& writer, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex) LOCKS_EXCLUDED(cs_main);
+
 /** Mempool information to JSON */
 UniValue MempoolInfoToJSON(const CTxMemPool& pool);
 
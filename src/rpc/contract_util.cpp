@@ -309,7 +309,7 @@ private:
 
 };
 
-UniValue SearchLogs(const UniValue& _params)
+UniValue SearchLogs(const UniValue& _params, std::shared_ptr<JSONStreamWriter> stream)
 {
     if(!fLogEvents)
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Events indexing disabled");
@@ -328,7 +328,7 @@ UniValue SearchLogs(const UniValue& _params)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Incorrect params");
     }
 
-    UniValue result(UniValue::VARR);
+    JSONArrayResult result(std::move(stream));
 
     auto topics = params.topics;
 
@@ -385,7 +385,7 @@ UniValue SearchLogs(const UniValue& _params)
         }
     }
 
-    return result;
+    return result.Finish();
 }
 
 CallToken::CallToken()
@@ -1,13 +1,17 @@
 #ifndef CONTRACT_UTIL_H
 #define CONTRACT_UTIL_H
 
+#include <rpc/jsonstream.h>
 #include <univalue.h>
 #include <validation.h>
 #include <yupost/yuposttoken.h>
 
+#include <memory>
+
 UniValue CallToContract(const UniValue& params);
 
-UniValue SearchLogs(const UniValue& params);
+/** Search the event logs. Large results are written to stream instead, if given, and null is returned. */
+UniValue SearchLogs(const UniValue& params, std::shared_ptr<JSONStreamWriter> stream = nullptr);
 
 void assignJSON(UniValue& entry, const TransactionReceiptInfo& resExec);
 
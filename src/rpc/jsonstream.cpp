@@ -0,0 +1,118 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/jsonstream.h>
+
+#include <algorithm>
+#include <assert.h>
+
+JSONStreamWriter::JSONStreamWriter(Sink sink, size_t flush_size)
+    : m_sink(std::move(sink)), m_flush_size(flush_size) {}
+
+void JSONStreamWriter::BeginValue()
+{
+    if (m_after_key) {
+        m_after_key = false;
+        return;
+    }
+    if (!m_first.empty()) {
+        if (!m_first.back()) m_buffer += ',';
+        m_first.back() = false;
+    }
+}
+
+void JSONStreamWriter::EndValue()
+{
+    m_peak_buffered = std::max(m_peak_buffered, m_buffer.size());
+    if (m_buffer.size() >= m_flush_size) Flush();
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    BeginValue();
+    m_buffer += '{';
+    m_first.push_back(true);
+}
+
+void JSONStreamWriter::EndObject()
+{
+    assert(!m_first.empty() && !m_after_key);
+    m_first.pop_back();
+    m_buffer += '}';
+    EndValue();
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    BeginValue();
+    m_buffer += '[';
+    m_first.push_back(true);
+}
+
+void JSONStreamWriter::EndArray()
+{
+    assert(!m_first.empty() && !m_after_key);
+    m_first.pop_back();
+    m_buffer += ']';
+    EndValue();
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    assert(!m_first.empty() && !m_after_key);
+    BeginValue();
+    // Let UniValue do the escaping
+    m_buffer += UniValue(key).write();
+    m_buffer += ':';
+    m_after_key = true;
+}
+
+void JSONStreamWriter::Value(const UniValue& value)
+{
+    BeginValue();
+    m_buffer += value.write();
+    EndValue();
+}
+
+void JSONStreamWriter::Flush()
+{
+    if (m_buffer.empty()) return;
+    m_committed = true;
+    m_sink(m_buffer);
+    m_buffer.clear();
+}
+
+std::string JSONStreamWriter::TakeBuffered()
+{
+    std::string buffered;
+    buffered.swap(m_buffer);
+    return buffered;
+}
+
+JSONArrayResult::JSONArrayResult(std::shared_ptr<JSONStreamWriter> stream, size_t stream_after)
+    : m_stream(std::move(stream)), m_stream_after(stream_after) {}
+
+void JSONArrayResult::push_back(const UniValue& value)
+{
+    if (m_streaming) {
+        m_stream->Value(value);
+        return;
+    }
+    m_array.push_back(value);
+    if (m_stream && m_array.size() >= m_stream_after) {
+        m_stream->BeginArray();
+        for (const UniValue& element : m_array.getValues()) {
+            m_stream->Value(element);
+        }
+        m_array = UniValue(UniValue::VARR);
+        m_streaming = true;
+    }
+}
+
+UniValue JSONArrayResult::Finish()
+{
+    if (!m_streaming) return m_array;
+    m_stream->EndArray();
+    return NullUniValue;
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_JSONSTREAM_H
+#define BITCOIN_RPC_JSONSTREAM_H
+
+#include <univalue.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** Output is handed on in pieces of about this many bytes */
+static const size_t JSON_STREAM_FLUSH_SIZE = 1 << 16;
+/** Array results with at least this many elements are streamed when possible */
+static const size_t JSON_STREAM_MIN_ELEMENTS = 1000;
+
+/**
+ * Writes compact JSON incrementally, producing the same text as
+ * UniValue::write() would for the equivalent document.
+ *
+ * Large RPC results can be written element by element, each built as a small
+ * UniValue and then released, instead of building the whole result first and
+ * then serializing it in one piece. Output is buffered and handed to the sink
+ * in pieces of about flush_size bytes.
+ */
+class JSONStreamWriter
+{
+public:
+    typedef std::function<void(const std::string&)> Sink;
+
+    explicit JSONStreamWriter(Sink sink, size_t flush_size = JSON_STREAM_FLUSH_SIZE);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    /** Write the key of the next object member, to be followed by its value */
+    void Key(const std::string& key);
+    /** Write a complete value: an array element, a member value or the whole document */
+    void Value(const UniValue& value);
+    void Pair(const std::string& key, const UniValue& value)
+    {
+        Key(key);
+        Value(value);
+    }
+
+    /** Hand all buffered output to the sink */
+    void Flush();
+    /** Take the buffered output, for when all of it can be sent in one piece */
+    std::string TakeBuffered();
+    /** Whether any output has been handed to the sink yet */
+    bool IsCommitted() const { return m_committed; }
+    /** Whether a key has been written and its value has not */
+    bool AwaitingValue() const { return m_after_key; }
+    /** Largest amount of output that has been buffered at once */
+    size_t GetPeakBuffered() const { return m_peak_buffered; }
+
+private:
+    void BeginValue();
+    void EndValue();
+
+    Sink m_sink;
+    const size_t m_flush_size;
+    std::string m_buffer;
+    //! Per open array or object, whether nothing has been written to it yet
+    std::vector<bool> m_first;
+    bool m_after_key{false};
+    bool m_committed{false};
+    size_t m_peak_buffered{0};
+};
+
+/**
+ * Array result of an RPC call that may grow large. Elements are collected as
+ * usual until there are stream_after of them; from then on they are written
+ * to the stream, if the request has one.
+ */
+class JSONArrayResult
+{
+public:
+    explicit JSONArrayResult(std::shared_ptr<JSONStreamWriter> stream, size_t stream_after = JSON_STREAM_MIN_ELEMENTS);
+
+    void push_back(const UniValue& value);
+    /** The value for the handler to return: the array, or null if it has been streamed */
+    UniValue Finish();
+
+private:
+    std::shared_ptr<JSONStreamWriter> m_stream;
+    const size_t m_stream_after;
+    UniValue m_array{UniValue::VARR};
+    bool m_streaming{false};
+};
+
+#endif // BITCOIN_RPC_JSONSTREAM_H
@@ -1041,6 +1041,79 @@ static UniValue estimatesmartfee(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue estimatesmartgasprice(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"estimatesmartgasprice",
+                "\nEstimates the approximate gas price needed for a contract transaction to begin\n"
+                "confirmation within conf_target blocks if possible and return the number of blocks\n"
+                "for which the estimate is valid. The estimate is never below the minimum gas price\n"
+                "set by the DGP, which is returned when blocks leave most of their gas limit unused.\n",
+                {
+                    {"conf_target", RPCArg::Type::NUM, RPCArg::Optional::NO, "Confirmation target in blocks (1 - 48)"},
+                    {"estimate_mode", RPCArg::Type::STR, /* default */ "CONSERVATIVE", "The fee estimate mode.\n"
+            "                   Whether to return a more conservative estimate which also satisfies\n"
+            "                   twice the target.  Must be one of:\n"
+            "       \"UNSET\"\n"
+            "       \"ECONOMICAL\"\n"
+            "       \"CONSERVATIVE\""},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "gasprice", /* optional */ true, "estimate gas price in satoshis per unit of gas (only present if no errors were encountered)"},
+                        {RPCResult::Type::NUM, "mingasprice", "minimum gas price set by the DGP in satoshis per unit of gas, as in getdgpinfo"},
+                        {RPCResult::Type::NUM, "blockgasutilization", /* optional */ true, "moving average of the share of the block gas limit used by recent blocks"},
+                        {RPCResult::Type::ARR, "errors", "Errors encountered during processing",
+                            {
+                                {RPCResult::Type::STR, "", "error"},
+                            }},
+                        {RPCResult::Type::NUM, "blocks", "block number where estimate was found"},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("estimatesmartgasprice", "6")
+            + HelpExampleRpc("estimatesmartgasprice", "6")
+                },
+            }.Check(request);
+
+    RPCTypeCheck(request.params, {UniValue::VNUM, UniValue::VSTR});
+    RPCTypeCheckArgument(request.params[0], UniValue::VNUM);
+    unsigned int max_target = ::feeEstimator.HighestGasTargetTracked();
+    unsigned int conf_target = ParseConfirmTarget(request.params[0], max_target);
+    bool conservative = true;
+    if (!request.params[1].isNull()) {
+        FeeEstimateMode fee_mode;
+        if (!FeeModeFromString(request.params[1].get_str(), fee_mode)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid estimate_mode parameter");
+        }
+        if (fee_mode == FeeEstimateMode::ECONOMICAL) conservative = false;
+    }
+
+    CAmount min_gas_price;
+    {
+        LOCK(cs_main);
+        YuPostDGP yupostDGP(globalState.get());
+        min_gas_price = yupostDGP.getMinGasPrice(::ChainActive().Height());
+    }
+
+    UniValue result(UniValue::VOBJ);
+    UniValue errors(UniValue::VARR);
+    FeeCalculation feeCalc;
+    CAmount gas_price = ::feeEstimator.estimateSmartGasPrice(conf_target, min_gas_price, &feeCalc, conservative);
+    if (gas_price > 0) {
+        result.pushKV("gasprice", (uint64_t)gas_price);
+    } else {
+        errors.push_back("Insufficient data or no gas price found");
+        result.pushKV("errors", errors);
+    }
+    result.pushKV("mingasprice", (uint64_t)min_gas_price);
+    double utilization = ::feeEstimator.GetBlockGasUtilization();
+    if (utilization >= 0) {
+        result.pushKV("blockgasutilization", utilization);
+    }
+    result.pushKV("blocks", feeCalc.returnedTarget);
+    return result;
+}
+
 static UniValue estimaterawfee(const JSONRPCRequest& request)
 {
             RPCHelpMan{"estimaterawfee",
@@ -1177,6 +1250,7 @@ static const CRPCCommand commands[] =
     { "generating",         "generatetodescriptor",   &generatetodescriptor,   {"num_blocks","descriptor","maxtries"} },
 
     { "util",               "estimatesmartfee",       &estimatesmartfee,       {"conf_target", "estimate_mode"} },
+    { "util",               "estimatesmartgasprice",  &estimatesmartgasprice,  {"conf_target", "estimate_mode"} },
 
     { "hidden",             "estimaterawfee",         &estimaterawfee,         {"conf_target", "threshold"} },
 };
@@ -3,7 +3,10 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <dbwrapper.h>
 #include <httpserver.h>
+#include <index/blockfilterindex.h>
+#include <index/txindex.h>
 #include <key_io.h>
 #include <node/context.h>
 #include <outputtype.h>
@@ -12,6 +15,7 @@
 #include <rpc/util.h>
 #include <scheduler.h>
 #include <script/descriptor.h>
+#include <script/sigcache.h>
 #include <util/check.h>
 #include <util/message.h> // For MessageSign(), MessageVerify()
 #include <util/strencodings.h>
@@ -253,27 +257,38 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         }
     }
 
-    UniValue deltas(UniValue::VARR);
-
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+    // Resolve every address up front: once the deltas start streaming, an
+    // error can no longer be reported.
+    std::vector<std::string> deltaAddresses;
+    deltaAddresses.reserve(addressIndex.size());
+    for (const auto& entry : addressIndex) {
         std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
+        if (!getAddressFromIndex(entry.first.type, entry.first.hashBytes, address)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
         }
+        deltaAddresses.push_back(std::move(address));
+    }
+
+    // Only the plain list of deltas is streamed, the chain info can still fail
+    const bool withChainInfo = includeChainInfo && start > 0 && end > 0;
+    JSONArrayResult deltas(withChainInfo ? nullptr : request.resultStream);
+
+    for (size_t i = 0; i < addressIndex.size(); ++i) {
+        const auto& entry = addressIndex[i];
 
         UniValue delta(UniValue::VOBJ);
-        delta.pushKV("satoshis", it->second);
-        delta.pushKV("txid", it->first.txhash.GetHex());
-        delta.pushKV("index", (int)it->first.index);
-        delta.pushKV("blockindex", (int)it->first.txindex);
-        delta.pushKV("height", it->first.blockHeight);
-        delta.pushKV("address", address);
+        delta.pushKV("satoshis", entry.second);
+        delta.pushKV("txid", entry.first.txhash.GetHex());
+        delta.pushKV("index", (int)entry.first.index);
+        delta.pushKV("blockindex", (int)entry.first.txindex);
+        delta.pushKV("height", entry.first.blockHeight);
+        delta.pushKV("address", deltaAddresses[i]);
         deltas.push_back(delta);
     }
 
     UniValue result(UniValue::VOBJ);
 
-    if (includeChainInfo && start > 0 && end > 0) {
+    if (withChainInfo) {
         LOCK(cs_main);
 
         if (start > ::ChainActive().Height() || end > ::ChainActive().Height()) {
@@ -292,13 +307,13 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         endInfo.pushKV("hash", endIndex->GetBlockHash().GetHex());
         endInfo.pushKV("height", end);
 
-        result.pushKV("deltas", deltas);
+        result.pushKV("deltas", deltas.Finish());
         result.pushKV("start", startInfo);
         result.pushKV("end", endInfo);
 
         return result;
     } else {
-        return deltas;
+        return deltas.Finish();
     }
 }
 
@@ -1232,6 +1247,117 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
     }
 }
 
+static UniValue getdbinfo(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getdbinfo",
+                "\nReturns the settings and LevelDB statistics of the open databases.\n",
+                {
+                    {"db_name", RPCArg::Type::STR, RPCArg::Optional::OMITTED_NAMED_ARG, "Only return the database with this name."},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ_DYN, "", "", {
+                        {
+                            RPCResult::Type::OBJ, "name", "The name of the database, as used in -dboption",
+                            {
+                                {RPCResult::Type::NUM, "cache_size", "Memory for the block cache and write buffers, in bytes"},
+                                {RPCResult::Type::NUM, "write_buffer_size", "Size of the write buffer, in bytes"},
+                                {RPCResult::Type::NUM, "bloom_bits", "Bits per key of the bloom filters, 0 if there are none"},
+                                {RPCResult::Type::NUM, "memory_usage", "Memory used by the block cache and the write buffers, in bytes"},
+                                {RPCResult::Type::NUM, "read_amplification", "Most tables a lookup may have to search"},
+                                {RPCResult::Type::ARR, "levels", "Levels that have files or have been compacted into",
+                                {
+                                    {RPCResult::Type::OBJ, "", "",
+                                    {
+                                        {RPCResult::Type::NUM, "level", "The level"},
+                                        {RPCResult::Type::NUM, "files", "Number of tables"},
+                                        {RPCResult::Type::NUM, "size_mb", "Size of the tables, in MiB"},
+                                        {RPCResult::Type::NUM, "compaction_sec", "Time spent compacting into the level, in seconds"},
+                                        {RPCResult::Type::NUM, "compaction_read_mb", "Data read by compactions into the level, in MiB"},
+                                        {RPCResult::Type::NUM, "compaction_write_mb", "Data written by compactions into the level, in MiB"},
+                                    }},
+                                }},
+                            },
+                        },
+                    },
+                },
+                RPCExamples{
+                    HelpExampleCli("getdbinfo", "")
+                  + HelpExampleCli("getdbinfo", "chainstate")
+                  + HelpExampleRpc("getdbinfo", "chainstate")
+                },
+            }.Check(request);
+
+    const std::string db_name = request.params[0].isNull() ? "" : request.params[0].get_str();
+    UniValue result(UniValue::VOBJ);
+    for (const DBStats& stats : GetDBStats()) {
+        if (!db_name.empty() && db_name != stats.name) continue;
+
+        UniValue levels(UniValue::VARR);
+        for (const DBStats::Level& level : stats.levels) {
+            UniValue entry(UniValue::VOBJ);
+            entry.pushKV("level", level.level);
+            entry.pushKV("files", level.files);
+            entry.pushKV("size_mb", level.size_mb);
+            entry.pushKV("compaction_sec", level.compaction_sec);
+            entry.pushKV("compaction_read_mb", level.compaction_read_mb);
+            entry.pushKV("compaction_write_mb", level.compaction_write_mb);
+            levels.push_back(entry);
+        }
+
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("cache_size", (uint64_t)stats.options.cache_size);
+        entry.pushKV("write_buffer_size", (uint64_t)(stats.options.write_buffer_size ? stats.options.write_buffer_size : stats.options.cache_size / 4));
+        entry.pushKV("bloom_bits", stats.options.bloom_bits);
+        entry.pushKV("memory_usage", (uint64_t)stats.memory_usage);
+        entry.pushKV("read_amplification", stats.read_amplification);
+        entry.pushKV("levels", levels);
+        result.pushKV(stats.name, entry);
+    }
+    return result;
+}
+
+static UniValue CuckooCacheStatsToJSON(const CuckooCacheStats& stats)
+{
+    UniValue entry(UniValue::VOBJ);
+    entry.pushKV("shards", (uint64_t)stats.shards);
+    entry.pushKV("capacity", (uint64_t)stats.capacity);
+    entry.pushKV("hits", stats.hits);
+    entry.pushKV("misses", stats.misses);
+    entry.pushKV("inserts", stats.inserts);
+    return entry;
+}
+
+static UniValue getsigcacheinfo(const JSONRPCRequest& request)
+{
+    const std::vector<RPCResult> cache_fields{
+        {RPCResult::Type::NUM, "shards", "Number of independently locked parts of the cache"},
+        {RPCResult::Type::NUM, "capacity", "Number of entries the cache can hold"},
+        {RPCResult::Type::NUM, "hits", "Lookups that found their entry since startup"},
+        {RPCResult::Type::NUM, "misses", "Lookups that did not find their entry since startup"},
+        {RPCResult::Type::NUM, "inserts", "Entries added since startup"},
+    };
+            RPCHelpMan{"getsigcacheinfo",
+                "\nReturns usage statistics of the signature and script execution caches.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::OBJ, "signatures", "The cache of valid signatures", cache_fields},
+                        {RPCResult::Type::OBJ, "script_execution", "The cache of transactions whose scripts passed with the given flags", cache_fields},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("getsigcacheinfo", "")
+                  + HelpExampleRpc("getsigcacheinfo", "")
+                },
+            }.Check(request);
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("signatures", CuckooCacheStatsToJSON(GetSignatureCacheStats()));
+    result.pushKV("script_execution", CuckooCacheStatsToJSON(GetScriptExecutionCacheStats()));
+    return result;
+}
+
 static void EnableOrDisableLogCategories(UniValue cats, bool enable) {
     cats = cats.get_array();
     for (unsigned int i = 0; i < cats.size(); ++i) {
@@ -1318,6 +1444,82 @@ UniValue logging(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue SummaryToJSON(const IndexSummary&& summary, std::string index_name)
+{
+    UniValue ret_summary(UniValue::VOBJ);
+    if (!index_name.empty() && index_name != summary.name) return ret_summary;
+
+    UniValue entry(UniValue::VOBJ);
+    entry.pushKV("synced", summary.synced);
+    entry.pushKV("best_block_height", summary.best_block_height);
+    ret_summary.pushKV(summary.name, entry);
+    return ret_summary;
+}
+
+static UniValue getindexinfo(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getindexinfo",
+                "\nReturns the status of one or all available indices currently running in the node.\n",
+                {
+                    {"index_name", RPCArg::Type::STR, RPCArg::Optional::OMITTED_NAMED_ARG, "Filter results for an index with a specific name."},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ_DYN, "", "", {
+                        {
+                            RPCResult::Type::OBJ, "name", "The name of the index",
+                            {
+                                {RPCResult::Type::BOOL, "synced", "Whether the index is synced or not"},
+                                {RPCResult::Type::NUM, "best_block_height", "The block height to which the index is synced"},
+                                {RPCResult::Type::OBJ, "lookup_filter", /* optional */ true, "txindex only: the in-memory filter that answers lookups of unknown transactions (only present with -txindexfilter)",
+                                {
+                                    {RPCResult::Type::BOOL, "ready", "Whether the filter has been built and is used for lookups"},
+                                    {RPCResult::Type::NUM, "memory_usage", "Memory used by the filter, in bytes"},
+                                    {RPCResult::Type::NUM, "entries", "Number of transactions inserted into the filter"},
+                                    {RPCResult::Type::NUM, "capacity", "Number of transactions the filter was sized for; a larger one is built once entries exceeds it"},
+                                    {RPCResult::Type::NUM, "skipped_lookups", "Lookups answered by the filter without reading the index"},
+                                    {RPCResult::Type::NUM, "false_positives", "Lookups the filter passed on for transactions that are not indexed"},
+                                }},
+                            },
+                        },
+                    },
+                },
+                RPCExamples{
+                    HelpExampleCli("getindexinfo", "")
+                  + HelpExampleRpc("getindexinfo", "")
+                  + HelpExampleCli("getindexinfo", "txindex")
+                  + HelpExampleRpc("getindexinfo", "txindex")
+                },
+            }.Check(request);
+
+    UniValue result(UniValue::VOBJ);
+    const std::string index_name = request.params[0].isNull() ? "" : request.params[0].get_str();
+
+    if (g_txindex) {
+        UniValue summary = SummaryToJSON(g_txindex->GetSummary(), index_name);
+        const TxIndex::FilterStats stats = g_txindex->GetFilterStats();
+        if (stats.enabled && !summary.empty()) {
+            UniValue filter(UniValue::VOBJ);
+            filter.pushKV("ready", stats.ready);
+            filter.pushKV("memory_usage", (uint64_t)stats.memory_usage);
+            filter.pushKV("entries", stats.entries);
+            filter.pushKV("capacity", stats.capacity);
+            filter.pushKV("skipped_lookups", stats.skipped_lookups);
+            filter.pushKV("false_positives", stats.false_positives);
+            UniValue entry = find_value(summary, "txindex");
+            entry.pushKV("lookup_filter", filter);
+            summary = UniValue(UniValue::VOBJ);
+            summary.pushKV("txindex", entry);
+        }
+        result.pushKVs(summary);
+    }
+
+    ForEachBlockFilterIndex([&result, &index_name](const BlockFilterIndex& index) {
+        result.pushKVs(SummaryToJSON(index.GetSummary(), index_name));
+    });
+
+    return result;
+}
+
 static UniValue echo(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -1345,7 +1547,10 @@ static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "getmemoryinfo",          &getmemoryinfo,          {"mode"} },
+    { "control",            "getdbinfo",              &getdbinfo,              {"db_name"} },
+    { "control",            "getsigcacheinfo",        &getsigcacheinfo,        {} },
     { "control",            "logging",                &logging,                {"include", "exclude"}},
+    { "util",               "getindexinfo",           &getindexinfo,           {"index_name"} },
     { "util",               "validateaddress",        &validateaddress,        {"address"} },
     { "util",               "createmultisig",         &createmultisig,         {"nrequired","keys","address_type"} },
     { "util",               "deriveaddresses",        &deriveaddresses,        {"descriptor", "range"} },
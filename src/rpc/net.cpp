@@ -118,6 +118,14 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
                             }},
                             {RPCResult::Type::BOOL, "whitelisted", "Whether the peer is whitelisted"},
                             {RPCResult::Type::NUM, "minfeefilter", "The minimum fee rate for transactions this peer accepts"},
+                            {RPCResult::Type::OBJ, "txreconciliation", /* optional */ true, "Only present if transaction announcements are reconciled with this peer",
+                            {
+                                {RPCResult::Type::STR, "role", "\"initiator\" if we start reconciliation rounds, \"responder\" otherwise"},
+                                {RPCResult::Type::NUM, "rounds", "Number of completed reconciliation rounds"},
+                                {RPCResult::Type::NUM, "failures", "Number of rounds that fell back to flooding"},
+                                {RPCResult::Type::NUM, "announcements_saved", "Transactions not announced because the peer already had them"},
+                                {RPCResult::Type::NUM, "inv_bytes_saved", "Estimated inv bytes saved; see bytessent_per_msg for the reconciliation messages themselves"},
+                            }},
                             {RPCResult::Type::OBJ_DYN, "bytessent_per_msg", "",
                             {
                                 {RPCResult::Type::NUM, "msg", "The total bytes sent aggregated by message type\n"
@@ -203,6 +211,15 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
         }
         obj.pushKV("permissions", permissions);
         obj.pushKV("minfeefilter", ValueFromAmount(stats.minFeeFilter));
+        if (stats.m_recon_stats.m_enabled) {
+            UniValue recon(UniValue::VOBJ);
+            recon.pushKV("role", stats.m_recon_stats.m_initiator ? "initiator" : "responder");
+            recon.pushKV("rounds", stats.m_recon_stats.m_rounds);
+            recon.pushKV("failures", stats.m_recon_stats.m_failures);
+            recon.pushKV("announcements_saved", stats.m_recon_stats.m_announcements_saved);
+            recon.pushKV("inv_bytes_saved", stats.m_recon_stats.m_announcements_saved * ::GetSerializeSize(CInv(), PROTOCOL_VERSION));
+            obj.pushKV("txreconciliation", recon);
+        }
 
         UniValue sendPerMsgCmd(UniValue::VOBJ);
         for (const auto& i : stats.mapSendBytesPerMsgCmd) {
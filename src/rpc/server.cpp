@@ -385,6 +385,9 @@ static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
 {
     UniValue rpc_result(UniValue::VOBJ);
 
+    // Replies within a batch cannot be streamed
+    jreq.resultStream.reset();
+
     try {
         jreq.parse(req);
 
@@ -404,12 +407,77 @@ static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
+namespace {
+/** Progress of a batch request executed by several threads */
+struct BatchExecution
+{
+    Mutex cs;
+    std::condition_variable cond;
+    //! Only dereferenced for elements that have been claimed, which the
+    //! thread that owns them waits for.
+    const JSONRPCRequest* jreq GUARDED_BY(cs);
+    const UniValue* vReq GUARDED_BY(cs);
+    std::vector<UniValue> replies GUARDED_BY(cs);
+    size_t next GUARDED_BY(cs){0};
+    size_t done GUARDED_BY(cs){0};
+};
+
+/** Claim and execute batch elements until none are left. Helper tasks that
+ * start after all elements have been claimed return straight away. */
+void ExecBatchElements(BatchExecution& batch)
+{
+    while (true) {
+        const JSONRPCRequest* jreq;
+        const UniValue* req;
+        size_t idx;
+        {
+            LOCK(batch.cs);
+            if (batch.next == batch.replies.size()) return;
+            idx = batch.next++;
+            jreq = batch.jreq;
+            req = &(*batch.vReq)[idx];
+        }
+        UniValue reply = JSONRPCExecOne(*jreq, *req);
+        LOCK(batch.cs);
+        batch.replies[idx] = std::move(reply);
+        if (++batch.done == batch.replies.size()) batch.cond.notify_all();
+    }
+}
+} // namespace
+
+std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, int max_threads, const RPCTaskDispatcher& dispatch)
 {
     UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+    if (max_threads <= 1 || !dispatch || vReq.size() <= 1) {
+        for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
+            ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+        return ret.write() + "\n";
+    }
+
+    // Helpers may only get to run after this call has returned, so they
+    // share ownership of the progress state.
+    auto batch = std::make_shared<BatchExecution>();
+    {
+        LOCK(batch->cs);
+        batch->jreq = &jreq;
+        batch->vReq = &vReq;
+        batch->replies.resize(vReq.size());
+    }
+    const size_t helpers = std::min<size_t>(max_threads - 1, vReq.size() - 1);
+    for (size_t i = 0; i < helpers; ++i) {
+        if (!dispatch([batch] { ExecBatchElements(*batch); })) break;
+    }
+    // This thread works on the batch too, so it completes even when no
+    // helper gets to run.
+    ExecBatchElements(*batch);
 
+    WAIT_LOCK(batch->cs, lock);
+    while (batch->done < batch->replies.size()) {
+        batch->cond.wait(lock);
+    }
+    for (UniValue& reply : batch->replies) {
+        ret.push_back(std::move(reply));
+    }
     return ret.write() + "\n";
 }
 
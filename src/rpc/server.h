@@ -7,6 +7,7 @@
 #define BITCOIN_RPC_SERVER_H
 
 #include <amount.h>
+#include <rpc/jsonstream.h>
 #include <rpc/request.h>
 #include <uint256.h>
 
@@ -78,6 +79,15 @@ public:
 
     bool isLongPolling;
 
+    /**
+     * Handlers with potentially large results may write the result to this
+     * stream instead, and return NullUniValue. Errors can only be reported
+     * until the stream has committed output, so check everything first.
+     * Not set for requests whose reply cannot be streamed, such as those in
+     * a batch.
+     */
+    std::shared_ptr<JSONStreamWriter> resultStream;
+
     // FIXME: make this private?
     HTTPRequest *req;
 };
@@ -222,7 +232,17 @@ extern double GetEstimatedAnnualROI();
 void StartRPC();
 void InterruptRPC();
 void StopRPC();
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq);
+
+/** Hands a task to another thread. Returns false if the task could not be queued. */
+typedef std::function<bool(std::function<void()>)> RPCTaskDispatcher;
+
+/**
+ * Execute the elements of a batch request and return the array of replies, in
+ * request order. With max_threads above 1, up to max_threads - 1 helper tasks
+ * are handed to dispatch, which execute elements concurrently with the calling
+ * thread. Elements are then not executed in any particular order.
+ */
+std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, int max_threads = 1, const RPCTaskDispatcher& dispatch = nullptr);
 
 // Retrieves any serialization flags requested in command line argument
 int RPCSerializationFlags();
@@ -13,6 +13,79 @@
 #include <cuckoocache.h>
 #include <boost/thread.hpp>
 
+#include <atomic>
+
+struct ShardedCuckooCache::Shard
+{
+    CuckooCache::cache<uint256, SignatureCacheHasher> cache;
+    boost::shared_mutex mutex;
+    size_t capacity{0};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> inserts{0};
+};
+
+ShardedCuckooCache::ShardedCuckooCache(unsigned int shards)
+    : m_shards(new Shard[std::max(1u, shards)]), m_shard_count(std::max(1u, shards))
+{
+}
+
+ShardedCuckooCache::~ShardedCuckooCache() = default;
+
+ShardedCuckooCache::Shard& ShardedCuckooCache::GetShard(const uint256& entry) const
+{
+    // The cuckoo tables place entries by the high bits of their hashes
+    return m_shards[SignatureCacheHasher().operator()<0>(entry) % m_shard_count];
+}
+
+size_t ShardedCuckooCache::setup_bytes(size_t bytes)
+{
+    size_t elements = 0;
+    for (unsigned int i = 0; i < m_shard_count; ++i) {
+        Shard& shard = m_shards[i];
+        boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
+        shard.capacity = shard.cache.setup_bytes(bytes / m_shard_count);
+        elements += shard.capacity;
+    }
+    return elements;
+}
+
+bool ShardedCuckooCache::contains(const uint256& entry, bool erase) const
+{
+    Shard& shard = GetShard(entry);
+    bool found;
+    {
+        boost::shared_lock<boost::shared_mutex> lock(shard.mutex);
+        found = shard.cache.contains(entry, erase);
+    }
+    (found ? shard.hits : shard.misses).fetch_add(1, std::memory_order_relaxed);
+    return found;
+}
+
+void ShardedCuckooCache::insert(const uint256& entry)
+{
+    Shard& shard = GetShard(entry);
+    {
+        boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
+        shard.cache.insert(entry);
+    }
+    shard.inserts.fetch_add(1, std::memory_order_relaxed);
+}
+
+CuckooCacheStats ShardedCuckooCache::GetStats() const
+{
+    CuckooCacheStats stats;
+    stats.shards = m_shard_count;
+    for (unsigned int i = 0; i < m_shard_count; ++i) {
+        const Shard& shard = m_shards[i];
+        stats.capacity += shard.capacity;
+        stats.hits += shard.hits.load(std::memory_order_relaxed);
+        stats.misses += shard.misses.load(std::memory_order_relaxed);
+        stats.inserts += shard.inserts.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
 namespace {
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
@@ -24,9 +97,7 @@ class CSignatureCache
 private:
      //! Entries are SHA256(nonce || signature hash || public key || signature):
     uint256 nonce;
-    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
-    map_type setValid;
-    boost::shared_mutex cs_sigcache;
+    ShardedCuckooCache setValid;
 
 public:
     CSignatureCache()
@@ -43,19 +114,21 @@ public:
     bool
     Get(const uint256& entry, const bool erase)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
         return setValid.contains(entry, erase);
     }
 
     void Set(uint256& entry)
     {
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
         setValid.insert(entry);
     }
-    uint32_t setup_bytes(size_t n)
+    size_t setup_bytes(size_t n)
     {
         return setValid.setup_bytes(n);
     }
+    CuckooCacheStats GetStats() const
+    {
+        return setValid.GetStats();
+    }
 };
 
 /* In previous versions of this code, signatureCache was a local static variable
@@ -79,6 +152,11 @@ void InitSignatureCache()
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+CuckooCacheStats GetSignatureCacheStats()
+{
+    return signatureCache.GetStats();
+}
+
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
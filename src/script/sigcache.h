@@ -8,6 +8,7 @@
 
 #include <script/interpreter.h>
 
+#include <memory>
 #include <vector>
 
 // DoS prevention: limit cache size to 32MB (over 1000000 entries on 64-bit
@@ -16,6 +17,9 @@
 static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 // Maximum sig cache size allowed
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+// Number of independently locked shards the signature and script execution
+// caches are split into
+static const unsigned int DEFAULT_SIG_CACHE_SHARDS = 16;
 
 class CPubKey;
 
@@ -40,6 +44,45 @@ public:
     }
 };
 
+/** Usage statistics of a ShardedCuckooCache */
+struct CuckooCacheStats
+{
+    size_t shards{0};
+    //! Number of elements the cache can hold
+    size_t capacity{0};
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t inserts{0};
+};
+
+/**
+ * A cache of nonced uint256 hashes, split into shards that each hold a
+ * CuckooCache::cache behind their own lock. The shard of an entry is picked
+ * from the low bits of its first hash, which the cuckoo tables barely use to
+ * place it. Threads checking entries of different shards do not contend, and
+ * each shard ages its entries with its own epochs. Erasing on a hit works
+ * like in a single cache.
+ */
+class ShardedCuckooCache
+{
+private:
+    struct Shard;
+    std::unique_ptr<Shard[]> m_shards;
+    const unsigned int m_shard_count;
+
+    Shard& GetShard(const uint256& entry) const;
+
+public:
+    explicit ShardedCuckooCache(unsigned int shards = DEFAULT_SIG_CACHE_SHARDS);
+    ~ShardedCuckooCache();
+
+    /** Split about bytes of memory over the shards, returns the number of elements the cache can hold */
+    size_t setup_bytes(size_t bytes);
+    bool contains(const uint256& entry, bool erase) const;
+    void insert(const uint256& entry);
+    CuckooCacheStats GetStats() const;
+};
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
@@ -63,5 +106,6 @@ public:
 };
 
 void InitSignatureCache();
+CuckooCacheStats GetSignatureCacheStats();
 
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -182,13 +182,53 @@ BOOST_AUTO_TEST_CASE(blockfilters_json_test)
 BOOST_AUTO_TEST_CASE(blockfilter_type_names)
 {
     BOOST_CHECK_EQUAL(BlockFilterTypeName(BlockFilterType::BASIC), "basic");
+    BOOST_CHECK_EQUAL(BlockFilterTypeName(BlockFilterType::CONTRACT), "contract");
     BOOST_CHECK_EQUAL(BlockFilterTypeName(static_cast<BlockFilterType>(255)), "");
 
     BlockFilterType filter_type;
     BOOST_CHECK(BlockFilterTypeByName("basic", filter_type));
     BOOST_CHECK_EQUAL(filter_type, BlockFilterType::BASIC);
+    BOOST_CHECK(BlockFilterTypeByName("contract", filter_type));
+    BOOST_CHECK_EQUAL(filter_type, BlockFilterType::CONTRACT);
 
     BOOST_CHECK(!BlockFilterTypeByName("unknown", filter_type));
 }
 
+BOOST_AUTO_TEST_CASE(blockfilter_contract_test)
+{
+    // Contract addresses are 20 bytes, log topics 32 bytes
+    GCSFilter::ElementSet included_elements, excluded_elements;
+    for (int i = 0; i < 10; ++i) {
+        included_elements.insert(GCSFilter::Element(i % 2 ? 20 : 32, i + 1));
+        excluded_elements.insert(GCSFilter::Element(i % 2 ? 32 : 20, i + 1));
+    }
+
+    uint256 block_hash = uint256S("0x5e0c34eb3e2ee4b1bcb0d1bca60a44ef0a1fe4b4ae3ba8ab6f8c0cb4ca36a8d0");
+    BlockFilter filter(BlockFilterType::CONTRACT, block_hash, included_elements);
+    BOOST_CHECK(filter.GetFilterType() == BlockFilterType::CONTRACT);
+    BOOST_CHECK_EQUAL(filter.GetBlockHash(), block_hash);
+    BOOST_CHECK_EQUAL(filter.GetFilter().GetN(), included_elements.size());
+    for (const auto& element : included_elements) {
+        BOOST_CHECK(filter.GetFilter().Match(element));
+    }
+    for (const auto& element : excluded_elements) {
+        BOOST_CHECK(!filter.GetFilter().Match(element));
+    }
+
+    // Round trip through serialization, as in a cfilter message
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << filter;
+    BlockFilter filter2;
+    stream >> filter2;
+    BOOST_CHECK(filter2.GetFilterType() == BlockFilterType::CONTRACT);
+    BOOST_CHECK_EQUAL(filter2.GetHash(), filter.GetHash());
+
+    // An empty set gives an empty filter
+    BlockFilter empty(BlockFilterType::CONTRACT, block_hash, GCSFilter::ElementSet());
+    BOOST_CHECK_EQUAL(empty.GetFilter().GetN(), 0U);
+
+    // The elements are not in the block itself
+    BOOST_CHECK_THROW(BlockFilter(BlockFilterType::CONTRACT, CBlock(), CBlockUndo()), std::invalid_argument);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,59 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockservecache.h>
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockservecache_tests, BasicTestingSetup)
+
+static std::shared_ptr<const CSharedNetPayload> MakeTestPayload(size_t size)
+{
+    return std::make_shared<const CSharedNetPayload>(std::vector<unsigned char>(size, 0x42));
+}
+
+BOOST_AUTO_TEST_CASE(blockservecache_lru)
+{
+    BlockServeCache cache(10000);
+    const uint256 hash1 = InsecureRand256();
+    const uint256 hash2 = InsecureRand256();
+    const uint256 hash3 = InsecureRand256();
+
+    BOOST_CHECK(!cache.Get(hash1, BlockServeCache::Kind::BLOCK));
+    auto payload1 = MakeTestPayload(3000);
+    cache.Put(hash1, BlockServeCache::Kind::BLOCK, payload1);
+    // The same buffer is handed out, not a copy.
+    BOOST_CHECK(cache.Get(hash1, BlockServeCache::Kind::BLOCK) == payload1);
+    // Other serializations of the same block are separate entries.
+    BOOST_CHECK(!cache.Get(hash1, BlockServeCache::Kind::CMPCT));
+    BOOST_CHECK_EQUAL(cache.GetHits(), 1U);
+    BOOST_CHECK_EQUAL(cache.GetMisses(), 2U);
+
+    cache.Put(hash2, BlockServeCache::Kind::BLOCK, MakeTestPayload(3000));
+    cache.Put(hash3, BlockServeCache::Kind::BLOCK, MakeTestPayload(3000));
+    BOOST_CHECK_EQUAL(cache.GetCount(), 3U);
+    BOOST_CHECK(cache.GetUsage() <= 10000);
+
+    // Touch hash1 so that hash2 is the least recently used, then overflow.
+    BOOST_CHECK(cache.Get(hash1, BlockServeCache::Kind::BLOCK));
+    cache.Put(InsecureRand256(), BlockServeCache::Kind::BLOCK, MakeTestPayload(3000));
+    BOOST_CHECK(cache.GetUsage() <= 10000);
+    BOOST_CHECK(cache.Get(hash1, BlockServeCache::Kind::BLOCK));
+    BOOST_CHECK(!cache.Get(hash2, BlockServeCache::Kind::BLOCK));
+
+    // Entries larger than the whole cache are not stored.
+    const uint256 big = InsecureRand256();
+    cache.Put(big, BlockServeCache::Kind::BLOCK, MakeTestPayload(20000));
+    BOOST_CHECK(!cache.Get(big, BlockServeCache::Kind::BLOCK));
+
+    // Shrinking evicts; zero disables.
+    cache.SetMaxBytes(0);
+    BOOST_CHECK_EQUAL(cache.GetCount(), 0U);
+    BOOST_CHECK_EQUAL(cache.GetUsage(), 0U);
+    cache.Put(hash1, BlockServeCache::Kind::BLOCK, payload1);
+    BOOST_CHECK(!cache.Get(hash1, BlockServeCache::Kind::BLOCK));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,130 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockstream.h>
+#include <consensus/merkle.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <version.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockstream_tests, BasicTestingSetup)
+
+static CBlock MakeTestBlock(size_t num_txs)
+{
+    CBlock block;
+    block.nVersion = 4;
+    block.hashPrevBlock = InsecureRand256();
+    block.nTime = 1600000000;
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig = CScript() << 1 << OP_0;
+    coinbase.vout.emplace_back(50 * COIN, CScript() << OP_TRUE);
+    block.vtx.push_back(MakeTransactionRef(std::move(coinbase)));
+
+    for (size_t i = 1; i < num_txs; ++i) {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(COutPoint(InsecureRand256(), 0));
+        // Make transactions a few hundred bytes long, like real ones.
+        tx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(InsecureRandRange(300) + 1, 0x01);
+        tx.vout.emplace_back(COIN, CScript() << OP_TRUE);
+        block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+    }
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    return block;
+}
+
+/** Feed the serialized block in chunks of the given size; returns the number of bytes consumed. */
+static size_t FeedInChunks(BlockStreamParser& parser, const CDataStream& stream, size_t chunk)
+{
+    size_t available = 0;
+    while (available < stream.size()) {
+        available = std::min(stream.size(), available + chunk);
+        if (!parser.Update(stream.data(), available)) break;
+    }
+    return available;
+}
+
+BOOST_AUTO_TEST_CASE(blockstream_parse)
+{
+    const CBlock block = MakeTestBlock(500);
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << block;
+
+    for (size_t chunk : {1, 7, 1000, 65536}) {
+        BlockStreamParser parser(SER_NETWORK, PROTOCOL_VERSION, stream.size());
+        BOOST_CHECK(!parser.HasHeader());
+        FeedInChunks(parser, stream, chunk);
+        BOOST_REQUIRE(parser.GetState() == BlockStreamParser::State::COMPLETE);
+        BOOST_CHECK(parser.HasHeader());
+        std::shared_ptr<CBlock> parsed = parser.TakeBlock();
+        BOOST_CHECK_EQUAL(parsed->GetHash(), block.GetHash());
+        BOOST_REQUIRE_EQUAL(parsed->vtx.size(), block.vtx.size());
+        BOOST_CHECK_EQUAL(parsed->vtx.back()->GetHash(), block.vtx.back()->GetHash());
+    }
+
+    // The header is available as soon as its bytes are.
+    BlockStreamParser parser(SER_NETWORK, PROTOCOL_VERSION, stream.size());
+    BOOST_CHECK(parser.Update(stream.data(), ::GetSerializeSize(block.GetBlockHeader(), PROTOCOL_VERSION)));
+    BOOST_CHECK(parser.HasHeader());
+    BOOST_CHECK_EQUAL(parser.GetBlock().GetHash(), block.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(blockstream_invalid)
+{
+    // A transaction failing the context-free checks is caught before the rest arrives.
+    CBlock block = MakeTestBlock(500);
+    CMutableTransaction bad(*block.vtx[10]);
+    bad.vout[0].nValue = -1;
+    block.vtx[10] = MakeTransactionRef(std::move(bad));
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << block;
+    BlockStreamParser parser(SER_NETWORK, PROTOCOL_VERSION, stream.size());
+    BOOST_CHECK(FeedInChunks(parser, stream, 1000) < stream.size() / 2);
+    BOOST_CHECK(parser.GetState() == BlockStreamParser::State::INVALID);
+    BOOST_CHECK_EQUAL(parser.GetRejectReason(), "bad-txns-vout-negative");
+
+    // So is a missing coinbase.
+    block = MakeTestBlock(500);
+    block.vtx.erase(block.vtx.begin());
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    stream.clear();
+    stream << block;
+    BlockStreamParser no_coinbase(SER_NETWORK, PROTOCOL_VERSION, stream.size());
+    BOOST_CHECK(FeedInChunks(no_coinbase, stream, 1000) < stream.size());
+    BOOST_CHECK_EQUAL(no_coinbase.GetRejectReason(), "bad-cb-missing");
+
+    // A transaction count that cannot fit the message.
+    block = MakeTestBlock(10);
+    stream.clear();
+    stream << block.GetBlockHeader();
+    WriteCompactSize(stream, 1000000);
+    for (const auto& tx : block.vtx) stream << tx;
+    BlockStreamParser too_many(SER_NETWORK, PROTOCOL_VERSION, stream.size());
+    BOOST_CHECK(FeedInChunks(too_many, stream, 100) < stream.size());
+    BOOST_CHECK_EQUAL(too_many.GetRejectReason(), "bad-blk-length");
+
+    // The merkle root is checked once the last transaction is in.
+    block = MakeTestBlock(50);
+    block.hashMerkleRoot = InsecureRand256();
+    stream.clear();
+    stream << block;
+    BlockStreamParser bad_root(SER_NETWORK, PROTOCOL_VERSION, stream.size());
+    FeedInChunks(bad_root, stream, 1000);
+    BOOST_CHECK_EQUAL(bad_root.GetRejectReason(), "bad-txnmrklroot");
+
+    // Truncated data is malformed once the announced size has been received.
+    block = MakeTestBlock(50);
+    stream.clear();
+    stream << block;
+    stream.resize(stream.size() - 1);
+    BlockStreamParser truncated(SER_NETWORK, PROTOCOL_VERSION, stream.size());
+    FeedInChunks(truncated, stream, 1000);
+    BOOST_CHECK_EQUAL(truncated.GetRejectReason(), "bad-blk-format");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -17,6 +17,7 @@
 #include <util/strencodings.h>
 #include <test/util/setup_common.h>
 
+#include <thread>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -531,4 +532,45 @@ BOOST_AUTO_TEST_CASE(rolling_bloom)
     g_mock_deterministic_tests = false;
 }
 
+BOOST_AUTO_TEST_CASE(blocked_bloom)
+{
+    // 10000 entries, 0.1% false positive:
+    static const int DATASIZE = 10000;
+    CBlockedBloomFilter bf(DATASIZE, 0.001);
+    std::vector<uint256> data(DATASIZE);
+    for (uint256& hash : data) {
+        hash = InsecureRand256();
+    }
+
+    // Entries are inserted by several threads at once
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&bf, &data, t] {
+            for (int i = t; i < DATASIZE; i += 4) {
+                bf.insert(data[i]);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    BOOST_CHECK_EQUAL(bf.GetInsertCount(), (uint64_t)DATASIZE);
+
+    // No false negatives:
+    for (const uint256& hash : data) {
+        BOOST_CHECK(bf.contains(hash));
+    }
+
+    // Expect about 10 hits when testing 10,000 random keys
+    unsigned int nHits = 0;
+    for (int i = 0; i < 10000; i++) {
+        if (bf.contains(InsecureRand256()))
+            ++nHits;
+    }
+    BOOST_CHECK(nHits < 50);
+
+    // Around 2.7 bytes per entry
+    BOOST_CHECK(bf.DynamicMemoryUsage() < (size_t)DATASIZE * 4);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
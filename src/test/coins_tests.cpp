@@ -5,9 +5,12 @@
 #include <attributes.h>
 #include <clientversion.h>
 #include <coins.h>
+#include <coinsprefetch.h>
 #include <script/standard.h>
+#include <shutdown.h>
 #include <streams.h>
 #include <test/util/setup_common.h>
+#include <txdb.h>
 #include <uint256.h>
 #include <undo.h>
 #include <util/strencodings.h>
@@ -861,4 +864,155 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+
+BOOST_AUTO_TEST_CASE(ccoins_prefetch)
+{
+    CCoinsViewTest base;
+    std::vector<COutPoint> outpoints;
+    {
+        CCoinsViewCacheTest cache(&base);
+        for (int i = 0; i < 300; ++i) {
+            COutPoint outpoint(InsecureRand256(), i);
+            Coin coin;
+            coin.out.nValue = i + 1;
+            coin.nHeight = 1;
+            cache.AddCoin(outpoint, std::move(coin), false);
+            outpoints.push_back(outpoint);
+        }
+        cache.SetBestBlock(InsecureRand256());
+        BOOST_CHECK(cache.Flush());
+    }
+
+    CCoinsViewPrefetch prefetch(&base, &base, 2);
+    BOOST_CHECK(prefetch.IsEnabled());
+    prefetch.Prefetch(outpoints);
+    for (int i = 0; i < 500 && prefetch.GetStagedCount() < outpoints.size(); ++i) {
+        UninterruptibleSleep(std::chrono::milliseconds{10});
+    }
+    BOOST_CHECK_EQUAL(prefetch.GetStagedCount(), outpoints.size());
+
+    // Staged coins are handed over to the cache on first access, and count
+    // towards its memory usage until then.
+    CCoinsViewCacheTest cache(&prefetch);
+    BOOST_CHECK(prefetch.PendingMemoryUsage() > 0);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), memusage::DynamicUsage(cache.map()) + cache.usage() + prefetch.PendingMemoryUsage());
+    BOOST_CHECK_EQUAL(cache.AccessCoin(outpoints[0]).out.nValue, 1);
+    BOOST_CHECK_EQUAL(prefetch.GetStagedCount(), outpoints.size() - 1);
+
+    // Spending a coin and flushing drops everything staged.
+    BOOST_CHECK(cache.SpendCoin(outpoints[0]));
+    cache.SetBestBlock(InsecureRand256());
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK_EQUAL(prefetch.GetStagedCount(), 0U);
+    BOOST_CHECK_EQUAL(prefetch.PendingMemoryUsage(), 0U);
+    BOOST_CHECK(!cache.HaveCoin(outpoints[0]));
+    BOOST_CHECK(cache.HaveCoin(outpoints[1]));
+
+    CCoinsViewPrefetch disabled(&base, &base, 0);
+    BOOST_CHECK(!disabled.IsEnabled());
+    disabled.Prefetch(outpoints);
+    BOOST_CHECK_EQUAL(disabled.GetStagedCount(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_async_flush)
+{
+    gArgs.ForceSetArg("-dbasyncflush", "1");
+    gArgs.ForceSetArg("-dbbatchsize", "1024");
+    {
+        CCoinsViewDB db(GetDataDir() / "async_flush", 1 << 20, true, true);
+        CCoinsViewCache cache(&db);
+
+        std::vector<COutPoint> outpoints;
+        for (int i = 0; i < 500; ++i) {
+            COutPoint outpoint(InsecureRand256(), i);
+            Coin coin;
+            coin.out.nValue = i + 1;
+            coin.out.scriptPubKey.assign(InsecureRandBits(6), 0);
+            coin.nHeight = 1;
+            cache.AddCoin(outpoint, std::move(coin), false);
+            outpoints.push_back(outpoint);
+        }
+        uint256 block1 = InsecureRand256();
+        cache.SetBestBlock(block1);
+        BOOST_CHECK(cache.Flush());
+        BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+
+        // Whether or not the write has completed, every coin stays visible.
+        BOOST_CHECK(db.GetBestBlock() == block1);
+        for (const COutPoint& outpoint : outpoints) {
+            BOOST_CHECK(cache.HaveCoin(outpoint));
+        }
+
+        // Spend half of them in a second flush, which has to wait for the first.
+        for (size_t i = 0; i < outpoints.size(); i += 2) {
+            BOOST_CHECK(cache.SpendCoin(outpoints[i]));
+        }
+        uint256 block2 = InsecureRand256();
+        cache.SetBestBlock(block2);
+        BOOST_CHECK(cache.Flush());
+
+        BOOST_CHECK(db.SyncFlush());
+        BOOST_CHECK(!db.IsFlushing());
+        BOOST_CHECK(db.GetBestBlock() == block2);
+        BOOST_CHECK(db.GetHeadBlocks().empty());
+        for (size_t i = 0; i < outpoints.size(); ++i) {
+            Coin coin;
+            BOOST_CHECK_EQUAL(db.GetCoin(outpoints[i], coin), i % 2 == 1);
+            if (i % 2 == 1) BOOST_CHECK_EQUAL(coin.out.nValue, (CAmount)i + 1);
+        }
+    }
+    gArgs.ForceSetArg("-dbasyncflush", "0");
+    gArgs.ForceSetArg("-dbbatchsize", ToString(nDefaultDbBatchSize));
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_async_flush_failure)
+{
+    gArgs.ForceSetArg("-dbasyncflush", "1");
+    gArgs.ForceSetArg("-dbbatchsize", "1024");
+    // Fail the background write after its first chunk has been committed.
+    gArgs.ForceSetArg("-dbwritefailratio", "1");
+    {
+        CCoinsViewDB db(GetDataDir() / "async_flush_failure", 1 << 20, true, true);
+        CCoinsViewCache cache(&db);
+
+        std::vector<COutPoint> outpoints;
+        for (int i = 0; i < 500; ++i) {
+            COutPoint outpoint(InsecureRand256(), i);
+            Coin coin;
+            coin.out.nValue = i + 1;
+            coin.out.scriptPubKey.assign(InsecureRandBits(6), 0);
+            coin.nHeight = 1;
+            cache.AddCoin(outpoint, std::move(coin), false);
+            outpoints.push_back(outpoint);
+        }
+        uint256 block1 = InsecureRand256();
+        cache.SetBestBlock(block1);
+        BOOST_CHECK(cache.Flush());
+
+        BOOST_CHECK(!db.SyncFlush());
+        BOOST_CHECK(ShutdownRequested());
+
+        // Coins that were not written are still served from the in-flight map.
+        BOOST_CHECK(db.IsFlushing());
+        BOOST_CHECK(db.GetBestBlock() == block1);
+        BOOST_CHECK_EQUAL(db.GetHeadBlocks().size(), 2U);
+        for (size_t i = 0; i < outpoints.size(); ++i) {
+            Coin coin;
+            BOOST_CHECK(db.HaveCoin(outpoints[i]));
+            BOOST_CHECK(db.GetCoin(outpoints[i], coin));
+            BOOST_CHECK_EQUAL(coin.out.nValue, (CAmount)i + 1);
+        }
+
+        // Later flushes are refused rather than written over the partial state.
+        BOOST_CHECK(cache.SpendCoin(outpoints[0]));
+        cache.SetBestBlock(InsecureRand256());
+        BOOST_CHECK(!cache.Flush());
+        BOOST_CHECK(db.GetBestBlock() == block1);
+    }
+    AbortShutdown();
+    gArgs.ForceSetArg("-dbwritefailratio", "0");
+    gArgs.ForceSetArg("-dbasyncflush", "0");
+    gArgs.ForceSetArg("-dbbatchsize", ToString(nDefaultDbBatchSize));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
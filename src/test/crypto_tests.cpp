@@ -750,4 +750,22 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256d)
+{
+    for (size_t size : {0, 1, 32, 55, 56, 63, 64, 65, 76, 119, 120, 128, 200}) {
+        for (int i = 0; i <= 20; ++i) {
+            std::vector<unsigned char> in(size * i);
+            std::vector<unsigned char> out1(32 * i), out2(32 * i);
+            for (unsigned char& c : in) {
+                c = InsecureRandBits(8);
+            }
+            for (int j = 0; j < i; ++j) {
+                CHash256().Write(in.data() + size * j, size).Finalize(out1.data() + 32 * j);
+            }
+            SHA256D(out2.data(), in.data(), size, i);
+            BOOST_CHECK(out1 == out2);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -363,4 +363,50 @@ BOOST_AUTO_TEST_CASE(cuckoocache_generations)
     test_cache_generations<CuckooCache::cache<uint256, SignatureCacheHasher>>();
 }
 
+/** Test that a sharded cache can be used from several threads without
+ * external locks, finds what they inserted and counts its hits and misses.
+ */
+BOOST_AUTO_TEST_CASE(sharded_cuckoocache_parallel_ok)
+{
+    SeedInsecureRand(SeedRand::ZEROS);
+    ShardedCuckooCache cache;
+    const size_t bytes = 4 << 20;
+    const size_t capacity = cache.setup_bytes(bytes);
+    BOOST_CHECK_EQUAL(capacity, bytes / DEFAULT_SIG_CACHE_SHARDS / sizeof(uint256) * DEFAULT_SIG_CACHE_SHARDS);
+
+    // Well below the capacity, so no entry gets evicted
+    const size_t n_threads = 4;
+    const size_t n_insert = 2000;
+    std::vector<uint256> hashes(n_threads * n_insert);
+    for (uint256& hash : hashes) {
+        hash = InsecureRand256();
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < n_threads; ++t) {
+        threads.emplace_back([&cache, &hashes, t, n_insert] {
+            for (size_t i = t * n_insert; i < (t + 1) * n_insert; ++i) {
+                cache.insert(hashes[i]);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (const uint256& hash : hashes) {
+        BOOST_CHECK(cache.contains(hash, false));
+    }
+    for (size_t i = 0; i < 1000; ++i) {
+        BOOST_CHECK(!cache.contains(InsecureRand256(), false));
+    }
+
+    const CuckooCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.shards, DEFAULT_SIG_CACHE_SHARDS);
+    BOOST_CHECK_EQUAL(stats.capacity, capacity);
+    BOOST_CHECK_EQUAL(stats.hits, hashes.size());
+    BOOST_CHECK_EQUAL(stats.misses, 1000U);
+    BOOST_CHECK_EQUAL(stats.inserts, hashes.size());
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -411,4 +411,64 @@ BOOST_AUTO_TEST_CASE(unicodepath)
 }
 
 
+BOOST_AUTO_TEST_CASE(dboption_parse)
+{
+    std::string db_name, option;
+    int64_t value;
+    BOOST_CHECK(ParseDBOption("txindex:bloombits=16", db_name, option, value));
+    BOOST_CHECK_EQUAL(db_name, "txindex");
+    BOOST_CHECK_EQUAL(option, "bloombits");
+    BOOST_CHECK_EQUAL(value, 16);
+    BOOST_CHECK(ParseDBOption("blockfilter/basic:cache=64", db_name, option, value));
+    BOOST_CHECK_EQUAL(db_name, "blockfilter/basic");
+    BOOST_CHECK(ParseDBOption("chainstate:writebuffer=0", db_name, option, value));
+
+    BOOST_CHECK(!ParseDBOption("txindex", db_name, option, value));
+    BOOST_CHECK(!ParseDBOption(":cache=1", db_name, option, value));
+    BOOST_CHECK(!ParseDBOption("txindex:cache", db_name, option, value));
+    BOOST_CHECK(!ParseDBOption("txindex:cache=-1", db_name, option, value));
+    BOOST_CHECK(!ParseDBOption("txindex:cache=x", db_name, option, value));
+    BOOST_CHECK(!ParseDBOption("txindex:compression=1", db_name, option, value));
+    BOOST_CHECK(!ParseDBOption("txindex:bloombits=65", db_name, option, value));
+}
+
+BOOST_AUTO_TEST_CASE(dboption_apply)
+{
+    gArgs.ForceSetArg("-dboption", "dboption_test:cache=2");
+    DBOptions db_options = GetDBOptions("dboption_test", 1 << 20);
+    BOOST_CHECK_EQUAL(db_options.cache_size, (size_t)2 << 20);
+    BOOST_CHECK_EQUAL(db_options.bloom_bits, DEFAULT_DB_BLOOM_BITS);
+    BOOST_CHECK_EQUAL(db_options.write_buffer_size, 0U);
+
+    // Settings only apply to the database they name
+    db_options = GetDBOptions("unconfigured", 1 << 20);
+    BOOST_CHECK_EQUAL(db_options.cache_size, (size_t)1 << 20);
+
+    gArgs.ForceSetArg("-dboption", "dboption_test:bloombits=0");
+    {
+        CDBWrapper dbw(GetDataDir() / "dboption", 1 << 20, false, true, false, "dboption_test");
+        for (int i = 0; i < 1000; i++) {
+            BOOST_CHECK(dbw.Write(i, InsecureRand256()));
+        }
+        dbw.CompactRange(0, 1000);
+
+        int found = 0;
+        for (const DBStats& stats : GetDBStats()) {
+            if (stats.name != "dboption_test") continue;
+            ++found;
+            BOOST_CHECK_EQUAL(stats.options.bloom_bits, 0);
+            BOOST_CHECK_EQUAL(stats.options.cache_size, (size_t)1 << 20);
+            BOOST_CHECK(!stats.levels.empty());
+            BOOST_CHECK(stats.read_amplification >= 1);
+        }
+        BOOST_CHECK_EQUAL(found, 1);
+    }
+
+    // Closed databases are no longer listed
+    for (const DBStats& stats : GetDBStats()) {
+        BOOST_CHECK(stats.name != "dboption_test");
+    }
+    gArgs.ForceSetArg("-dboption", "");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,84 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/jsonstream.h>
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(jsonstream_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(jsonstream_matches_univalue)
+{
+    UniValue doc(UniValue::VOBJ);
+    doc.pushKV("hash", "00ff");
+    doc.pushKV("escaped \"key\"\n", "line\nbreak");
+    doc.pushKV("empty", UniValue(UniValue::VARR));
+    doc.pushKV("null", NullUniValue);
+    UniValue txs(UniValue::VARR);
+    for (int i = 0; i < 50; ++i) {
+        UniValue tx(UniValue::VOBJ);
+        tx.pushKV("n", i);
+        tx.pushKV("value", 0.5 * i);
+        tx.pushKV("flag", i % 2 == 0);
+        txs.push_back(tx);
+    }
+    doc.pushKV("tx", txs);
+    doc.pushKV("nested", UniValue(UniValue::VOBJ));
+
+    std::string out;
+    size_t chunks = 0;
+    JSONStreamWriter writer([&](const std::string& chunk) { out += chunk; ++chunks; }, 100);
+    writer.BeginObject();
+    for (size_t i = 0; i < doc.size(); ++i) {
+        if (doc.getKeys()[i] == "tx") {
+            writer.Key("tx");
+            writer.BeginArray();
+            for (const UniValue& tx : txs.getValues()) writer.Value(tx);
+            writer.EndArray();
+        } else if (doc.getKeys()[i] == "nested") {
+            writer.Key("nested");
+            writer.BeginObject();
+            writer.EndObject();
+        } else {
+            writer.Pair(doc.getKeys()[i], doc.getValues()[i]);
+        }
+    }
+    writer.EndObject();
+    BOOST_CHECK(writer.IsCommitted());
+    writer.Flush();
+
+    BOOST_CHECK_EQUAL(out, doc.write());
+    BOOST_CHECK(chunks > 1);
+    // Output is handed on as it is produced, not all at once
+    BOOST_CHECK(writer.GetPeakBuffered() < out.size() / 2);
+}
+
+BOOST_AUTO_TEST_CASE(jsonstream_array_result)
+{
+    UniValue expected(UniValue::VARR);
+    for (int i = 0; i < 10; ++i) expected.push_back(i);
+
+    // Without a stream the array is returned as usual
+    JSONArrayResult plain(nullptr, 5);
+    for (int i = 0; i < 10; ++i) plain.push_back(i);
+    BOOST_CHECK_EQUAL(plain.Finish().write(), expected.write());
+
+    // Below the threshold nothing is streamed
+    std::string out;
+    auto stream = std::make_shared<JSONStreamWriter>([&](const std::string& chunk) { out += chunk; });
+    JSONArrayResult small(stream, 20);
+    for (int i = 0; i < 10; ++i) small.push_back(i);
+    BOOST_CHECK_EQUAL(small.Finish().write(), expected.write());
+    BOOST_CHECK(stream->TakeBuffered().empty());
+
+    // From the threshold on the elements go to the stream
+    JSONArrayResult large(stream, 5);
+    for (int i = 0; i < 10; ++i) large.push_back(i);
+    BOOST_CHECK(large.Finish().isNull());
+    stream->Flush();
+    BOOST_CHECK_EQUAL(out, expected.write());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -11,6 +11,7 @@
 #include <serialize.h>
 #include <streams.h>
 #include <net.h>
+#include <netmessagemaker.h>
 #include <netbase.h>
 #include <chainparams.h>
 #include <util/memory.h>
@@ -191,6 +192,31 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+BOOST_AUTO_TEST_CASE(cnode_shared_payload)
+{
+    CConnman connman(0, 0);
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = 0xa0b0c001;
+    CAddress addr = CAddress(CService(ipv4Addr, 7777), NODE_NETWORK);
+    std::unique_ptr<CNode> pnode1 = MakeUnique<CNode>(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), std::string(), false);
+    std::unique_ptr<CNode> pnode2 = MakeUnique<CNode>(1, NODE_NETWORK, 0, INVALID_SOCKET, addr, 1, 1, CAddress(), std::string(), false);
+
+    auto payload = CNetMsgMaker(PROTOCOL_VERSION).MakePayload(0, std::vector<unsigned char>(1000, 0x42));
+    connman.PushMessage(pnode1.get(), CNetMsgMaker::MakeShared(NetMsgType::BLOCK, payload));
+    connman.PushMessage(pnode2.get(), CNetMsgMaker::MakeShared(NetMsgType::BLOCK, payload));
+
+    for (CNode* pnode : {pnode1.get(), pnode2.get()}) {
+        LOCK(pnode->cs_vSend);
+        // Header plus the payload, which is queued without being copied.
+        BOOST_CHECK_EQUAL(pnode->vSendMsg.size(), 2U);
+        BOOST_CHECK(pnode->vSendMsg[1].get() == &payload->data);
+        BOOST_CHECK_EQUAL(pnode->nSendSize, CMessageHeader::HEADER_SIZE + payload->data.size());
+        // The checksum in the header comes from the payload's precomputed hash.
+        const std::vector<unsigned char>& header = *pnode->vSendMsg[0];
+        BOOST_CHECK(std::equal(payload->hash.begin(), payload->hash.begin() + CMessageHeader::CHECKSUM_SIZE, header.end() - CMessageHeader::CHECKSUM_SIZE));
+    }
+}
+
 // prior to PR #14728, this test triggers an undefined behavior
 BOOST_AUTO_TEST_CASE(ipv4_peer_with_ipv6_addrMe_test)
 {
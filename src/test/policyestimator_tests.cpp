@@ -2,10 +2,14 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <clientversion.h>
+#include <fs.h>
 #include <policy/policy.h>
 #include <policy/fees.h>
+#include <streams.h>
 #include <txmempool.h>
 #include <uint256.h>
+#include <util/system.h>
 #include <util/time.h>
 
 #include <test/util/setup_common.h>
@@ -180,4 +184,104 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
     }
 }
 
+BOOST_AUTO_TEST_CASE(GasPriceEstimates)
+{
+    CBlockPolicyEstimator feeEst;
+    CTxMemPool mpool(&feeEst);
+    LOCK2(cs_main, mpool.cs);
+    TestMemPoolEntryHelper entry;
+    const CAmount minGasPrice = 40;
+    const uint64_t blockGasLimit = 40000000;
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << OP_CALL;
+
+    std::vector<CTransactionRef> block;
+    unsigned int blocknum = 0;
+
+    // Nothing seen yet
+    BOOST_CHECK_EQUAL(feeEst.estimateSmartGasPrice(2, minGasPrice, nullptr, true), 0);
+    BOOST_CHECK(feeEst.GetBlockGasUtilization() < 0);
+
+    // Blocks far from their gas limit take the minimum gas price
+    while (blocknum < 10) {
+        ++blocknum;
+        feeEst.processBlockGas(blocknum, blockGasLimit / 100, blockGasLimit);
+        mpool.removeForBlock(block, blocknum);
+    }
+    FeeCalculation feeCalc;
+    BOOST_CHECK_EQUAL(feeEst.estimateSmartGasPrice(2, minGasPrice, &feeCalc, true), minGasPrice);
+    BOOST_CHECK(feeCalc.reason == FeeReason::MIN_GAS_PRICE);
+    BOOST_CHECK(feeEst.GetBlockGasUtilization() < 0.05);
+
+    // Full blocks without contract transactions to go by give no estimate
+    while (blocknum < 40) {
+        ++blocknum;
+        feeEst.processBlockGas(blocknum, blockGasLimit, blockGasLimit);
+        mpool.removeForBlock(block, blocknum);
+    }
+    BOOST_CHECK(feeEst.GetBlockGasUtilization() > 0.5);
+    BOOST_CHECK_EQUAL(feeEst.estimateSmartGasPrice(2, minGasPrice, nullptr, true), 0);
+
+    // Full blocks where contract transactions with higher gas prices are included sooner
+    std::vector<uint256> txHashes[10];
+    while (blocknum < 240) {
+        for (int j = 0; j < 10; j++) { // For each gas price
+            for (int k = 0; k < 4; k++) { // add 4 contract txs
+                tx.vin[0].prevout.n = 10000*blocknum+100*j+k;
+                mpool.addUnchecked(entry.Fee(10000).MinGasPrice(minGasPrice * (j+1)).Time(GetTime()).Height(blocknum).FromTx(tx));
+                txHashes[j].push_back(tx.GetHash());
+            }
+        }
+        for (unsigned int h = 0; h <= blocknum%10; h++) {
+            while (txHashes[9-h].size()) {
+                CTransactionRef ptx = mpool.get(txHashes[9-h].back());
+                if (ptx)
+                    block.push_back(ptx);
+                txHashes[9-h].pop_back();
+            }
+        }
+        ++blocknum;
+        feeEst.processBlockGas(blocknum, blockGasLimit, blockGasLimit);
+        mpool.removeForBlock(block, blocknum);
+        block.clear();
+    }
+
+    // Contract transactions are not used for feerate estimates
+    BOOST_CHECK(feeEst.estimateSmartFee(2, nullptr, true) == CFeeRate(0));
+
+    CAmount lastEst = 0;
+    for (int i = 2; i <= 4; i++) {
+        CAmount est = feeEst.estimateSmartGasPrice(i, minGasPrice, &feeCalc, true);
+        BOOST_CHECK(est > minGasPrice);
+        BOOST_CHECK(est <= minGasPrice * 10 * 1.05);
+        // Estimates do not increase with the target
+        if (i > 2) BOOST_CHECK(est <= lastEst);
+        // Economical estimates are never above conservative ones
+        BOOST_CHECK(feeEst.estimateSmartGasPrice(i, minGasPrice, nullptr, false) <= est);
+        lastEst = est;
+    }
+    // The DGP minimum is a lower bound
+    BOOST_CHECK_EQUAL(feeEst.estimateSmartGasPrice(2, minGasPrice * 100, nullptr, true), minGasPrice * 100);
+
+    // Gas price data survives a round trip through the estimates file
+    feeEst.FlushUnconfirmed();
+    const fs::path est_path = GetDataDir() / "fee_estimates.dat";
+    {
+        CAutoFile est_fileout(fsbridge::fopen(est_path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(feeEst.Write(est_fileout));
+    }
+    CBlockPolicyEstimator feeEstRead;
+    {
+        CAutoFile est_filein(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(feeEstRead.Read(est_filein));
+    }
+    for (int i = 2; i <= 4; i++) {
+        BOOST_CHECK_EQUAL(feeEstRead.estimateSmartGasPrice(i, minGasPrice, nullptr, true), feeEst.estimateSmartGasPrice(i, minGasPrice, nullptr, true));
+    }
+    BOOST_CHECK_EQUAL(feeEstRead.GetBlockGasUtilization(), feeEst.GetBlockGasUtilization());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
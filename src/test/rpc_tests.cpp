@@ -19,6 +19,8 @@
 
 #include <rpc/blockchain.h>
 
+#include <thread>
+
 UniValue CallRPC(std::string args)
 {
     std::vector<std::string> vArgs;
@@ -231,6 +233,45 @@ BOOST_AUTO_TEST_CASE(json_parse_errors)
     BOOST_CHECK_THROW(ParseNonRFCJSONValue("3J98t1WpEZ73CNmQviecrnyiWrnqRhWNL"), std::runtime_error);
 }
 
+BOOST_AUTO_TEST_CASE(rpc_batch)
+{
+    if (RPCIsInWarmup(nullptr)) SetRPCWarmupFinished();
+    UniValue batch(UniValue::VARR);
+    for (int i = 0; i < 100; ++i) {
+        UniValue req(UniValue::VOBJ);
+        req.pushKV("id", i);
+        req.pushKV("method", i % 10 == 9 ? "nosuchmethod" : "echo");
+        UniValue params(UniValue::VARR);
+        params.push_back(i);
+        req.pushKV("params", params);
+        batch.push_back(req);
+    }
+    const JSONRPCRequest jreq;
+    const std::string sequential = JSONRPCExecBatch(jreq, batch);
+
+    // Spread over threads, the replies still come back in request order
+    std::vector<std::thread> threads;
+    const RPCTaskDispatcher dispatch = [&threads](std::function<void()> task) {
+        threads.emplace_back(std::move(task));
+        return true;
+    };
+    const std::string parallel = JSONRPCExecBatch(jreq, batch, 4, dispatch);
+    for (std::thread& thread : threads) thread.join();
+    BOOST_CHECK_EQUAL(threads.size(), 3U);
+    BOOST_CHECK_EQUAL(parallel, sequential);
+
+    UniValue replies;
+    BOOST_REQUIRE(replies.read(parallel));
+    BOOST_REQUIRE_EQUAL(replies.size(), 100U);
+    BOOST_CHECK_EQUAL(find_value(replies[42], "id").get_int(), 42);
+    BOOST_CHECK_EQUAL(find_value(replies[42], "result")[0].get_int(), 42);
+    BOOST_CHECK(find_value(replies[49], "error").isObject());
+
+    // A dispatcher that cannot queue anything leaves the work to the caller
+    const std::string refused = JSONRPCExecBatch(jreq, batch, 4, [](std::function<void()>) { return false; });
+    BOOST_CHECK_EQUAL(refused, sequential);
+}
+
 BOOST_AUTO_TEST_CASE(rpc_ban)
 {
     BOOST_CHECK_NO_THROW(CallRPC(std::string("clearbanned")));
@@ -6,7 +6,10 @@
 #include <index/txindex.h>
 #include <script/standard.h>
 #include <test/util/setup_common.h>
+#include <util/system.h>
 #include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -78,4 +81,135 @@ BOOST_FIXTURE_TEST_CASE(txindex_initial_sync, TestChain100Setup)
     // Rest of shutdown sequence and destructors happen in ~TestingSetup()
 }
 
+BOOST_FIXTURE_TEST_CASE(txindex_initial_sync_threads, TestChain100Setup)
+{
+    // Blocks are read ahead by the workers and must still be written in chain
+    // order, with every block written exactly once.
+    for (int threads : {0, 1, 3, MAX_INDEX_THREADS}) {
+        gArgs.ForceSetArg("-indexthreads", std::to_string(threads));
+        TxIndex txindex(1 << 20, true);
+        txindex.Start();
+
+        constexpr int64_t timeout_ms = 10 * 1000;
+        int64_t time_start = GetTimeMillis();
+        while (!txindex.BlockUntilSyncedToCurrentChain()) {
+            BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+            UninterruptibleSleep(std::chrono::milliseconds{100});
+        }
+
+        CTransactionRef tx_disk;
+        uint256 block_hash;
+        for (const auto& txn : m_coinbase_txns) {
+            BOOST_REQUIRE(txindex.FindTx(txn->GetHash(), block_hash, tx_disk));
+            BOOST_CHECK(tx_disk->GetHash() == txn->GetHash());
+            const CBlockIndex* pindex = WITH_LOCK(cs_main, return LookupBlockIndex(block_hash));
+            BOOST_REQUIRE(pindex);
+            BOOST_CHECK(WITH_LOCK(cs_main, return ::ChainActive().Contains(pindex)));
+        }
+
+        txindex.Stop();
+        SyncWithValidationInterfaceQueue();
+    }
+    gArgs.ForceSetArg("-indexthreads", std::to_string(DEFAULT_INDEX_THREADS));
+
+    m_node.scheduler->stop();
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_FIXTURE_TEST_CASE(txindex_lookup_filter, TestChain100Setup)
+{
+    TxIndex txindex(1 << 20, true);
+    txindex.Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!txindex.BlockUntilSyncedToCurrentChain() || !txindex.GetFilterStats().ready) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+
+    TxIndex::FilterStats stats = txindex.GetFilterStats();
+    BOOST_CHECK(stats.enabled);
+    BOOST_CHECK(stats.memory_usage > 0);
+    BOOST_CHECK(stats.entries >= m_coinbase_txns.size());
+
+    // Unknown transactions are not found, and almost all of them without
+    // reading the database.
+    CTransactionRef tx_disk;
+    uint256 block_hash;
+    for (int i = 0; i < 1000; i++) {
+        BOOST_CHECK(!txindex.FindTx(InsecureRand256(), block_hash, tx_disk));
+    }
+    stats = txindex.GetFilterStats();
+    BOOST_CHECK_EQUAL(stats.skipped_lookups + stats.false_positives, 1000U);
+    BOOST_CHECK(stats.false_positives < 20);
+
+    // Indexed transactions are always found, including those of blocks
+    // connected after the filter was built.
+    CScript coinbase_script_pub_key = GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()));
+    std::vector<CMutableTransaction> no_txns;
+    const CBlock& block = CreateAndProcessBlock(no_txns, coinbase_script_pub_key);
+    BOOST_CHECK(txindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(txindex.FindTx(block.vtx[0]->GetHash(), block_hash, tx_disk));
+    for (const auto& txn : m_coinbase_txns) {
+        BOOST_CHECK(txindex.FindTx(txn->GetHash(), block_hash, tx_disk));
+    }
+
+    txindex.Stop();
+
+    m_node.scheduler->stop();
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_FIXTURE_TEST_CASE(txindex_lookup_filter_rebuild, TestChain100Setup)
+{
+    // Size the filter for far fewer transactions than the chain already has
+    gArgs.ForceSetArg("-txindexfiltersize", "10");
+    TxIndex txindex(1 << 20, true);
+    txindex.Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!txindex.BlockUntilSyncedToCurrentChain() || !txindex.GetFilterStats().ready) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+    TxIndex::FilterStats stats;
+
+    // A block written once the filter is past its capacity starts building a
+    // larger one, which takes over once done.
+    CScript coinbase_script_pub_key = GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()));
+    std::vector<CMutableTransaction> no_txns;
+    const CBlock& block = CreateAndProcessBlock(no_txns, coinbase_script_pub_key);
+    BOOST_CHECK(txindex.BlockUntilSyncedToCurrentChain());
+    time_start = GetTimeMillis();
+    while ((stats = txindex.GetFilterStats()).capacity <= stats.entries) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+    BOOST_CHECK(stats.ready);
+    BOOST_CHECK(stats.capacity > 10);
+    BOOST_CHECK(stats.entries >= m_coinbase_txns.size() + 1);
+
+    CTransactionRef tx_disk;
+    uint256 block_hash;
+    BOOST_CHECK(txindex.FindTx(block.vtx[0]->GetHash(), block_hash, tx_disk));
+    for (const auto& txn : m_coinbase_txns) {
+        BOOST_CHECK(txindex.FindTx(txn->GetHash(), block_hash, tx_disk));
+    }
+    for (int i = 0; i < 1000; i++) {
+        BOOST_CHECK(!txindex.FindTx(InsecureRand256(), block_hash, tx_disk));
+    }
+    BOOST_CHECK(txindex.GetFilterStats().false_positives < 20);
+
+    txindex.Stop();
+    gArgs.ForceSetArg("-txindexfiltersize", "0");
+
+    m_node.scheduler->stop();
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
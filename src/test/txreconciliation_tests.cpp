@@ -0,0 +1,168 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <txreconciliation.h>
+#include <version.h>
+
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(txreconciliation_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(sketch_decode)
+{
+    const size_t common = 1000, only_ours = 7, only_theirs = 5;
+    const size_t cells = ReconSketch::CellsForCapacity(only_ours + only_theirs);
+    ReconSketch ours(cells), theirs(cells);
+    std::set<uint32_t> expected_ours, expected_theirs;
+    for (size_t i = 0; i < common; ++i) {
+        uint32_t id = InsecureRand32();
+        ours.Add(id);
+        theirs.Add(id);
+    }
+    while (expected_ours.size() < only_ours) {
+        uint32_t id = InsecureRand32();
+        if (expected_ours.insert(id).second) ours.Add(id);
+    }
+    while (expected_theirs.size() < only_theirs) {
+        uint32_t id = InsecureRand32();
+        if (expected_theirs.insert(id).second) theirs.Add(id);
+    }
+
+    // Round trip the peer's sketch through serialization, like "sketch" does.
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << theirs;
+    ReconSketch received;
+    stream >> received;
+    BOOST_CHECK_EQUAL(received.GetCells(), cells);
+    BOOST_CHECK(received.IsValid());
+
+    ours.Subtract(received);
+    std::vector<uint32_t> decoded_ours, decoded_theirs;
+    // A single decode may fail with low probability; the ids above are random.
+    if (ours.Decode(decoded_ours, decoded_theirs)) {
+        BOOST_CHECK(std::set<uint32_t>(decoded_ours.begin(), decoded_ours.end()) == expected_ours);
+        BOOST_CHECK(std::set<uint32_t>(decoded_theirs.begin(), decoded_theirs.end()) == expected_theirs);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sketch_decode_rate)
+{
+    // Decoding must succeed almost always when the difference fits the capacity...
+    int failures = 0;
+    for (int round = 0; round < 200; ++round) {
+        const size_t capacity = 1 + InsecureRandRange(100);
+        ReconSketch sketch(ReconSketch::CellsForCapacity(capacity));
+        for (size_t i = 0; i < capacity; ++i) {
+            sketch.Add(InsecureRand32());
+        }
+        std::vector<uint32_t> ours, theirs;
+        if (!sketch.Decode(ours, theirs)) {
+            ++failures;
+        } else {
+            BOOST_CHECK_EQUAL(ours.size(), capacity);
+            BOOST_CHECK(theirs.empty());
+        }
+    }
+    BOOST_CHECK(failures < 20);
+
+    // ...and fail, rather than return garbage, when it is far too large.
+    ReconSketch small(ReconSketch::CellsForCapacity(10));
+    for (int i = 0; i < 500; ++i) {
+        small.Add(InsecureRand32());
+    }
+    std::vector<uint32_t> ours, theirs;
+    BOOST_CHECK(!small.Decode(ours, theirs));
+
+    // An empty difference trivially decodes.
+    ReconSketch empty(ReconSketch::CellsForCapacity(1));
+    BOOST_CHECK(empty.Decode(ours, theirs));
+    BOOST_CHECK(ours.empty() && theirs.empty());
+
+    // Sizes a peer could not have produced are rejected.
+    BOOST_CHECK(!ReconSketch().IsValid());
+    BOOST_CHECK(!ReconSketch(ReconSketch::NUM_HASHES + 1).IsValid());
+    BOOST_CHECK(!ReconSketch(MAX_SKETCH_CELLS + ReconSketch::NUM_HASHES).IsValid());
+}
+
+BOOST_AUTO_TEST_CASE(sketch_malicious)
+{
+    // Oversized sketches are rejected before their cells are read.
+    CDataStream oversized(SER_NETWORK, PROTOCOL_VERSION);
+    WriteCompactSize(oversized, MAX_SKETCH_CELLS + ReconSketch::NUM_HASHES);
+    ReconSketch received;
+    BOOST_CHECK_THROW(oversized >> received, std::ios_base::failure);
+
+    // With one cell per part, an id maps to every cell. Clearing the last
+    // cell of a single-id sketch makes peeling the id recreate it in the last
+    // cell with the opposite sign, and peeling that recreates the original.
+    ReconSketch sketch(ReconSketch::NUM_HASHES);
+    sketch.Add(InsecureRand32());
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << sketch;
+    const size_t cell_size = ::GetSerializeSize(ReconSketch::Cell(), PROTOCOL_VERSION);
+    std::fill(stream.end() - cell_size, stream.end(), 0);
+    stream >> received;
+    std::vector<uint32_t> ours, theirs;
+    BOOST_CHECK(!received.Decode(ours, theirs));
+
+    // Ids map to different cells under different salts.
+    const size_t cells = ReconSketch::CellsForCapacity(100);
+    ReconSketch salted1(cells, InsecureRand64()), salted2(cells, InsecureRand64());
+    for (int i = 0; i < 10; ++i) {
+        const uint32_t id = InsecureRand32();
+        salted1.Add(id);
+        salted2.Add(id);
+    }
+    CDataStream stream1(SER_NETWORK, PROTOCOL_VERSION), stream2(SER_NETWORK, PROTOCOL_VERSION);
+    stream1 << salted1;
+    stream2 << salted2;
+    BOOST_CHECK(stream1.str() != stream2.str());
+}
+
+BOOST_AUTO_TEST_CASE(reconciliation_state)
+{
+    const uint64_t salt1 = InsecureRand64(), salt2 = InsecureRand64();
+    TxReconciliationState initiator(true, salt1, salt2);
+    TxReconciliationState responder(false, salt2, salt1);
+
+    // Both sides agree on short ids.
+    const uint256 txid = InsecureRand256();
+    BOOST_CHECK_EQUAL(initiator.GetShortId(txid), responder.GetShortId(txid));
+    BOOST_CHECK_NE(initiator.GetShortId(txid), TxReconciliationState(true, salt1, salt1 + 1).GetShortId(txid));
+
+    std::vector<uint256> shared;
+    for (int i = 0; i < 100; ++i) {
+        shared.push_back(InsecureRand256());
+        initiator.m_local_set.insert(shared.back());
+        responder.m_local_set.insert(shared.back());
+    }
+    const uint256 initiator_only = InsecureRand256();
+    const uint256 responder_only = InsecureRand256();
+    initiator.m_local_set.insert(initiator_only);
+    responder.m_local_set.insert(responder_only);
+
+    initiator.TakeSnapshot();
+    responder.TakeSnapshot();
+    BOOST_CHECK(initiator.m_local_set.empty());
+    BOOST_CHECK_EQUAL(initiator.m_snapshot.size(), 101U);
+
+    // The responder sizes its sketch from both set sizes; the initiator matches it.
+    const size_t cells = TxReconciliationState::EstimateCells(responder.m_snapshot.size(), initiator.m_snapshot.size());
+    BOOST_CHECK_EQUAL(cells, TxReconciliationState::EstimateCells(initiator.m_snapshot.size(), responder.m_snapshot.size()));
+    ReconSketch diff = initiator.MakeSketch(cells);
+    diff.Subtract(responder.MakeSketch(cells));
+    std::vector<uint32_t> ours, theirs;
+    BOOST_REQUIRE(diff.Decode(ours, theirs));
+    BOOST_REQUIRE_EQUAL(ours.size(), 1U);
+    BOOST_REQUIRE_EQUAL(theirs.size(), 1U);
+    BOOST_CHECK(initiator.m_snapshot.at(ours[0]) == initiator_only);
+    BOOST_CHECK(responder.m_snapshot.at(theirs[0]) == responder_only);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
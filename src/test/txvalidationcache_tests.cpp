@@ -95,6 +95,70 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_block_doublespend, TestChain100Setup)
     BOOST_CHECK_EQUAL(m_node.mempool->size(), 0U);
 }
 
+BOOST_FIXTURE_TEST_CASE(mempool_batch_accept, TestChain100Setup)
+{
+    // Transactions accepted as a batch have their scripts verified together,
+    // but must end up exactly as if they had been accepted one at a time.
+    CScript scriptPubKey = CScript() <<  ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    const auto MakeSpend = [&](const CTransactionRef& coinbase, CAmount value) {
+        CMutableTransaction spend;
+        spend.nVersion = 1;
+        spend.vin.resize(1);
+        spend.vin[0].prevout = COutPoint(coinbase->GetHash(), 0);
+        spend.vout.resize(1);
+        spend.vout[0].nValue = value;
+        spend.vout[0].scriptPubKey = scriptPubKey;
+
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        spend.vin[0].scriptSig << vchSig;
+        return spend;
+    };
+
+    std::vector<CTransactionRef> txs;
+    for (int i = 0; i < 5; i++) {
+        txs.push_back(MakeTransactionRef(MakeSpend(m_coinbase_txns[i], 11*CENT)));
+    }
+    // A double spend of an earlier transaction in the batch
+    txs.push_back(MakeTransactionRef(MakeSpend(m_coinbase_txns[0], 12*CENT)));
+    // A spend carrying the signature of another transaction
+    CMutableTransaction bad_sig = MakeSpend(m_coinbase_txns[5], 11*CENT);
+    bad_sig.vin[0].scriptSig = txs[1]->vin[0].scriptSig;
+    txs.push_back(MakeTransactionRef(bad_sig));
+
+    LOCK(cs_main);
+    std::vector<TxValidationState> states;
+    BOOST_CHECK_EQUAL(AcceptToMemoryPoolBatch(*m_node.mempool, txs, states, true /* bypass_limits */, 0 /* nAbsurdFee */), 5U);
+    BOOST_REQUIRE_EQUAL(states.size(), txs.size());
+    for (int i = 0; i < 5; i++) {
+        BOOST_CHECK(states[i].IsValid());
+        BOOST_CHECK(m_node.mempool->exists(txs[i]->GetHash()));
+    }
+    BOOST_CHECK_EQUAL(states[5].GetRejectReason(), "txn-mempool-conflict");
+    BOOST_CHECK(states[6].GetRejectReason().rfind("mandatory-script-verify-flag-failed", 0) == 0);
+    BOOST_CHECK_EQUAL(m_node.mempool->size(), 5U);
+
+    // A failing check of a batch records where it failed, so that accepting
+    // the transaction does not have to verify all of its scripts again.
+    ScriptCheckFailure failure;
+    PrecomputedTransactionData txdata(*txs[6]);
+    CScriptCheck check(m_coinbase_txns[5]->vout[0], *txs[6], 0, SCRIPT_VERIFY_P2SH, false, &txdata);
+    check.SetFailureRecord(&failure);
+    BOOST_CHECK(!check());
+    BOOST_CHECK(failure.m_failed);
+    BOOST_CHECK_EQUAL(failure.m_input, 0U);
+    BOOST_CHECK_EQUAL(failure.m_output, -1);
+    BOOST_CHECK_EQUAL(failure.m_error, check.GetScriptError());
+
+    // Verifying ahead of time does not add anything by itself.
+    m_node.mempool->clear();
+    PreVerifyTransactionScripts(*m_node.mempool, txs);
+    BOOST_CHECK_EQUAL(m_node.mempool->size(), 0U);
+}
+
 // Run CheckInputScripts (using CoinsTip()) on the given transaction, for all script
 // flags.  Test that CheckInputScripts passes for all flags that don't overlap with
 // the failing_flags argument, but otherwise fails.
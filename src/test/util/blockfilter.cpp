@@ -5,6 +5,7 @@
 #include <test/util/blockfilter.h>
 
 #include <chainparams.h>
+#include <index/blockfilterindex.h>
 #include <validation.h>
 
 
@@ -15,6 +16,11 @@ bool ComputeFilter(BlockFilterType filter_type, const CBlockIndex* block_index,
         return false;
     }
 
+    if (filter_type == BlockFilterType::CONTRACT) {
+        filter = BlockFilter(filter_type, block.GetHash(), ContractFilterElements(block));
+        return true;
+    }
+
     CBlockUndo block_undo;
     if (block_index->nHeight > 0 && !UndoReadFromDisk(block_undo, block_index)) {
         return false;
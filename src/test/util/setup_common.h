@@ -128,10 +128,11 @@ struct TestMemPoolEntryHelper
     bool spendsCoinbase;
     unsigned int sigOpCost;
     LockPoints lp;
+    CAmount nMinGasPrice;
 
     TestMemPoolEntryHelper() :
         nFee(0), nTime(0), nHeight(1),
-        spendsCoinbase(false), sigOpCost(4) { }
+        spendsCoinbase(false), sigOpCost(4), nMinGasPrice(0) { }
 
     CTxMemPoolEntry FromTx(const CMutableTransaction& tx);
     CTxMemPoolEntry FromTx(const CTransactionRef& tx);
@@ -142,6 +143,7 @@ struct TestMemPoolEntryHelper
     TestMemPoolEntryHelper &Height(unsigned int _height) { nHeight = _height; return *this; }
     TestMemPoolEntryHelper &SpendsCoinbase(bool _flag) { spendsCoinbase = _flag; return *this; }
     TestMemPoolEntryHelper &SigOpsCost(unsigned int _sigopsCost) { sigOpCost = _sigopsCost; return *this; }
+    TestMemPoolEntryHelper &MinGasPrice(CAmount _minGasPrice) { nMinGasPrice = _minGasPrice; return *this; }
 };
 
 CBlock getBlock13b8a();
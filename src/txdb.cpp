@@ -14,6 +14,7 @@
 #include <util/translation.h>
 #include <util/vector.h>
 #include <validation.h>
+#include <warnings.h>
 #include <chainparams.h>
 
 #include <stdint.h>
@@ -89,25 +90,84 @@ struct DelegateEntry {
 
 }
 
-CCoinsViewDB::CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe) : db(ldb_path, nCacheSize, fMemory, fWipe, true)
+template<typename... Args>
+static void FatalError(const char* fmt, const Args&... args)
 {
+    std::string strMessage = tfm::format(fmt, args...);
+    SetMiscWarning(strMessage);
+    LogPrintf("*** %s\n", strMessage);
+    uiInterface.ThreadSafeMessageBox(
+        "Error: A fatal internal error occurred, see debug.log for details",
+        "", CClientUIInterface::MSG_ERROR);
+    StartShutdown();
+}
+
+CCoinsViewDB::CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(ldb_path, nCacheSize, fMemory, fWipe, true, "chainstate"),
+    m_async_flush(gArgs.GetBoolArg("-dbasyncflush", DEFAULT_DB_ASYNC_FLUSH))
+{
+    if (m_async_flush) {
+        m_flush_thread = std::thread(&TraceThread<std::function<void()>>, "coinsflush", std::bind(&CCoinsViewDB::ThreadFlush, this));
+    }
+}
+
+CCoinsViewDB::~CCoinsViewDB()
+{
+    if (m_flush_thread.joinable()) {
+        {
+            LOCK(m_flush_mutex);
+            m_flush_stop = true;
+        }
+        m_flush_cv.notify_all();
+        // The thread finishes any pending write before exiting.
+        m_flush_thread.join();
+    }
 }
 
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    if (m_async_flush) {
+        LOCK(m_flush_mutex);
+        if (!m_flush_block.IsNull()) {
+            CCoinsMap::const_iterator it = m_flush_coins.find(outpoint);
+            if (it != m_flush_coins.end()) {
+                coin = it->second.coin;
+                return !coin.IsSpent();
+            }
+        }
+    }
     return db.Read(CoinEntry(&outpoint), coin);
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    if (m_async_flush) {
+        LOCK(m_flush_mutex);
+        if (!m_flush_block.IsNull()) {
+            CCoinsMap::const_iterator it = m_flush_coins.find(outpoint);
+            if (it != m_flush_coins.end()) {
+                return !it->second.coin.IsSpent();
+            }
+        }
+    }
     return db.Exists(CoinEntry(&outpoint));
 }
 
-uint256 CCoinsViewDB::GetBestBlock() const {
+uint256 CCoinsViewDB::ReadBestBlock() const {
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
     return hashBestChain;
 }
 
+uint256 CCoinsViewDB::GetBestBlock() const {
+    if (m_async_flush) {
+        // While a flush is in flight the view as a whole already represents
+        // the block it is moving to, even though the disk does not yet.
+        LOCK(m_flush_mutex);
+        if (!m_flush_block.IsNull()) return m_flush_block;
+    }
+    return ReadBestBlock();
+}
+
 std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
     std::vector<uint256> vhashHeadBlocks;
     if (!db.Read(DB_HEAD_BLOCKS, vhashHeadBlocks)) {
@@ -117,14 +177,106 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    if (!m_async_flush) {
+        bool ret = WriteCoins(mapCoins, hashBlock);
+        mapCoins.clear();
+        return ret;
+    }
+
+    assert(!hashBlock.IsNull());
+    size_t coins_usage = 0;
+    for (const auto& entry : mapCoins) {
+        coins_usage += entry.second.coin.DynamicMemoryUsage();
+    }
+    {
+        WAIT_LOCK(m_flush_mutex, lock);
+        // Only one flush may be in flight; if the previous one has not been
+        // committed yet, this is where the caller feels the back-pressure.
+        m_flush_cv.wait(lock, [this] { return m_flush_block.IsNull() || m_flush_failed; });
+        if (m_flush_failed) return false;
+        // Take over the caller's map wholesale instead of copying it. Clean
+        // entries come along too and keep serving reads until written.
+        m_flush_coins.swap(mapCoins);
+        m_flush_coins_usage = coins_usage;
+        m_flush_block = hashBlock;
+    }
+    mapCoins.clear();
+    m_flush_cv.notify_all();
+    return true;
+}
+
+bool CCoinsViewDB::SyncFlush() const {
+    if (!m_async_flush) return true;
+    WAIT_LOCK(m_flush_mutex, lock);
+    m_flush_cv.wait(lock, [this] { return m_flush_block.IsNull() || m_flush_failed; });
+    return !m_flush_failed;
+}
+
+size_t CCoinsViewDB::PendingMemoryUsage() const {
+    if (!m_async_flush) return 0;
+    LOCK(m_flush_mutex);
+    // Committed chunks are erased as the write goes, but the coin usage is
+    // only dropped once it completes; this errs on the side of flushing early.
+    return memusage::DynamicUsage(m_flush_coins) + m_flush_coins_usage;
+}
+
+bool CCoinsViewDB::IsFlushing() const {
+    if (!m_async_flush) return false;
+    LOCK(m_flush_mutex);
+    return !m_flush_block.IsNull();
+}
+
+void CCoinsViewDB::ThreadFlush()
+{
+    while (true) {
+        uint256 hashBlock;
+        {
+            WAIT_LOCK(m_flush_mutex, lock);
+            m_flush_cv.wait(lock, [this] { return m_flush_stop || !m_flush_block.IsNull(); });
+            if (m_flush_block.IsNull()) return;
+            hashBlock = m_flush_block;
+        }
+
+        bool ok = false;
+        try {
+            ok = WriteCoins(m_flush_coins, hashBlock);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+        if (!ok) {
+            // The chunks committed so far are on disk and the rest is still in
+            // m_flush_coins, so reads stay correct as long as the in-flight
+            // map is kept. Later flushes are refused and the node shuts down.
+            {
+                LOCK(m_flush_mutex);
+                m_flush_failed = true;
+            }
+            m_flush_cv.notify_all();
+            FatalError("%s: Failed to write the coin database", __func__);
+            return;
+        }
+
+        {
+            LOCK(m_flush_mutex);
+            // Release the bucket array too; it is as large as the flushed cache.
+            CCoinsMap().swap(m_flush_coins);
+            m_flush_coins_usage = 0;
+            m_flush_block.SetNull();
+        }
+        m_flush_cv.notify_all();
+    }
+}
+
+bool CCoinsViewDB::WriteCoins(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
     size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
     int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
+    int fail_simulate = gArgs.GetArg("-dbwritefailratio", 0);
     assert(!hashBlock.IsNull());
 
-    uint256 old_tip = GetBestBlock();
+    uint256 old_tip = ReadBestBlock();
     if (old_tip.IsNull()) {
         // We may be in the middle of replaying.
         std::vector<uint256> old_heads = GetHeadBlocks();
@@ -141,6 +293,10 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, Vector(hashBlock, old_tip));
 
+    // Entries are only removed from the map once the batch holding them has
+    // been committed, so that concurrent readers of an in-flight flush never
+    // miss a coin that is not yet on disk.
+    CCoinsMap::iterator chunk_begin = mapCoins.begin();
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             CoinEntry entry(&it->first);
@@ -151,12 +307,15 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        ++it;
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
             batch.Clear();
+            {
+                LOCK(m_flush_mutex);
+                chunk_begin = mapCoins.erase(chunk_begin, it);
+            }
             if (crash_simulate) {
                 static FastRandomContext rng;
                 if (rng.randrange(crash_simulate) == 0) {
@@ -164,6 +323,12 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
                     _Exit(0);
                 }
             }
+            if (fail_simulate) {
+                static FastRandomContext rng;
+                if (rng.randrange(fail_simulate) == 0) {
+                    throw dbwrapper_error("Simulated write failure");
+                }
+            }
         }
     }
 
@@ -182,7 +347,7 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, false, "blockindex") {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -206,6 +371,8 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 
 CCoinsViewCursor *CCoinsViewDB::Cursor() const
 {
+    // Iterate over a consistent on-disk state.
+    SyncFlush();
     CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(db).NewIterator(), GetBestBlock());
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
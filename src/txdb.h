@@ -12,9 +12,12 @@
 #include <primitives/block.h>
 #include <libdevcore/Common.h>
 #include <libdevcore/FixedHash.h>
+#include <sync.h>
 
+#include <condition_variable>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -43,6 +46,8 @@ static constexpr int MAX_BLOCK_COINSDB_USAGE = 10 * DB_PEAK_USAGE_FACTOR;
 static const int64_t nDefaultDbCache = 450;
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -dbasyncflush default
+static const bool DEFAULT_DB_ASYNC_FLUSH = false;
 //! max. -dbcache (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
@@ -83,7 +88,20 @@ struct CDiskTxPos : public FlatFilePos
     }
 };
 
-/** CCoinsView backed by the coin database (chainstate/) */
+/** CCoinsView backed by the coin database (chainstate/)
+ *
+ * With -dbasyncflush, BatchWrite takes ownership of the flushed map and
+ * returns immediately; a background thread then writes it out in
+ * -dbbatchsize chunks. Until that write completes, lookups are served from
+ * the in-flight map first. The database is marked as being in transition
+ * through DB_HEAD_BLOCKS for the whole write, so a crash part way through
+ * is recovered by ReplayBlocks exactly like an interrupted synchronous flush.
+ * If the background write fails, the in-flight map keeps serving lookups,
+ * later flushes fail and the node is shut down.
+ *
+ * GetCoin and HaveCoin may be called from several threads at once, without
+ * cs_main, as the coins prefetch workers do.
+ */
 class CCoinsViewDB final : public CCoinsView
 {
 protected:
@@ -93,6 +111,7 @@ public:
      * @param[in] ldb_path    Location in the filesystem where leveldb data will be stored.
      */
     explicit CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe);
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
@@ -104,6 +123,35 @@ public:
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
+    size_t PendingMemoryUsage() const override;
+
+    //! Block until any background flush has been committed. Returns false if it failed.
+    bool SyncFlush() const;
+    //! Whether a background flush is currently being written.
+    bool IsFlushing() const;
+
+private:
+    //! Write the dirty entries of mapCoins to disk, removing them from the map once committed.
+    bool WriteCoins(CCoinsMap &mapCoins, const uint256 &hashBlock);
+    //! Best block as recorded on disk, ignoring any in-flight flush.
+    uint256 ReadBestBlock() const;
+    void ThreadFlush();
+
+    const bool m_async_flush;
+    mutable Mutex m_flush_mutex;
+    mutable std::condition_variable m_flush_cv;
+    //! Coins handed over by the last BatchWrite. Only the flush thread modifies
+    //! this map, and it only erases entries under m_flush_mutex after they
+    //! have been committed; readers look it up under m_flush_mutex.
+    CCoinsMap m_flush_coins;
+    //! Memory used by the coins in m_flush_coins when it was handed over.
+    size_t m_flush_coins_usage GUARDED_BY(m_flush_mutex){0};
+    //! Block the in-flight flush is moving the database to, null when idle.
+    uint256 m_flush_block GUARDED_BY(m_flush_mutex);
+    //! A background write failed; m_flush_coins and m_flush_block are kept for reads.
+    bool m_flush_failed GUARDED_BY(m_flush_mutex){false};
+    bool m_flush_stop GUARDED_BY(m_flush_mutex){false};
+    std::thread m_flush_thread;
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
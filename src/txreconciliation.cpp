@@ -0,0 +1,154 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <txreconciliation.h>
+
+#include <crypto/siphash.h>
+#include <hash.h>
+
+#include <algorithm>
+#include <assert.h>
+
+//! Mix an id with a seed (splitmix64 finalizer), giving independent-looking hashes per seed.
+static inline uint64_t MixId(uint32_t id, uint64_t seed)
+{
+    uint64_t z = id + seed * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint32_t CheckHash(uint32_t id)
+{
+    return (uint32_t)MixId(id, ReconSketch::NUM_HASHES + 1);
+}
+
+ReconSketch::ReconSketch(size_t cells, uint64_t salt) : m_cells(cells), m_salt(salt) {}
+
+size_t ReconSketch::CellsForCapacity(size_t capacity)
+{
+    // Two cells per id plus a constant, so that small differences (where two
+    // ids sharing all their cells is most likely) still decode; this keeps
+    // decoding failures around 1% across sizes.
+    return std::min(NUM_HASHES * (capacity * 2 / 3 + 8), MAX_SKETCH_CELLS);
+}
+
+size_t ReconSketch::Index(uint32_t id, size_t hash) const
+{
+    const uint64_t part = m_cells.size() / NUM_HASHES;
+    const uint32_t h = (uint32_t)MixId(id, m_salt + hash + 1);
+    return hash * part + (((uint64_t)h * part) >> 32);
+}
+
+void ReconSketch::Update(uint32_t id, int32_t count)
+{
+    const uint32_t check = CheckHash(id);
+    for (size_t hash = 0; hash < NUM_HASHES; ++hash) {
+        Cell& cell = m_cells[Index(id, hash)];
+        cell.count += count;
+        cell.id_sum ^= id;
+        cell.check_sum ^= check;
+    }
+}
+
+void ReconSketch::Add(uint32_t id)
+{
+    Update(id, 1);
+}
+
+void ReconSketch::Subtract(const ReconSketch& other)
+{
+    assert(other.m_cells.size() == m_cells.size());
+    for (size_t i = 0; i < m_cells.size(); ++i) {
+        m_cells[i].count -= other.m_cells[i].count;
+        m_cells[i].id_sum ^= other.m_cells[i].id_sum;
+        m_cells[i].check_sum ^= other.m_cells[i].check_sum;
+    }
+}
+
+bool ReconSketch::Decode(std::vector<uint32_t>& ours, std::vector<uint32_t>& theirs) const
+{
+    ours.clear();
+    theirs.clear();
+    if (!IsValid()) return false;
+
+    ReconSketch work(*this);
+    auto is_pure = [&work](size_t i) {
+        const Cell& cell = work.m_cells[i];
+        return (cell.count == 1 || cell.count == -1) && CheckHash(cell.id_sum) == cell.check_sum;
+    };
+
+    std::vector<size_t> pure;
+    for (size_t i = 0; i < work.m_cells.size(); ++i) {
+        if (is_pure(i)) pure.push_back(i);
+    }
+    // Every id takes up at least one cell, so an honest difference never has
+    // more ids than cells. A crafted sketch can make an id reappear after it
+    // was peeled, which would otherwise keep this loop going forever.
+    std::set<uint32_t> peeled;
+    while (!pure.empty()) {
+        const size_t i = pure.back();
+        pure.pop_back();
+        // The cell may have changed since it was queued.
+        if (!is_pure(i)) continue;
+        const uint32_t id = work.m_cells[i].id_sum;
+        const int32_t count = work.m_cells[i].count;
+        if (peeled.size() >= work.m_cells.size() || !peeled.insert(id).second) return false;
+        (count == 1 ? ours : theirs).push_back(id);
+        work.Update(id, -count);
+        for (size_t hash = 0; hash < NUM_HASHES; ++hash) {
+            const size_t j = work.Index(id, hash);
+            if (is_pure(j)) pure.push_back(j);
+        }
+    }
+
+    for (const Cell& cell : work.m_cells) {
+        if (cell.count != 0 || cell.id_sum != 0 || cell.check_sum != 0) return false;
+    }
+    return true;
+}
+
+TxReconciliationState::TxReconciliationState(bool initiator, uint64_t local_salt, uint64_t remote_salt) : m_initiator(initiator)
+{
+    // Both sides derive the same keys regardless of who sent which salt.
+    const uint256 key = (CHashWriter(SER_GETHASH, 0) << std::string("Tx Relay Salting") << std::min(local_salt, remote_salt) << std::max(local_salt, remote_salt)).GetHash();
+    m_k0 = key.GetUint64(0);
+    m_k1 = key.GetUint64(1);
+    m_stats.m_enabled = true;
+    m_stats.m_initiator = initiator;
+}
+
+uint32_t TxReconciliationState::GetShortId(const uint256& txid) const
+{
+    return (uint32_t)SipHashUint256(m_k0, m_k1, txid);
+}
+
+size_t TxReconciliationState::EstimateCells(size_t local_size, size_t remote_size)
+{
+    const size_t min_size = std::min(local_size, remote_size);
+    const size_t max_size = std::max(local_size, remote_size);
+    return ReconSketch::CellsForCapacity(max_size - min_size + min_size / RECON_Q_DIVISOR + 1);
+}
+
+ReconSketch TxReconciliationState::MakeSketch(size_t cells) const
+{
+    ReconSketch sketch(cells, m_k0 ^ m_k1);
+    for (const auto& entry : m_snapshot) {
+        sketch.Add(entry.first);
+    }
+    return sketch;
+}
+
+void TxReconciliationState::TakeSnapshot()
+{
+    m_snapshot.clear();
+    for (auto it = m_local_set.begin(); it != m_local_set.end();) {
+        // On a short id collision, leave the transaction for the next round.
+        if (m_snapshot.emplace(GetShortId(*it), *it).second) {
+            it = m_local_set.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,161 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TXRECONCILIATION_H
+#define BITCOIN_TXRECONCILIATION_H
+
+#include <serialize.h>
+#include <uint256.h>
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+/** Default for -txreconciliation */
+static const bool DEFAULT_TXRECONCILIATION = false;
+/** Version of the reconciliation protocol announced in "sendrecon" */
+static const uint32_t TXRECONCILIATION_VERSION = 1;
+/** Interval between reconciliation rounds started by the initiating side */
+static constexpr std::chrono::seconds RECON_REQUEST_INTERVAL{8};
+/** Time the responding side waits for the next round before it floods its set instead */
+static constexpr std::chrono::seconds RECON_RESPONDER_TIMEOUT{4 * RECON_REQUEST_INTERVAL};
+/** Transactions above this many queued for one peer are flooded instead */
+static const size_t MAX_RECON_SET_SIZE = 4000;
+/** Maximum number of cells in a sketch */
+static const size_t MAX_SKETCH_CELLS = 3 * 2048;
+/** Expected fraction (1/RECON_Q_DIVISOR) of the smaller set that the other side does not have */
+static const size_t RECON_Q_DIVISOR = 4;
+
+/**
+ * Invertible Bloom lookup table over 32-bit short transaction ids.
+ *
+ * Two sides each add their own ids to a sketch of the same size; subtracting
+ * one sketch from the other cancels the ids both sides have, and as long as
+ * the difference is small compared to the number of cells it can be decoded
+ * back into the ids only one side has. The size of the sketch only depends on
+ * the expected difference, not on the size of the sets.
+ *
+ * The cells an id maps to depend on a per-connection salt, so that a peer
+ * cannot pick transactions that collide in every sketch. Only sketches with
+ * the same salt can be combined; a sketch received from the peer carries no
+ * salt and is only ever subtracted.
+ */
+class ReconSketch
+{
+public:
+    //! Number of cells each id is added to; the table is split in that many equal parts.
+    static const size_t NUM_HASHES = 3;
+
+    struct Cell {
+        int32_t count{0};
+        uint32_t id_sum{0};
+        uint32_t check_sum{0};
+
+        SERIALIZE_METHODS(Cell, obj) { READWRITE(obj.count, obj.id_sum, obj.check_sum); }
+    };
+
+    ReconSketch() = default;
+    explicit ReconSketch(size_t cells, uint64_t salt = 0);
+
+    //! Number of cells needed to decode a difference of up to `capacity` ids with high probability.
+    static size_t CellsForCapacity(size_t capacity);
+
+    void Add(uint32_t id);
+    //! Subtract another sketch of the same size; the result holds the symmetric difference.
+    void Subtract(const ReconSketch& other);
+    /**
+     * Recover the difference after Subtract().
+     * @param[out] ours     Ids that were only added to this sketch.
+     * @param[out] theirs   Ids that were only added to the subtracted sketch.
+     * @return false if the difference was too large to decode, or the sketch is not one that
+     *         two honest sets could have produced.
+     */
+    bool Decode(std::vector<uint32_t>& ours, std::vector<uint32_t>& theirs) const;
+
+    size_t GetCells() const { return m_cells.size(); }
+    //! Whether the size is one the other side could have produced.
+    bool IsValid() const { return !m_cells.empty() && m_cells.size() % NUM_HASHES == 0 && m_cells.size() <= MAX_SKETCH_CELLS; }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << m_cells;
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        // Reject oversized sketches before allocating anything for them.
+        const uint64_t cells = ReadCompactSize(s);
+        if (cells > MAX_SKETCH_CELLS) {
+            throw std::ios_base::failure("sketch too large");
+        }
+        m_cells.resize(cells);
+        for (Cell& cell : m_cells) {
+            s >> cell;
+        }
+    }
+
+private:
+    void Update(uint32_t id, int32_t count);
+    size_t Index(uint32_t id, size_t hash) const;
+
+    std::vector<Cell> m_cells;
+    uint64_t m_salt{0};
+};
+
+/** Per-peer reconciliation statistics, reported by getpeerinfo */
+struct TxReconciliationStats {
+    bool m_enabled{false};
+    bool m_initiator{false};
+    uint64_t m_rounds{0};
+    uint64_t m_failures{0};
+    //! Transactions we did not have to announce because the peer turned out to have them.
+    uint64_t m_announcements_saved{0};
+};
+
+/**
+ * Reconciliation state for one peer, protected by the peer's cs_tx_inventory.
+ *
+ * Transactions that would otherwise be announced to the peer in an "inv" are
+ * collected in m_local_set. Every RECON_REQUEST_INTERVAL the initiating side
+ * (the side that opened the connection) sends "reqrecon"; the other side
+ * answers with a "sketch" of its set, the initiator decodes the difference,
+ * announces what only it has and asks for what only the peer has with
+ * "reconcildiff". Transactions both sides already have are never announced.
+ * If decoding fails, both sides fall back to flooding their sets.
+ */
+class TxReconciliationState
+{
+public:
+    TxReconciliationState(bool initiator, uint64_t local_salt, uint64_t remote_salt);
+
+    //! Short id of a transaction, salted per connection so ids cannot be ground for collisions.
+    uint32_t GetShortId(const uint256& txid) const;
+
+    //! Number of sketch cells for reconciling sets of the given sizes.
+    static size_t EstimateCells(size_t local_size, size_t remote_size);
+    //! Build a sketch of the current snapshot.
+    ReconSketch MakeSketch(size_t cells) const;
+
+    //! Move m_local_set into a snapshot keyed by short id for the round in progress.
+    void TakeSnapshot();
+
+    const bool m_initiator;
+    std::set<uint256> m_local_set;
+    //! Transactions being reconciled in the current round.
+    std::map<uint32_t, uint256> m_snapshot;
+    //! Initiator: a "reqrecon" is outstanding. Responder: a "sketch" was sent and "reconcildiff" is expected.
+    bool m_in_round{false};
+    //! Initiator: when to send the next "reqrecon". Responder: when to stop waiting for one and flood.
+    std::chrono::microseconds m_next_request{0};
+    TxReconciliationStats m_stats;
+
+private:
+    uint64_t m_k0, m_k1;
+};
+
+#endif // BITCOIN_TXRECONCILIATION_H
@@ -21,6 +21,7 @@ std::string StringForFeeReason(FeeReason reason) {
         {FeeReason::PAYTXFEE, "PayTxFee set"},
         {FeeReason::FALLBACK, "Fallback fee"},
         {FeeReason::REQUIRED, "Minimum Required Fee"},
+        {FeeReason::MIN_GAS_PRICE, "Minimum Gas Price"},
     };
     auto reason_string = fee_reason_strings.find(reason);
 
@@ -15,7 +15,6 @@
 #include <consensus/tx_check.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
-#include <cuckoocache.h>
 #include <flatfile.h>
 #include <hash.h>
 #include <index/txindex.h>
@@ -60,6 +59,7 @@
 #include <yupost/yupostledger.h>
 
 #include <algorithm>
+#include <deque>
 #include <string>
 
 #include <boost/algorithm/string/replace.hpp>
@@ -210,6 +210,7 @@ std::unique_ptr<StorageResults> pstorageresult;
 static void FindFilesToPruneManual(std::set<int>& setFilesToPrune, int nManualPruneHeight);
 static void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight);
 bool CheckInputScripts(const CTransaction& tx, TxValidationState &state, const CCoinsViewCache &inputs, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = nullptr);
+static bool ScriptCheckFailed(const CTransaction& tx, TxValidationState& state, const CCoinsViewCache& inputs, unsigned int flags, bool cacheSigStore, PrecomputedTransactionData& txdata, unsigned int nIn, int nOut, ScriptError error);
 static FILE* OpenUndoFile(const FlatFilePos &pos, bool fReadOnly = false);
 static FlatFileSeq BlockFileSeq();
 static FlatFileSeq UndoFileSeq();
@@ -461,6 +462,20 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, TxValidationS
 
 namespace {
 
+/** Where the scripts of a transaction failed in a PreVerifyTransactionScripts batch */
+struct BatchScriptFailure {
+    unsigned int input;
+    int output;
+    ScriptError error;
+};
+
+} // anon namespace
+
+/** Failures of the last PreVerifyTransactionScripts batch by witness hash, taken by the acceptance that follows */
+static std::map<uint256, BatchScriptFailure> g_batch_script_failures GUARDED_BY(cs_main);
+
+namespace {
+
 class MemPoolAccept
 {
 public:
@@ -494,6 +509,11 @@ public:
     // Single transaction acceptance
     bool AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    // Run the policy checks of a transaction and collect its script checks
+    // instead of executing them, so that they can be run on the script check
+    // threads. Returns false if the transaction failed before script checks.
+    bool CollectScriptChecks(const CTransactionRef& ptx, ATMPArgs& args, PrecomputedTransactionData& txdata, std::vector<CScriptCheck>& checks) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
+
 private:
     // All the intermediate state that gets passed between the various levels
     // of checking a given transaction.
@@ -1051,7 +1071,18 @@ bool MemPoolAccept::PolicyScriptChecks(ATMPArgs& args, Workspace& ws, Precompute
 
     // Check input scripts and signatures.
     // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-    if (!CheckInputScripts(tx, state, m_view, scriptVerifyFlags, true, false, txdata)) {
+    bool scripts_ok;
+    auto failure = g_batch_script_failures.find(tx.GetWitnessHash());
+    if (failure != g_batch_script_failures.end()) {
+        // The scripts already failed in a batch with the same flags; only
+        // work out how, instead of verifying all of them again.
+        ScriptCheckFailed(tx, state, m_view, scriptVerifyFlags, true, txdata, failure->second.input, failure->second.output, failure->second.error);
+        g_batch_script_failures.erase(failure);
+        scripts_ok = false;
+    } else {
+        scripts_ok = CheckInputScripts(tx, state, m_view, scriptVerifyFlags, true, false, txdata);
+    }
+    if (!scripts_ok) {
         // SCRIPT_VERIFY_CLEANSTACK requires SCRIPT_VERIFY_WITNESS, so we
         // need to turn both off, and compare against just turning off CLEANSTACK
         // to see if the failure is specifically due to witness validation.
@@ -1185,6 +1216,17 @@ bool MemPoolAccept::AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs
     return true;
 }
 
+bool MemPoolAccept::CollectScriptChecks(const CTransactionRef& ptx, ATMPArgs& args, PrecomputedTransactionData& txdata, std::vector<CScriptCheck>& checks)
+{
+    Workspace workspace(ptx);
+
+    if (!PreChecks(args, workspace)) return false;
+
+    // Same flags and caching as PolicyScriptChecks. Any failure is reported
+    // by the regular acceptance, which verifies the scripts again.
+    return CheckInputScripts(*ptx, args.m_state, m_view, STANDARD_SCRIPT_VERIFY_FLAGS, true, false, txdata, &checks);
+}
+
 } // anon namespace
 
 /** (try to) add transaction to memory pool with a specified acceptance time **/
@@ -1231,6 +1273,22 @@ bool AcceptToMemoryPool(CTxMemPool& pool, TxValidationState &state, const CTrans
     return AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, GetTime(), plTxnReplaced, bypass_limits, nAbsurdFee, test_accept, rawTx);
 }
 
+size_t AcceptToMemoryPoolBatch(CTxMemPool& pool, const std::vector<CTransactionRef>& txs, std::vector<TxValidationState>& states,
+                               bool bypass_limits, const CAmount nAbsurdFee)
+{
+    PreVerifyTransactionScripts(pool, txs);
+
+    const CChainParams& chainparams = Params();
+    size_t accepted = 0;
+    states.assign(txs.size(), TxValidationState());
+    for (size_t i = 0; i < txs.size(); ++i) {
+        if (AcceptToMemoryPoolWithTime(chainparams, pool, states[i], txs[i], GetTime(), nullptr, bypass_limits, nAbsurdFee, false)) {
+            ++accepted;
+        }
+    }
+    return accepted;
+}
+
 /**
  * Return transaction in txOut, and if it was found inside a block, its hash is placed in hashBlock.
  * If blockIndex is provided, the transaction is fetched from the corresponding block.
@@ -1463,11 +1521,12 @@ CoinsViews::CoinsViews(
     bool in_memory,
     bool should_wipe) : m_dbview(
                             GetDataDir() / ldb_name, cache_size_bytes, in_memory, should_wipe),
-                        m_catcherview(&m_dbview) {}
+                        m_catcherview(&m_dbview),
+                        m_prefetchview(&m_catcherview, &m_dbview, gArgs.GetArg("-prefetchthreads", DEFAULT_PREFETCH_THREADS)) {}
 
 void CoinsViews::InitCache()
 {
-    m_cacheview = MakeUnique<CCoinsViewCache>(&m_catcherview);
+    m_cacheview = MakeUnique<CCoinsViewCache>(&m_prefetchview);
 }
 
 // NOTE: for now m_blockman is set to a global, but this will be changed
@@ -1491,6 +1550,50 @@ void CChainState::InitCoinsCache()
     m_coins_views->InitCache();
 }
 
+//! Outpoints spent by a block that are not created within the block itself.
+static std::vector<COutPoint> GetBlockPrevouts(const CBlock& block)
+{
+    std::set<uint256> block_txids;
+    std::vector<COutPoint> prevouts;
+    for (const auto& tx : block.vtx) {
+        block_txids.insert(tx->GetHash());
+        if (tx->IsCoinBase()) continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (!block_txids.count(txin.prevout.hash)) {
+                prevouts.push_back(txin.prevout);
+            }
+        }
+    }
+    return prevouts;
+}
+
+void CChainState::PrefetchBlockInputs(const CBlock& block)
+{
+    CCoinsViewPrefetch& prefetch = CoinsPrefetch();
+    if (!prefetch.IsEnabled()) return;
+    const CCoinsViewCache& tip = CoinsTip();
+    std::vector<COutPoint> prevouts = GetBlockPrevouts(block);
+    prevouts.erase(std::remove_if(prevouts.begin(), prevouts.end(), [&tip](const COutPoint& prevout) {
+        return tip.HaveCoinInCache(prevout);
+    }), prevouts.end());
+    prefetch.Prefetch(std::move(prevouts));
+}
+
+void CChainState::PrefetchBlockInputs(const CBlockIndex* pindex, const Consensus::Params& consensus_params)
+{
+    CCoinsViewPrefetch& prefetch = CoinsPrefetch();
+    if (!prefetch.IsEnabled() || !(pindex->nStatus & BLOCK_HAVE_DATA)) return;
+    const FlatFilePos pos = pindex->GetBlockPos();
+    prefetch.Enqueue([&prefetch, pos, &consensus_params] {
+        CBlock block;
+        if (ReadBlockFromDisk(block, pos, consensus_params)) {
+            // Coins already held by the cache are read again here; the
+            // staged copies are simply never used and go away on flush.
+            prefetch.Prefetch(GetBlockPrevouts(block));
+        }
+    });
+}
+
 // Note that though this is marked const, we may end up modifying `m_cached_finished_ibd`, which
 // is a performance-related implementation detail. This function must be marked
 // `const` so that `CValidationInterface` clients (which are given a `const CChainState*`)
@@ -1677,19 +1780,31 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight)
 }
 
 bool CScriptCheck::operator()() {
+    bool ret;
     if(checkOutput())
     {
         // Check the sender signature inside the output, used to identify VM sender
         CScript senderPubKey, senderSig;
         if(!ExtractSenderData(ptxTo->vout[nOut].scriptPubKey, &senderPubKey, &senderSig))
-            return false;
-        return VerifyScript(senderSig, senderPubKey, nullptr, nFlags, CachingTransactionSignatureOutputChecker(ptxTo, nOut, ptxTo->vout[nOut].nValue, cacheStore, *txdata), &error);
+            ret = false;
+        else
+            ret = VerifyScript(senderSig, senderPubKey, nullptr, nFlags, CachingTransactionSignatureOutputChecker(ptxTo, nOut, ptxTo->vout[nOut].nValue, cacheStore, *txdata), &error);
+    }
+    else
+    {
+        // Check the input signature
+        const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
+        const CScriptWitness *witness = &ptxTo->vin[nIn].scriptWitness;
+        ret = VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *txdata), &error);
     }
 
-    // Check the input signature
-    const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
-    const CScriptWitness *witness = &ptxTo->vin[nIn].scriptWitness;
-    return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *txdata), &error);
+    // Only the first failing check of a transaction records itself
+    if (!ret && m_failure && !m_failure->m_failed.exchange(true)) {
+        m_failure->m_input = nIn;
+        m_failure->m_output = nOut;
+        m_failure->m_error = error;
+    }
+    return ret;
 }
 
 int GetSpendHeight(const CCoinsViewCache& inputs)
@@ -1700,7 +1815,7 @@ int GetSpendHeight(const CCoinsViewCache& inputs)
 }
 
 
-static CuckooCache::cache<uint256, SignatureCacheHasher> scriptExecutionCache;
+static ShardedCuckooCache scriptExecutionCache;
 static uint256 scriptExecutionCacheNonce(GetRandHash());
 
 void InitScriptExecutionCache() {
@@ -1712,6 +1827,47 @@ void InitScriptExecutionCache() {
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+CuckooCacheStats GetScriptExecutionCacheStats()
+{
+    return scriptExecutionCache.GetStats();
+}
+
+/**
+ * Fill in state for a failed check of input nIn, or of the sender signature of
+ * output nOut if that is not -1, run with the given flags.
+ */
+static bool ScriptCheckFailed(const CTransaction& tx, TxValidationState& state, const CCoinsViewCache& inputs, unsigned int flags, bool cacheSigStore, PrecomputedTransactionData& txdata, unsigned int nIn, int nOut, ScriptError error)
+{
+    if (nOut > -1) {
+        return state.Invalid(TxValidationResult::TX_CONSENSUS, strprintf("sender-output-script-verify-failed (%s)", ScriptErrorString(error)));
+    }
+    if (flags & STANDARD_NOT_MANDATORY_VERIFY_FLAGS) {
+        // Check whether the failure was caused by a
+        // non-mandatory script verification check, such as
+        // non-standard DER encodings or non-null dummy
+        // arguments; if so, ensure we return NOT_STANDARD
+        // instead of CONSENSUS to avoid downstream users
+        // splitting the network between upgraded and
+        // non-upgraded nodes by banning CONSENSUS-failing
+        // data providers.
+        const Coin& coin = inputs.AccessCoin(tx.vin[nIn].prevout);
+        CScriptCheck check2(coin.out, tx, nIn,
+                flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheSigStore, &txdata);
+        if (check2())
+            return state.Invalid(TxValidationResult::TX_NOT_STANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(error)));
+    }
+    // MANDATORY flag failures correspond to
+    // TxValidationResult::TX_CONSENSUS. Because CONSENSUS
+    // failures are the most serious case of validation
+    // failures, we may need to consider using
+    // RECENT_CONSENSUS_CHANGE for any script failure that
+    // could be due to non-upgraded nodes which we may want to
+    // support, to avoid splitting the network (but this
+    // depends on the details of how net_processing handles
+    // such errors).
+    return state.Invalid(TxValidationResult::TX_CONSENSUS, strprintf("mandatory-script-verify-flag-failed (%s)", ScriptErrorString(error)));
+}
+
 /**
  * Check whether all of this transaction's input scripts succeed.
  *
@@ -1749,7 +1905,9 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState &state, const C
     // round - giving us 19 + 32 + 4 = 55 bytes (+ 8 + 1 = 64)
     static_assert(55 - sizeof(flags) - 32 >= 128/8, "Want at least 128 bits of nonce for script execution cache");
     CSHA256().Write(scriptExecutionCacheNonce.begin(), 55 - sizeof(flags) - 32).Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
-    AssertLockHeld(cs_main); //TODO: Remove this requirement by making CuckooCache not require external locks
+    // The script execution cache locks its own shards. cs_main is still
+    // required for inputs, which may read through to the chainstate's coins.
+    AssertLockHeld(cs_main);
     if (scriptExecutionCache.contains(hashCacheEntry, !cacheFullScriptStore)) {
         return true;
     }
@@ -1771,30 +1929,7 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState &state, const C
             pvChecks->push_back(CScriptCheck());
             check.swap(pvChecks->back());
         } else if (!check()) {
-            if (flags & STANDARD_NOT_MANDATORY_VERIFY_FLAGS) {
-                // Check whether the failure was caused by a
-                // non-mandatory script verification check, such as
-                // non-standard DER encodings or non-null dummy
-                // arguments; if so, ensure we return NOT_STANDARD
-                // instead of CONSENSUS to avoid downstream users
-                // splitting the network between upgraded and
-                // non-upgraded nodes by banning CONSENSUS-failing
-                // data providers.
-                CScriptCheck check2(coin.out, tx, i,
-                        flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheSigStore, &txdata);
-                if (check2())
-                    return state.Invalid(TxValidationResult::TX_NOT_STANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(check.GetScriptError())));
-            }
-            // MANDATORY flag failures correspond to
-            // TxValidationResult::TX_CONSENSUS. Because CONSENSUS
-            // failures are the most serious case of validation
-            // failures, we may need to consider using
-            // RECENT_CONSENSUS_CHANGE for any script failure that
-            // could be due to non-upgraded nodes which we may want to
-            // support, to avoid splitting the network (but this
-            // depends on the details of how net_processing handles
-            // such errors).
-            return state.Invalid(TxValidationResult::TX_CONSENSUS, strprintf("mandatory-script-verify-flag-failed (%s)", ScriptErrorString(check.GetScriptError())));
+            return ScriptCheckFailed(tx, state, inputs, flags, cacheSigStore, txdata, i, -1, check.GetScriptError());
         }
     }
 
@@ -1807,7 +1942,7 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState &state, const C
                 pvChecks->push_back(CScriptCheck());
                 check.swap(pvChecks->back());
             } else if (!check()) {
-                return state.Invalid(TxValidationResult::TX_CONSENSUS, strprintf("sender-output-script-verify-failed (%s)", ScriptErrorString(check.GetScriptError())));
+                return ScriptCheckFailed(tx, state, inputs, flags, cacheSigStore, txdata, 0, i, check.GetScriptError());
             }
         }
     }
@@ -2119,6 +2254,61 @@ void ThreadScriptCheck(int worker_num) {
     scriptcheckqueue.Thread();
 }
 
+void PreVerifyTransactionScripts(CTxMemPool& pool, const std::vector<CTransactionRef>& txs)
+{
+    AssertLockHeld(cs_main);
+    g_batch_script_failures.clear();
+    if (!g_parallel_script_checks || txs.size() < 2) return;
+
+    const CChainParams& chainparams = Params();
+    const CAmount nAbsurdFee = 0;
+    std::vector<COutPoint> coins_to_uncache;
+    // CScriptCheck points into these, so they must not move.
+    std::deque<PrecomputedTransactionData> txdata;
+    std::deque<ScriptCheckFailure> failures;
+    std::vector<uint256> wtxids;
+    std::vector<CScriptCheck> checks;
+    {
+        LOCK(pool.cs);
+        for (const CTransactionRef& ptx : txs) {
+            TxValidationState state;
+            MemPoolAccept::ATMPArgs args { chainparams, state, GetTime(), nullptr /* plTxnReplaced */, false /* bypass_limits */, nAbsurdFee, coins_to_uncache, true /* test_accept */, false /* rawTx */ };
+            txdata.emplace_back(*ptx);
+            const size_t first_check = checks.size();
+            if (!MemPoolAccept(pool).CollectScriptChecks(ptx, args, txdata.back(), checks)) {
+                checks.resize(first_check);
+                txdata.pop_back();
+                continue;
+            }
+            failures.emplace_back();
+            wtxids.push_back(ptx->GetWitnessHash());
+            for (size_t i = first_check; i < checks.size(); ++i) {
+                checks[i].SetFailureRecord(&failures.back());
+            }
+        }
+    }
+
+    if (!checks.empty()) {
+        CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+        control.Add(checks);
+        control.Wait();
+    }
+
+    // Checks after the first failing one may not have run, so only the
+    // transactions that actually failed are recorded.
+    for (size_t i = 0; i < wtxids.size(); ++i) {
+        if (failures[i].m_failed) {
+            g_batch_script_failures.emplace(wtxids[i], BatchScriptFailure{failures[i].m_input, failures[i].m_output, failures[i].m_error});
+        }
+    }
+
+    // The acceptance that follows fetches these coins again, and then tracks
+    // them to be uncached if the transaction is rejected.
+    for (const COutPoint& outpoint : coins_to_uncache) {
+        ::ChainstateActive().CoinsTip().Uncache(outpoint);
+    }
+}
+
 VersionBitsCache versionbitscache GUARDED_BY(cs_main);
 
 int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Params& params)
@@ -2659,6 +2849,69 @@ void LastHashes::clear()
     m_lastHashes.clear();
 }
 
+//! Number of contract accounts loaded per warm-up job.
+static const size_t WARMUP_CHUNK_SIZE = 8;
+
+/**
+ * Load the accounts, code and recently used storage slots of the contracts a
+ * block is going to execute on the read-ahead threads, so that execution
+ * finds the state trie nodes in the database cache instead of on disk.
+ * Speculative: anything that fails to parse or load here is simply skipped.
+ * The contract transactions extracted along the way are returned in
+ * extracted by block position, for ConnectBlock to execute.
+ */
+static void WarmupContractState(const CBlock& block, CCoinsViewCache& view, unsigned int contractflags, std::map<size_t, ExtractYuPostTX>& extracted) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    CCoinsViewPrefetch& prefetch = ::ChainstateActive().CoinsPrefetch();
+    if (!prefetch.IsEnabled()) return;
+
+    std::map<dev::Address, std::vector<dev::u256>> targets;
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        if (!tx.HasCreateOrCall() || tx.HasOpSpend()) continue;
+        // The senders are looked up in the block first and then in view,
+        // which still holds every coin the block spends, so this matches
+        // what ConnectBlock would extract once it reaches the transaction.
+        YuPostTxConverter convert(tx, &view, &block.vtx, contractflags);
+        ExtractYuPostTX resultConvertYuPostTX;
+        if (!convert.extractionYuPostTransactions(resultConvertYuPostTX)) continue;
+        for (const YuPostTransaction& qtx : resultConvertYuPostTX.first) {
+            targets.emplace(qtx.sender(), std::vector<dev::u256>());
+            if (!qtx.isCreation()) {
+                targets[qtx.receiveAddress()] = globalState->recentStorageKeys(qtx.receiveAddress());
+            }
+        }
+        extracted.emplace(i, std::move(resultConvertYuPostTX));
+    }
+
+    // Snapshot the database overlay once, on the validation thread. All jobs
+    // share the snapshot, and through it the underlying database, which is
+    // safe to read from.
+    const std::shared_ptr<const dev::OverlayDB> db = std::make_shared<const dev::OverlayDB>(globalState->db());
+    const dev::h256 root = globalState->rootHash();
+    std::vector<std::pair<dev::Address, std::vector<dev::u256>>> chunk;
+    for (auto it = targets.begin(); it != targets.end(); ++it) {
+        chunk.emplace_back(it->first, std::move(it->second));
+        if (chunk.size() < WARMUP_CHUNK_SIZE && std::next(it) != targets.end()) continue;
+        prefetch.Enqueue([db, root, chunk] {
+            try {
+                dev::eth::State warm(dev::u256(0), *db, dev::eth::BaseState::PreExisting);
+                warm.setRoot(root);
+                for (const auto& target : chunk) {
+                    if (!warm.addressInUse(target.first)) continue;
+                    warm.code(target.first);
+                    for (const dev::u256& key : target.second) {
+                        warm.storage(target.first, key);
+                    }
+                }
+            } catch (const std::exception&) {
+                // Execution will run into and report any real problem with the state.
+            }
+        });
+        chunk.clear();
+    }
+}
+
 bool ByteCodeExec::performByteCode(dev::eth::Permanence type){
     for(YuPostTransaction& tx : txs){
         //validate VM version
@@ -3162,6 +3415,10 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     uint64_t nValueOut=0;
     uint64_t nValueIn=0;
 
+    // Start loading the contract state this block touches while its inputs are checked.
+    std::map<size_t, ExtractYuPostTX> extractedContractTxs;
+    WarmupContractState(block, view, contractflags, extractedContractTxs);
+
     if(block.IsProofOfStake())
     {
         Coin coin;
@@ -3295,11 +3552,15 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
                 return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-txns-invalid-sender-script");
             }
 
-            YuPostTxConverter convert(tx, &view, &block.vtx, contractflags);
-
             ExtractYuPostTX resultConvertYuPostTX;
-            if(!convert.extractionYuPostTransactions(resultConvertYuPostTX)){
-                return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-tx-bad-contract-format", "ConnectBlock(): Contract transaction of the wrong format");
+            auto extracted = extractedContractTxs.find(i);
+            if(extracted != extractedContractTxs.end()){
+                resultConvertYuPostTX = std::move(extracted->second);
+            }else{
+                YuPostTxConverter convert(tx, &view, &block.vtx, contractflags);
+                if(!convert.extractionYuPostTransactions(resultConvertYuPostTX)){
+                    return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-tx-bad-contract-format", "ConnectBlock(): Contract transaction of the wrong format");
+                }
             }
             if(!CheckMinGasPrice(resultConvertYuPostTX.second, minGasPrice))
                 return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-tx-low-gas-price", "ConnectBlock(): Contract execution has lower gas price than allowed");
@@ -3644,6 +3905,9 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
+    // Feed contract gas usage into gas price estimation
+    ::feeEstimator.processBlockGas(pindex->nHeight, blockGasUsed, blockGasLimit);
+
     int64_t nTime5 = GetTimeMicros(); nTimeIndex += nTime5 - nTime4;
     LogPrint(BCLog::BENCH, "    - Index writing: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5 - nTime4), nTimeIndex * MICRO, nTimeIndex * MILLI / nBlocksTotal);
 
@@ -3782,6 +4046,11 @@ bool CChainState::FlushStateToDisk(
             }
             // Finally remove any pruned files
             if (fFlushForPrune) {
+                // A background coins write still in progress may need those
+                // blocks to be replayed after a crash; let it commit first.
+                if (!CoinsDB().SyncFlush()) {
+                    return AbortNode(state, "Failed to write to coin database");
+                }
                 LOG_TIME_MILLIS("unlink pruned files", BCLog::BENCH);
 
                 UnlinkPrunedFiles(setFilesToPrune);
@@ -3804,6 +4073,10 @@ bool CChainState::FlushStateToDisk(
             // Flush the chainstate (which may refer to block index entries).
             if (!CoinsTip().Flush())
                 return AbortNode(state, "Failed to write to coin database");
+            // With -dbasyncflush the write above may still be in progress;
+            // explicit and shutdown flushes must leave it committed.
+            if (mode == FlushStateMode::ALWAYS && !CoinsDB().SyncFlush())
+                return AbortNode(state, "Failed to write to coin database");
             nLastFlush = nNow;
             full_flush_completed = true;
         }
@@ -4195,7 +4468,12 @@ bool CChainState::ActivateBestChainStep(BlockValidationState& state, const CChai
         nHeight = nTargetHeight;
 
         // Connect new blocks.
-        for (CBlockIndex *pindexConnect : reverse_iterate(vpindexToConnect)) {
+        for (auto it = vpindexToConnect.rbegin(); it != vpindexToConnect.rend(); ++it) {
+            CBlockIndex *pindexConnect = *it;
+            // Read the inputs of the following block while this one connects.
+            if (std::next(it) != vpindexToConnect.rend()) {
+                PrefetchBlockInputs(*std::next(it), chainparams.GetConsensus());
+            }
             if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
@@ -5815,6 +6093,10 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
             // Store to disk
             ret = ::ChainstateActive().AcceptBlock(pblock, state, chainparams, &pindex, fForceProcessing, nullptr, fNewBlock);
         }
+        if (ret && pindex && pindex->pprev == ::ChainActive().Tip()) {
+            // This block is likely to be connected next; start reading its inputs.
+            ::ChainstateActive().PrefetchBlockInputs(*pblock);
+        }
         if (!ret) {
             GetMainSignals().BlockChecked(*pblock, state);
             return error("%s: AcceptBlock FAILED (%s)", __func__, state.ToString());
@@ -5830,6 +6112,21 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
     return true;
 }
 
+bool TestBlockHeaderValidity(BlockValidationState& state, const CChainParams& chainparams, const CBlockHeader& header, const CBlockIndex* pindexPrev)
+{
+    AssertLockHeld(cs_main);
+    assert(pindexPrev);
+    // The same checks AcceptBlockHeader makes on a new header, minus the ones
+    // that depend on or change the block index.
+    if (!CheckCanonicalBlockSignature(&header))
+        return state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, "bad-signature-encoding", "bad block signature encoding");
+    if (!CheckBlockHeader(header, state, chainparams.GetConsensus()))
+        return false;
+    if (pindexPrev->nStatus & BLOCK_FAILED_MASK)
+        return state.Invalid(BlockValidationResult::BLOCK_INVALID_PREV, "bad-prevblk");
+    return ContextualCheckBlockHeader(header, state, chainparams, pindexPrev, GetAdjustedTime());
+}
+
 bool TestBlockValidity(BlockValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev, bool fCheckPOW, bool fCheckMerkleRoot)
 {
     AssertLockHeld(cs_main);
@@ -7076,6 +7373,8 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
 }
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+//! Number of transactions LoadMempool reads before accepting them as a batch
+static const size_t MEMPOOL_LOAD_BATCH_SIZE = 1000;
 
 bool LoadMempool(CTxMemPool& pool)
 {
@@ -7094,6 +7393,58 @@ bool LoadMempool(CTxMemPool& pool)
     int64_t already_there = 0;
     int64_t nNow = GetTime();
 
+    // Transactions are accepted in batches. mempool.dat lists parents before
+    // their children, so a batch is split into generations: the transactions
+    // of a generation only depend on earlier ones, and have their scripts
+    // verified together on the script check threads. cs_main is released
+    // between generations, so that peers and RPC are served during the load.
+    std::vector<std::pair<CTransactionRef, int64_t>> batch;
+    const auto accept_batch = [&]() {
+        std::map<uint256, size_t> generation_of;
+        std::vector<std::vector<CTransactionRef>> generations;
+        std::map<uint256, int64_t> accept_time;
+        for (const auto& entry : batch) {
+            const CTransactionRef& tx = entry.first;
+            size_t generation = 0;
+            for (const CTxIn& txin : tx->vin) {
+                auto it = generation_of.find(txin.prevout.hash);
+                if (it != generation_of.end()) generation = std::max(generation, it->second + 1);
+            }
+            generation_of.emplace(tx->GetHash(), generation);
+            accept_time.emplace(tx->GetHash(), entry.second);
+            if (generations.size() <= generation) generations.resize(generation + 1);
+            generations[generation].push_back(tx);
+        }
+        batch.clear();
+
+        for (const std::vector<CTransactionRef>& txs : generations) {
+            LOCK(cs_main);
+            PreVerifyTransactionScripts(pool, txs);
+            for (const CTransactionRef& tx : txs) {
+                TxValidationState state;
+                AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, accept_time.at(tx->GetHash()),
+                                           nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */,
+                                           false /* test_accept */);
+                if (state.IsValid()) {
+                    ++count;
+                } else {
+                    // mempool may contain the transaction already, e.g. from
+                    // wallet(s) having loaded it while we were processing
+                    // mempool transactions; consider these as valid, instead of
+                    // failed, but mark them as 'already there'
+                    if (pool.exists(tx->GetHash())) {
+                        ++already_there;
+                    } else {
+                        ++failed;
+                    }
+                }
+                if (ShutdownRequested())
+                    return false;
+            }
+        }
+        return true;
+    };
+
     try {
         uint64_t version;
         file >> version;
@@ -7114,31 +7465,19 @@ bool LoadMempool(CTxMemPool& pool)
             if (amountdelta) {
                 pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
             }
-            TxValidationState state;
             if (nTime + nExpiryTimeout > nNow) {
-                LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, nTime,
-                                           nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */,
-                                           false /* test_accept */);
-                if (state.IsValid()) {
-                    ++count;
-                } else {
-                    // mempool may contain the transaction already, e.g. from
-                    // wallet(s) having loaded it while we were processing
-                    // mempool transactions; consider these as valid, instead of
-                    // failed, but mark them as 'already there'
-                    if (pool.exists(tx->GetHash())) {
-                        ++already_there;
-                    } else {
-                        ++failed;
-                    }
-                }
+                batch.emplace_back(std::move(tx), nTime);
+                if (batch.size() >= MEMPOOL_LOAD_BATCH_SIZE && !accept_batch())
+                    return false;
             } else {
                 ++expired;
             }
             if (ShutdownRequested())
                 return false;
         }
+        if (!accept_batch())
+            return false;
+
         std::map<uint256, CAmount> mapDeltas;
         file >> mapDeltas;
 
@@ -12,6 +12,7 @@
 
 #include <amount.h>
 #include <coins.h>
+#include <coinsprefetch.h>
 #include <crypto/common.h> // for ReadLE64
 #include <fs.h>
 #include <policy/feerate.h>
@@ -69,6 +70,7 @@ class CBlockPolicyEstimator;
 class CTxMemPool;
 class TxValidationState;
 struct CDiskTxPos;
+struct CuckooCacheStats;
 class CWallet;
 struct ChainTxData;
 
@@ -334,6 +336,24 @@ bool AcceptToMemoryPool(CTxMemPool& pool, TxValidationState &state, const CTrans
                         std::list<CTransactionRef>* plTxnReplaced,
                         bool bypass_limits, const CAmount nAbsurdFee, bool test_accept=false, bool rawTx = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/**
+ * Verify the scripts of a batch of transactions in parallel on the script
+ * check threads, without adding them to the memory pool. Transactions that
+ * fail the cheaper policy checks are skipped. Successful signature checks are
+ * cached, so that accepting the transactions afterwards, which still happens
+ * one at a time, mostly skips the expensive part. Failing checks are recorded
+ * until the next batch, and accepting a transaction that failed only works
+ * out how it failed instead of verifying all its scripts again.
+ */
+void PreVerifyTransactionScripts(CTxMemPool& pool, const std::vector<CTransactionRef>& txs) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+/** (try to) add a batch of transactions to memory pool, in order
+ * Scripts are verified in parallel first, then each transaction is accepted
+ * as by AcceptToMemoryPool. states receives the outcome for each transaction.
+ * Returns the number of transactions added. **/
+size_t AcceptToMemoryPoolBatch(CTxMemPool& pool, const std::vector<CTransactionRef>& txs, std::vector<TxValidationState>& states,
+                               bool bypass_limits, const CAmount nAbsurdFee) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 /** Get the BIP9 state for a given deployment at the current tip. */
 ThresholdState VersionBitsTipState(const Consensus::Params& params, Consensus::DeploymentPos pos);
 
@@ -380,6 +400,15 @@ bool CheckSequenceLocks(const CTxMemPool& pool, const CTransaction& tx, int flag
  * Closure representing one script verification
  * Note that this stores references to the spending transaction
  */
+/** Records the first failing check of a transaction whose checks run in a batch */
+struct ScriptCheckFailure
+{
+    std::atomic<bool> m_failed{false};
+    unsigned int m_input{0};
+    int m_output{-1};
+    ScriptError m_error{SCRIPT_ERR_UNKNOWN_ERROR};
+};
+
 class CScriptCheck
 {
 private:
@@ -391,6 +420,7 @@ private:
     ScriptError error;
     PrecomputedTransactionData *txdata;
     int nOut;
+    ScriptCheckFailure* m_failure{nullptr};
 
 public:
     CScriptCheck(): ptxTo(nullptr), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR), nOut(-1) {}
@@ -410,15 +440,21 @@ public:
         std::swap(error, check.error);
         std::swap(txdata, check.txdata);
         std::swap(nOut, check.nOut);
+        std::swap(m_failure, check.m_failure);
     }
 
     ScriptError GetScriptError() const { return error; }
 
+    //! Record a failure of this check in failure, shared by the checks of one transaction.
+    void SetFailureRecord(ScriptCheckFailure* failure) { m_failure = failure; }
+
     bool checkOutput() const { return nOut > -1; }
 };
 
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
+/** Get hit statistics of the script execution cache */
+CuckooCacheStats GetScriptExecutionCacheStats();
 
 ///////////////////////////////////////////////////////////////// // yupost
 bool GetAddressIndex(uint256 addressHash, int type,
@@ -458,6 +494,9 @@ bool GetBlockDelegation(const CBlock& block, const uint160& staker, uint160& add
 bool SignBlock(std::shared_ptr<CBlock> pblock, CWallet& wallet, const CAmount& nTotalFees, uint32_t nTime, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoins, std::vector<COutPoint>& setSelectedCoins, std::vector<COutPoint>& setDelegateCoins, bool selectedOnly = false, bool tryOnly = false);
 bool CheckCanonicalBlockSignature(const CBlockHeader* pblock);
 
+/** Check a block header against its parent without storing it, e.g. while the block itself is still being received */
+bool TestBlockHeaderValidity(BlockValidationState& state, const CChainParams& chainparams, const CBlockHeader& header, const CBlockIndex* pindexPrev) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 /** Check a block is completely valid from start to finish (only works on top of our current best block) */
 bool TestBlockValidity(BlockValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev, bool fCheckPOW = true, bool fCheckMerkleRoot = true) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -722,6 +761,11 @@ public:
     //! This view wraps access to the leveldb instance and handles read errors gracefully.
     CCoinsViewErrorCatcher m_catcherview GUARDED_BY(cs_main);
 
+    //! This view stages coins read ahead of block connection by background threads. The
+    //! threads read m_dbview directly, which is safe without cs_main; read errors are
+    //! left to m_catcherview on the validation thread.
+    CCoinsViewPrefetch m_prefetchview;
+
     //! This is the top layer of the cache hierarchy - it keeps as many coins in memory as
     //! can fit per the dbcache setting.
     std::unique_ptr<CCoinsViewCache> m_cacheview GUARDED_BY(cs_main);
@@ -860,6 +904,18 @@ public:
         return m_coins_views->m_catcherview;
     }
 
+    //! @returns A reference to the view staging coins read ahead of block connection.
+    CCoinsViewPrefetch& CoinsPrefetch() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+    {
+        return m_coins_views->m_prefetchview;
+    }
+
+    //! Read the inputs of a block that is about to be connected in the background.
+    void PrefetchBlockInputs(const CBlock& block) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    //! Load a block from disk and read its inputs in the background.
+    void PrefetchBlockInputs(const CBlockIndex* pindex, const Consensus::Params& consensus_params) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
     //! Destructs all objects related to accessing the UTXO set.
     void ResetCoinsViews() { m_coins_views.reset(); }
 
@@ -7,6 +7,7 @@
 #include <optional.h>
 #include <util/system.h>
 #include <util/moneystr.h>
+#include <util/time.h>
 
 // Descending order comparator
 struct {
@@ -57,11 +58,16 @@ struct {
  *        that were selected.
  * @param CAmount not_input_fees -> The fees that need to be paid for the outputs and fixed size
  *        overhead (version, locktime, marker and flag)
+ * @param std::chrono::microseconds max_duration -> The search ends with the best solution found so
+ *        far once it has taken this long
  */
 
 static const size_t TOTAL_TRIES = 100000;
+//! Number of tries between looks at the clock
+static const size_t TRIES_PER_CLOCK_CHECK = 1000;
 
-bool SelectCoinsBnB(std::vector<OutputGroup>& utxo_pool, const CAmount& target_value, const CAmount& cost_of_change, std::set<CInputCoin>& out_set, CAmount& value_ret, CAmount not_input_fees)
+bool SelectCoinsBnB(std::vector<OutputGroup>& utxo_pool, const CAmount& target_value, const CAmount& cost_of_change, std::set<CInputCoin>& out_set, CAmount& value_ret, CAmount not_input_fees,
+                    std::chrono::microseconds max_duration)
 {
     out_set.clear();
     CAmount curr_value = 0;
@@ -81,15 +87,21 @@ bool SelectCoinsBnB(std::vector<OutputGroup>& utxo_pool, const CAmount& target_v
         return false;
     }
 
-    // Sort the utxo_pool
-    std::sort(utxo_pool.begin(), utxo_pool.end(), descending);
+    // Sort the utxo_pool, callers trying several times may have done so already
+    if (!std::is_sorted(utxo_pool.begin(), utxo_pool.end(), descending)) {
+        std::sort(utxo_pool.begin(), utxo_pool.end(), descending);
+    }
 
     CAmount curr_waste = 0;
     std::vector<bool> best_selection;
     CAmount best_waste = MAX_MONEY;
+    const int64_t start_time = GetTimeMicros();
 
     // Depth First search loop for choosing the UTXOs
     for (size_t i = 0; i < TOTAL_TRIES; ++i) {
+        if (i > 0 && i % TRIES_PER_CLOCK_CHECK == 0 && GetTimeMicros() - start_time > max_duration.count()) {
+            break;
+        }
         // Conditions for starting a backtrack
         bool backtrack = false;
         if (curr_value + curr_available_value < actual_target ||                // Cannot possibly reach target with the amount remaining in the curr_available_value.
@@ -290,6 +302,43 @@ bool KnapsackSolver(const CAmount& nTargetValue, std::vector<OutputGroup>& group
     return true;
 }
 
+bool SelectCoinsSRD(const CAmount& nTargetValue, std::vector<OutputGroup>& groups, std::set<CInputCoin>& setCoinsRet, CAmount& nValueRet)
+{
+    setCoinsRet.clear();
+    nValueRet = 0;
+
+    // Draw groups without replacement until they pay for the target and
+    // leave change that is not dust. Only the drawn groups are looked at,
+    // so this stays fast however many small outputs the wallet has.
+    FastRandomContext insecure_rand;
+    for (size_t i = 0; i < groups.size(); ++i) {
+        std::swap(groups[i], groups[i + insecure_rand.randrange(groups.size() - i)]);
+        if (setCoinsRet.size() + groups[i].m_outputs.size() > MAX_SRD_INPUTS) {
+            // The draw ran into the wallet's small outputs and would build a
+            // transaction too large to relay. Let the knapsack solver find
+            // a selection among the largest groups instead.
+            const size_t largest = std::min(groups.size(), MAX_SRD_INPUTS);
+            std::partial_sort(groups.begin(), groups.begin() + largest, groups.end(),
+                              [](const OutputGroup& a, const OutputGroup& b) { return a.m_value > b.m_value; });
+            std::vector<OutputGroup> largest_groups(groups.begin(), groups.begin() + largest);
+            return KnapsackSolver(nTargetValue, largest_groups, setCoinsRet, nValueRet);
+        }
+        util::insert(setCoinsRet, groups[i].m_outputs);
+        nValueRet += groups[i].m_value;
+        if (nValueRet == nTargetValue || nValueRet >= nTargetValue + MIN_CHANGE) {
+            return true;
+        }
+    }
+
+    // Everything together pays for the target, if with small change
+    if (nValueRet >= nTargetValue) {
+        return true;
+    }
+    setCoinsRet.clear();
+    nValueRet = 0;
+    return false;
+}
+
 /******************************************************************************
 
  OutputGroup
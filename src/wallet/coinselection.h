@@ -9,10 +9,16 @@
 #include <primitives/transaction.h>
 #include <random.h>
 
+#include <chrono>
+
 //! target minimum change amount
 static constexpr CAmount MIN_CHANGE{COIN / 100};
 //! final minimum change amount after paying for fees
 static const CAmount MIN_FINAL_CHANGE = MIN_CHANGE/2;
+//! Pools with more output groups than this are drawn from at random instead of given to the knapsack solver
+static constexpr size_t MAX_KNAPSACK_GROUPS{10000};
+//! Most inputs a single random draw selects, about as many as fit in a standard transaction
+static constexpr size_t MAX_SRD_INPUTS{600};
 
 class CInputCoin {
 public:
@@ -93,9 +99,15 @@ struct OutputGroup
     bool EligibleForSpending(const CoinEligibilityFilter& eligibility_filter) const;
 };
 
-bool SelectCoinsBnB(std::vector<OutputGroup>& utxo_pool, const CAmount& target_value, const CAmount& cost_of_change, std::set<CInputCoin>& out_set, CAmount& value_ret, CAmount not_input_fees);
+bool SelectCoinsBnB(std::vector<OutputGroup>& utxo_pool, const CAmount& target_value, const CAmount& cost_of_change, std::set<CInputCoin>& out_set, CAmount& value_ret, CAmount not_input_fees,
+                    std::chrono::microseconds max_duration = std::chrono::microseconds::max());
 
 // Original coin selection algorithm as a fallback
 bool KnapsackSolver(const CAmount& nTargetValue, std::vector<OutputGroup>& groups, std::set<CInputCoin>& setCoinsRet, CAmount& nValueRet);
 
+// Single random draw, the fallback for pools too large for the knapsack solver.
+// Draws needing more than MAX_SRD_INPUTS inputs are left to the knapsack solver
+// over the largest groups instead.
+bool SelectCoinsSRD(const CAmount& nTargetValue, std::vector<OutputGroup>& groups, std::set<CInputCoin>& setCoinsRet, CAmount& nValueRet);
+
 #endif // BITCOIN_WALLET_COINSELECTION_H
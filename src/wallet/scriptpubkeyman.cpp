@@ -214,6 +214,58 @@ isminetype LegacyScriptPubKeyMan::IsMine(const CScript& script) const
     assert(false);
 }
 
+std::set<CScript> LegacyScriptPubKeyMan::GetScriptPubKeys() const
+{
+    LOCK(cs_KeyStore);
+    std::set<CScript> spks;
+
+    // All keys are recognized as P2PK and P2PKH
+    for (const auto& key_pair : mapKeys) {
+        const CPubKey& pub = key_pair.second.GetPubKey();
+        spks.insert(GetScriptForRawPubKey(pub));
+        spks.insert(GetScriptForDestination(PKHash(pub)));
+    }
+    for (const auto& key_pair : mapCryptedKeys) {
+        const CPubKey& pub = key_pair.second.first;
+        spks.insert(GetScriptForRawPubKey(pub));
+        spks.insert(GetScriptForDestination(PKHash(pub)));
+    }
+
+    // Segwit scripts of keys are in mapScripts, and are recognized as
+    // themselves and nested in P2SH
+    for (const auto& script_pair : mapScripts) {
+        const CScript& script = script_pair.second;
+        if (IsMine(script) == ISMINE_SPENDABLE) {
+            if (!script.IsPayToScriptHash()) {
+                spks.insert(GetScriptForDestination(ScriptHash(script)));
+            }
+            int witness_version = -1;
+            std::vector<unsigned char> witness_program;
+            if (script.IsWitnessProgram(witness_version, witness_program) && witness_version == 0) {
+                spks.insert(script);
+            }
+        } else {
+            // Multisig scripts are only recognized in P2SH
+            std::vector<std::vector<unsigned char>> solutions;
+            if (Solver(script, solutions) == TX_MULTISIG) {
+                CScript ms_spk = GetScriptForDestination(ScriptHash(script));
+                if (IsMine(ms_spk) != ISMINE_NO) {
+                    spks.insert(ms_spk);
+                }
+            }
+        }
+    }
+
+    // Watch-only scripts are recognized as they are
+    for (const CScript& script : setWatchOnly) {
+        if (IsMine(script) != ISMINE_NO) {
+            spks.insert(script);
+        }
+    }
+
+    return spks;
+}
+
 bool LegacyScriptPubKeyMan::CheckDecryptionKey(const CKeyingMaterial& master_key, bool accept_no_keys)
 {
     {
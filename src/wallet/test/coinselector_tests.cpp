@@ -657,4 +657,56 @@ BOOST_AUTO_TEST_CASE(SelectCoins_test)
     }
 }
 
+// Single random draw coin selection tests
+BOOST_AUTO_TEST_CASE(srd_test)
+{
+    std::vector<CInputCoin> utxo_pool;
+    CoinSet selection;
+    CAmount value_ret = 0;
+
+    for (int i = 0; i < 10; ++i) {
+        add_coin(1 * COIN, i, utxo_pool);
+    }
+
+    // Exact match
+    BOOST_CHECK(SelectCoinsSRD(5 * COIN, GroupCoins(utxo_pool), selection, value_ret));
+    BOOST_CHECK_EQUAL(value_ret, 5 * COIN);
+    BOOST_CHECK_EQUAL(selection.size(), 5U);
+
+    // Draws on until the change is at least MIN_CHANGE
+    BOOST_CHECK(SelectCoinsSRD(5 * COIN + COIN / 2, GroupCoins(utxo_pool), selection, value_ret));
+    BOOST_CHECK_EQUAL(value_ret, 6 * COIN);
+    BOOST_CHECK_EQUAL(selection.size(), 6U);
+    BOOST_CHECK(SelectCoinsSRD(6 * COIN - MIN_CHANGE, GroupCoins(utxo_pool), selection, value_ret));
+    BOOST_CHECK_EQUAL(value_ret, 6 * COIN);
+    BOOST_CHECK(SelectCoinsSRD(6 * COIN - MIN_CHANGE + 1, GroupCoins(utxo_pool), selection, value_ret));
+    BOOST_CHECK_EQUAL(value_ret, 7 * COIN);
+
+    // Smaller change if that is all there is
+    BOOST_CHECK(SelectCoinsSRD(10 * COIN - 1, GroupCoins(utxo_pool), selection, value_ret));
+    BOOST_CHECK_EQUAL(value_ret, 10 * COIN);
+    BOOST_CHECK_EQUAL(selection.size(), 10U);
+
+    // Not enough
+    BOOST_CHECK(!SelectCoinsSRD(10 * COIN + 1, GroupCoins(utxo_pool), selection, value_ret));
+    BOOST_CHECK(selection.empty());
+    BOOST_CHECK_EQUAL(value_ret, 0);
+
+    // Draws needing too many small outputs are left to the knapsack solver
+    // over the largest groups
+    utxo_pool.clear();
+    for (int i = 0; i < 2000; ++i) {
+        add_coin(CENT + i, 0, utxo_pool);
+    }
+    add_coin(10 * COIN, 0, utxo_pool);
+    BOOST_CHECK(SelectCoinsSRD(8 * COIN, GroupCoins(utxo_pool), selection, value_ret));
+    BOOST_CHECK(selection.size() <= MAX_SRD_INPUTS);
+    BOOST_CHECK(value_ret >= 8 * COIN);
+
+    // Even if all outputs together would be enough
+    BOOST_CHECK(!SelectCoinsSRD(25 * COIN, GroupCoins(utxo_pool), selection, value_ret));
+    BOOST_CHECK(selection.empty());
+    BOOST_CHECK_EQUAL(value_ret, 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -22,6 +22,10 @@
 
 #include <util/time.h>
 #include <random.h>
+#include <key_io.h>
+#include <util/convert.h>
+#include <yupost/storageresults.h>
+#include <libdevcore/SHA3.h>
 
 extern UniValue importmulti(const JSONRPCRequest& request);
 extern UniValue dumpwallet(const JSONRPCRequest& request);
@@ -578,6 +582,160 @@ BOOST_FIXTURE_TEST_CASE(ListCoins, ListCoinsTestingSetup)
     BOOST_CHECK_EQUAL(list.begin()->second.size(), 2U);
 }
 
+BOOST_FIXTURE_TEST_CASE(cached_balance, ListCoinsTestingSetup)
+{
+    // Compare the cached balance with a full recomputation on every call.
+    gArgs.ForceSetArg("-checkwalletbalance", "1");
+
+    // The mature coinbase transaction is settled by the first call and taken
+    // from the running total by the second.
+    CWallet::Balance balance = wallet->GetBalance();
+    BOOST_CHECK_EQUAL(balance.m_mine_trusted, 20000 * COIN);
+    BOOST_CHECK_EQUAL(wallet->GetBalance().m_mine_trusted, 20000 * COIN);
+
+    // Spending it marks it dirty, which takes it out of the running total.
+    // The new block also settles the coinbase transaction at height 2.
+    AddTx(CRecipient{GetScriptForRawPubKey({}), 1 * COIN, false /* subtract fee */});
+    const CAmount available = wallet->GetAvailableBalance();
+    BOOST_CHECK(available > 20000 * COIN && available < 39999 * COIN);
+    balance = wallet->GetBalance();
+    BOOST_CHECK_EQUAL(balance.m_mine_trusted, available);
+    const CAmount immature = balance.m_mine_immature;
+
+    // Disconnecting the tip makes the coinbase transaction at height 2
+    // immature again, in place of the one of the disconnected block.
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, ::ChainActive().Tip(), Params().GetConsensus()));
+    wallet->blockDisconnected(block, ::ChainActive().Height());
+    balance = wallet->GetBalance();
+    BOOST_CHECK_EQUAL(balance.m_mine_immature, immature);
+    BOOST_CHECK(balance.m_mine_trusted <= available - 20000 * COIN);
+
+    gArgs.ForceSetArg("-checkwalletbalance", "0");
+}
+
+//! Check that AvailableCoins, which only looks at the wallet's unspent
+//! outputs, finds the same coins as a walk over all of mapWallet.
+static std::set<COutPoint> CheckUnspentOutputs(CWallet& wallet, interfaces::Chain& chain)
+{
+    auto locked_chain = chain.lock();
+    LOCK(wallet.cs_wallet);
+    std::vector<COutput> available;
+    wallet.AvailableCoins(*locked_chain, available);
+    std::set<COutPoint> found;
+    for (const COutput& out : available) {
+        found.emplace(out.tx->GetHash(), out.i);
+    }
+
+    std::set<COutPoint> expected;
+    std::set<uint256> trusted_parents;
+    for (const auto& entry : wallet.mapWallet) {
+        const CWalletTx& wtx = entry.second;
+        if (!locked_chain->checkFinalTx(*wtx.tx) || wtx.IsImmature() || !wtx.IsTrusted(*locked_chain, trusted_parents)) continue;
+        for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+            if (wtx.tx->vout[i].nValue > 0 && !wallet.IsLockedCoin(entry.first, i) && !wallet.IsSpent(entry.first, i) &&
+                wallet.IsMine(wtx.tx->vout[i]) != ISMINE_NO) {
+                expected.emplace(entry.first, i);
+            }
+        }
+    }
+    BOOST_CHECK(found == expected);
+    return found;
+}
+
+BOOST_FIXTURE_TEST_CASE(unspent_outputs, ListCoinsTestingSetup)
+{
+    const CScript coinbase_script = GetScriptForRawPubKey(coinbaseKey.GetPubKey());
+    CCoinControl coin_control;
+    coin_control.destChange = PKHash(coinbaseKey.GetPubKey());
+    auto commit_tx = [&](CAmount value) {
+        CTransactionRef tx;
+        CAmount fee;
+        int change_pos = -1;
+        std::string error;
+        {
+            auto locked_chain = m_chain->lock();
+            BOOST_CHECK(wallet->CreateTransaction(*locked_chain, {CRecipient{GetScriptForRawPubKey({}), value, false /* subtract fee */}}, tx, fee, change_pos, error, coin_control));
+        }
+        wallet->CommitTransaction(tx, {}, {});
+        return tx;
+    };
+    auto connect_block = [&](const std::vector<CMutableTransaction>& txns) {
+        const CBlock block = CreateAndProcessBlock(txns, coinbase_script);
+        BOOST_CHECK(::ChainActive().Tip()->GetBlockHash() == block.GetHash());
+        wallet->blockConnected(block, ::ChainActive().Height());
+        return block;
+    };
+
+    std::set<COutPoint> available = CheckUnspentOutputs(*wallet, *m_chain);
+    BOOST_CHECK_EQUAL(available.size(), 1U);
+
+    // A confirmed spend
+    CTransactionRef spend = commit_tx(1 * COIN);
+    connect_block({CMutableTransaction(*spend)});
+    available = CheckUnspentOutputs(*wallet, *m_chain);
+    BOOST_CHECK(!available.count(spend->vin[0].prevout));
+
+    // A spend that never reached the mempool holds on to its inputs until
+    // it is abandoned
+    CTransactionRef abandoned = commit_tx(2 * COIN);
+    available = CheckUnspentOutputs(*wallet, *m_chain);
+    BOOST_CHECK(!available.count(abandoned->vin[0].prevout));
+    BOOST_CHECK(wallet->AbandonTransaction(abandoned->GetHash()));
+    available = CheckUnspentOutputs(*wallet, *m_chain);
+    BOOST_CHECK(available.count(abandoned->vin[0].prevout));
+
+    // Confirming another spend of the same inputs conflicts it, and
+    // disconnecting that block again unconflicts it
+    CMutableTransaction conflict(*abandoned);
+    --conflict.vin[0].nSequence;
+    {
+        LOCK(wallet->cs_wallet);
+        BOOST_CHECK(wallet->SignTransaction(conflict));
+    }
+    const CBlock block = connect_block({conflict});
+    available = CheckUnspentOutputs(*wallet, *m_chain);
+    BOOST_CHECK(!available.count(abandoned->vin[0].prevout));
+    {
+        LOCK(wallet->cs_wallet);
+        BOOST_CHECK(wallet->mapWallet.at(abandoned->GetHash()).isConflicted());
+    }
+    wallet->blockDisconnected(block, ::ChainActive().Height());
+    CheckUnspentOutputs(*wallet, *m_chain);
+    wallet->blockConnected(block, ::ChainActive().Height());
+    available = CheckUnspentOutputs(*wallet, *m_chain);
+
+    // Zapping the conflicted transaction
+    {
+        auto locked_chain = m_chain->lock();
+        LOCK(wallet->cs_wallet);
+        std::vector<uint256> hashes{abandoned->GetHash()};
+        std::vector<uint256> zapped;
+        BOOST_CHECK(wallet->ZapSelectTx(hashes, zapped) == DBErrors::LOAD_OK);
+        BOOST_CHECK_EQUAL(zapped.size(), 1U);
+    }
+    BOOST_CHECK(CheckUnspentOutputs(*wallet, *m_chain) == available);
+
+    // A wallet loading the same transactions finds the same coins
+    CWallet reloaded(m_chain.get(), WalletLocation(), WalletDatabase::CreateMock());
+    {
+        LOCK(reloaded.cs_wallet);
+        reloaded.SetLastBlockProcessed(::ChainActive().Height(), ::ChainActive().Tip()->GetBlockHash());
+    }
+    bool first_run;
+    reloaded.LoadWallet(first_run);
+    AddKey(reloaded, coinbaseKey);
+    {
+        auto locked_chain = m_chain->lock();
+        LOCK2(wallet->cs_wallet, reloaded.cs_wallet);
+        for (const auto& entry : wallet->mapWallet) {
+            CWalletTx wtx(entry.second);
+            reloaded.LoadToWallet(wtx);
+        }
+    }
+    BOOST_CHECK(CheckUnspentOutputs(reloaded, *m_chain) == available);
+}
+
 BOOST_FIXTURE_TEST_CASE(wallet_disableprivkeys, TestChain100Setup)
 {
     NodeContext node;
@@ -635,4 +793,76 @@ BOOST_FIXTURE_TEST_CASE(dummy_input_size_test, TestChain100Setup)
     BOOST_CHECK_EQUAL(CalculateNestedKeyhashInputSize(true), DUMMY_NESTED_P2WPKH_INPUT_SIZE);
 }
 
+static TransactionReceiptInfo TokenReceipt(const uint256& block_hash, const dev::Address& contract, const dev::h256s& topics, uint64_t value)
+{
+    TransactionReceiptInfo receipt{};
+    receipt.blockHash = block_hash;
+    receipt.logs.push_back(dev::eth::LogEntry(contract, topics, dev::h256(dev::u256(value)).asBytes()));
+    return receipt;
+}
+
+//! Turns on fLogEvents, and restores it when the test case ends however it ends
+struct LogEventsSetup {
+    const bool m_log_events{fLogEvents};
+    LogEventsSetup() { fLogEvents = true; }
+    ~LogEventsSetup() { fLogEvents = m_log_events; }
+};
+
+BOOST_AUTO_TEST_CASE(token_txs)
+{
+    const LogEventsSetup log_events;
+
+    CKey key;
+    key.MakeNewKey(true);
+    const PKHash sender(key.GetPubKey());
+    CTokenInfo token;
+    token.strContractAddress = "a0b1c2d3e4f5a0b1c2d3e4f5a0b1c2d3e4f5a0b1";
+    token.strSenderAddress = EncodeDestination(sender);
+    const std::map<uint256, CTokenInfo> tokens{{token.GetHash(), token}};
+
+    CMutableTransaction mtx;
+    mtx.vout.emplace_back(0, CScript() << OP_CALL);
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(mtx));
+    const uint256 block_hash = block.GetHash();
+    const uint256 txid = block.vtx[0]->GetHash();
+
+    // A Transfer and a Burn by the sender in the block, and a Transfer from
+    // another block the transaction was included in
+    const dev::Address contract(token.strContractAddress);
+    const dev::h256 transfer = dev::sha3(std::string("Transfer(address,address,uint256)"));
+    const dev::h256 burn = dev::sha3(std::string("Burn(address,uint256)"));
+    const dev::h256 sender_topic(std::string(24, '0') + HexStr(sender));
+    const dev::h256 receiver_topic(std::string(24, '0') + std::string(40, 'b'));
+    std::vector<TransactionReceiptInfo> receipts{
+        TokenReceipt(block_hash, contract, {transfer, sender_topic, receiver_topic}, 100),
+        TokenReceipt(block_hash, contract, {burn, sender_topic}, 5),
+        TokenReceipt(InsecureRand256(), contract, {transfer, sender_topic, receiver_topic}, 1000)};
+    pstorageresult->addResult(uintToh256(txid), receipts);
+    pstorageresult->commitResults();
+
+    LOCK(m_wallet.cs_wallet);
+    m_wallet.AddTokenTxs(block, 1, tokens);
+    BOOST_REQUIRE_EQUAL(m_wallet.mapTokenTx.size(), 2U);
+    std::map<std::string, uint256> values;
+    for (const auto& entry : m_wallet.mapTokenTx) {
+        const CTokenTx& tokenTx = entry.second;
+        BOOST_CHECK_EQUAL(tokenTx.strContractAddress, token.strContractAddress);
+        BOOST_CHECK_EQUAL(tokenTx.strSenderAddress, token.strSenderAddress);
+        BOOST_CHECK(tokenTx.transactionHash == txid);
+        BOOST_CHECK(tokenTx.blockHash == block_hash);
+        BOOST_CHECK_EQUAL(tokenTx.blockNumber, 1);
+        values[tokenTx.strReceiverAddress] = tokenTx.nValue;
+    }
+    BOOST_REQUIRE_EQUAL(values.size(), 2U);
+    BOOST_CHECK(values.at("") == u256Touint(dev::u256(5)));
+    BOOST_CHECK(values.rbegin()->second == u256Touint(dev::u256(100)));
+
+    // Only the entries of the disconnected block are removed
+    m_wallet.RemoveTokenTxs(InsecureRand256());
+    BOOST_CHECK_EQUAL(m_wallet.mapTokenTx.size(), 2U);
+    m_wallet.RemoveTokenTxs(block_hash);
+    BOOST_CHECK(m_wallet.mapTokenTx.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -31,10 +31,18 @@
 #include <wallet/coincontrol.h>
 #include <wallet/fees.h>
 #include <miner.h>
+#include <util/convert.h>
+#include <validation.h>
+#include <yupost/storageresults.h>
 #include <yupost/yupostledger.h>
+#include <yupost/yuposttoken.h>
+#include <libdevcore/SHA3.h>
 
 #include <algorithm>
 #include <assert.h>
+#include <condition_variable>
+#include <deque>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 
@@ -511,11 +519,37 @@ bool CWallet::IsSpent(const uint256& hash, unsigned int n) const
     return false;
 }
 
+bool CWallet::HasActiveSpend(const COutPoint& outpoint) const
+{
+    std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range;
+    range = mapTxSpends.equal_range(outpoint);
+
+    for (TxSpends::const_iterator it = range.first; it != range.second; ++it)
+    {
+        std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(it->second);
+        if (mit != mapWallet.end() && !mit->second.isConflicted() && !mit->second.isAbandoned()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CWallet::UpdateUnspent(const COutPoint& outpoint)
+{
+    std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
+    if (it == mapWallet.end() || outpoint.n >= it->second.tx->vout.size() || HasActiveSpend(outpoint)) {
+        m_unspent_outputs.erase(outpoint);
+    } else {
+        m_unspent_outputs.insert(outpoint);
+    }
+}
+
 void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.insert(std::make_pair(outpoint, wtxid));
 
     setLockedCoins.erase(outpoint);
+    UpdateUnspent(outpoint);
 
     std::pair<TxSpends::iterator, TxSpends::iterator> range;
     range = mapTxSpends.equal_range(outpoint);
@@ -535,6 +569,7 @@ void CWallet::RemoveFromSpends(const COutPoint& outpoint, const uint256& wtxid)
             break;
         }
     }
+    UpdateUnspent(outpoint);
     range = mapTxSpends.equal_range(outpoint);
     if(range.first != range.second)
         SyncMetaData(range);
@@ -731,6 +766,20 @@ int64_t CWallet::IncOrderPosNext(WalletBatch* batch)
     return nRet;
 }
 
+void CWalletTx::MarkDirty()
+{
+    m_amounts[DEBIT].Reset();
+    m_amounts[CREDIT].Reset();
+    m_amounts[IMMATURE_CREDIT].Reset();
+    m_amounts[AVAILABLE_CREDIT].Reset();
+    fChangeCached = false;
+    m_is_cache_empty = true;
+    if (m_balance_settled && pwallet) {
+        AssertLockHeld(pwallet->cs_wallet);
+        pwallet->UnsettleBalance(*this);
+    }
+}
+
 void CWallet::MarkDirty()
 {
     {
@@ -841,8 +890,13 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
     // Inserts only if not already there, returns tx inserted or tx found
     std::pair<std::map<uint256, CWalletTx>::iterator, bool> ret = mapWallet.insert(std::make_pair(hash, wtxIn));
     CWalletTx& wtx = (*ret.first).second;
-    wtx.BindWallet(this);
     bool fInsertedNew = ret.second;
+    if (fInsertedNew) {
+        // Copies of settled transactions are not in the balance yet
+        wtx.m_balance_settled = false;
+        m_unsettled_txs.insert(hash);
+    }
+    wtx.BindWallet(this);
     if (fInsertedNew) {
         wtx.nTimeReceived = chain().getAdjustedTime();
         wtx.nOrderPos = IncOrderPosNext(&batch);
@@ -885,6 +939,16 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         }
     }
 
+    // The outputs this transaction spends and creates follow its status
+    if (fInsertedNew || fUpdated) {
+        for (const CTxIn& txin : wtx.tx->vin) {
+            UpdateUnspent(txin.prevout);
+        }
+        for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+            UpdateUnspent(COutPoint(hash, i));
+        }
+    }
+
     // Update unspent addresses
     if(fUpdateAddressUnspentCache)
     {
@@ -975,11 +1039,18 @@ void CWallet::LoadToWallet(CWalletTx& wtxIn)
     uint256 hash = wtxIn.GetHash();
     const auto& ins = mapWallet.emplace(hash, wtxIn);
     CWalletTx& wtx = ins.first->second;
+    if (/* insertion took place */ ins.second) {
+        wtx.m_balance_settled = false;
+        m_unsettled_txs.insert(hash);
+    }
     wtx.BindWallet(this);
     if (/* insertion took place */ ins.second) {
         wtx.m_it_wtxOrdered = wtxOrdered.insert(std::make_pair(wtx.nOrderPos, &wtx));
     }
     AddToSpends(hash);
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+        UpdateUnspent(COutPoint(hash, i));
+    }
     for (const CTxIn& txin : wtx.tx->vin) {
         auto it = mapWallet.find(txin.prevout.hash);
         if (it != mapWallet.end()) {
@@ -1053,6 +1124,7 @@ void CWallet::MarkInputsDirty(const CTransactionRef& tx)
         auto it = mapWallet.find(txin.prevout.hash);
         if (it != mapWallet.end()) {
             it->second.MarkDirty();
+            UpdateUnspent(txin.prevout);
         }
     }
 }
@@ -1247,6 +1319,7 @@ void CWallet::blockConnected(const CBlock& block, int height)
         SyncTransaction(block.vtx[index], {CWalletTx::Status::CONFIRMED, height, block_hash, (int)index});
         transactionRemovedFromMempool(block.vtx[index], MemPoolRemovalReason::BLOCK);
     }
+    AddTokenTxs(block, height, mapToken);
 }
 
 void CWallet::blockDisconnected(const CBlock& block, int height)
@@ -1260,10 +1333,15 @@ void CWallet::blockDisconnected(const CBlock& block, int height)
     // future with a stickier abandoned state or even removing abandontransaction call.
     m_last_block_processed_height = height - 1;
     m_last_block_processed = block.hashPrevBlock;
+    // A settled transaction in the disconnected block is no longer confirmed
+    if (height <= m_settled_max_block_height) {
+        UnsettleAllBalances();
+    }
     for (const CTransactionRef& ptx : block.vtx) {
         int index = ptx->IsCoinStake() ? -1 : 0;
         SyncTransaction(ptx, {CWalletTx::Status::UNCONFIRMED, /* block height */ 0, /* block hash */ {}, index});
     }
+    RemoveTokenTxs(block.GetHash());
 }
 
 void CWallet::updatedBlockTip()
@@ -1758,6 +1836,203 @@ int64_t CWallet::RescanFromTime(int64_t startTime, const WalletRescanReserver& r
  * the main chain after to the addition of any new keys you want to detect
  * transactions for.
  */
+namespace {
+/**
+ * Blocks on their way to a wallet rescan. Blocks are pushed in chain order
+ * and popped in the same order. Worker threads check each block's BASIC
+ * filter against the wallet's scripts, and its CONTRACT filter against the
+ * wallet's token contracts, if filters are given and the block filter indexes
+ * have the block. They read the blocks that may match from disk. Without
+ * workers, Pop does both itself.
+ */
+class RescanReadAhead
+{
+public:
+    enum class Status {
+        SKIPPED, //!< The block filters match neither the wallet's scripts nor its tokens
+        READ,    //!< The block was read from disk
+        FAILED,  //!< The block could not be read from disk
+    };
+
+    struct Filters {
+        GCSFilter::ElementSet scripts;   //!< Checked against BASIC filters
+        GCSFilter::ElementSet contracts; //!< Checked against CONTRACT filters, unless empty
+    };
+    using FilterSet = std::shared_ptr<const Filters>;
+
+private:
+    struct Item {
+        const uint256 hash;
+        const int height;
+        CBlock block;
+        FilterSet filter_set;
+        Status status{Status::FAILED};
+        bool claimed{false};
+        bool done{false};
+
+        Item(const uint256& hash_in, int height_in) : hash(hash_in), height(height_in) {}
+    };
+
+    interfaces::Chain& m_chain;
+    Mutex m_mutex;
+    std::condition_variable m_cv_work;
+    std::condition_variable m_cv_done;
+    std::deque<std::shared_ptr<Item>> m_items GUARDED_BY(m_mutex);
+    FilterSet m_filter_set GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+
+    void Process(Item& item, const FilterSet& filter_set) const
+    {
+        item.filter_set = filter_set;
+        if (filter_set) {
+            Optional<bool> matches = m_chain.blockFilterMatchesAny(BlockFilterType::BASIC, item.hash, filter_set->scripts);
+            if (matches && !*matches && !filter_set->contracts.empty()) {
+                matches = m_chain.blockFilterMatchesAny(BlockFilterType::CONTRACT, item.hash, filter_set->contracts);
+            }
+            if (matches && !*matches) {
+                item.status = Status::SKIPPED;
+                return;
+            }
+        }
+        item.status = m_chain.findBlock(item.hash, &item.block) && !item.block.IsNull() ? Status::READ : Status::FAILED;
+    }
+
+    void ThreadWork()
+    {
+        while (true) {
+            std::shared_ptr<Item> item;
+            FilterSet filter_set;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cv_work.wait(lock, [&] {
+                    if (m_stop) return true;
+                    for (const auto& queued : m_items) {
+                        if (!queued->claimed) {
+                            item = queued;
+                            return true;
+                        }
+                    }
+                    return false;
+                });
+                if (m_stop) return;
+                item->claimed = true;
+                filter_set = m_filter_set;
+            }
+            Process(*item, filter_set);
+            {
+                LOCK(m_mutex);
+                item->done = true;
+            }
+            m_cv_done.notify_all();
+        }
+    }
+
+public:
+    RescanReadAhead(interfaces::Chain& chain, int threads) : m_chain(chain)
+    {
+        threads = std::min(threads, MAX_RESCAN_THREADS);
+        for (int i = 0; i < threads; ++i) {
+            m_threads.emplace_back(&TraceThread<std::function<void()>>, "rescanread", std::bind(&RescanReadAhead::ThreadWork, this));
+        }
+    }
+
+    ~RescanReadAhead()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_cv_work.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    /// Number of blocks to keep on their way.
+    size_t Capacity() const { return std::max<size_t>(1, m_threads.size() * RESCAN_READ_AHEAD_PER_THREAD); }
+
+    size_t Size()
+    {
+        LOCK(m_mutex);
+        return m_items.size();
+    }
+
+    /// Set the scripts blocks are checked against. Blocks skipped with an
+    /// earlier set are checked again when popped. nullptr reads all blocks.
+    void SetFilterSet(FilterSet filter_set)
+    {
+        LOCK(m_mutex);
+        m_filter_set = std::move(filter_set);
+    }
+
+    void Push(const uint256& hash, int height)
+    {
+        {
+            LOCK(m_mutex);
+            m_items.push_back(std::make_shared<Item>(hash, height));
+        }
+        m_cv_work.notify_one();
+    }
+
+    /// The oldest block on its way, if any.
+    bool Front(uint256& hash, int& height)
+    {
+        LOCK(m_mutex);
+        if (m_items.empty()) return false;
+        hash = m_items.front()->hash;
+        height = m_items.front()->height;
+        return true;
+    }
+
+    /// Drop all blocks on their way, for example after a reorg.
+    void Clear()
+    {
+        LOCK(m_mutex);
+        m_items.clear();
+    }
+
+    /// Take the oldest block once it has been checked and, unless skipped,
+    /// read.
+    Status Pop(uint256& hash, int& height, CBlock& block)
+    {
+        std::shared_ptr<Item> item;
+        FilterSet filter_set;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            assert(!m_items.empty());
+            item = m_items.front();
+            m_items.pop_front();
+            if (item->claimed) {
+                m_cv_done.wait(lock, [&] { return item->done; });
+            } else {
+                item->claimed = true;
+            }
+            filter_set = m_filter_set;
+        }
+        if (!item->done || (item->status == Status::SKIPPED && item->filter_set != filter_set)) {
+            Process(*item, filter_set);
+        }
+
+        hash = item->hash;
+        height = item->height;
+        block = std::move(item->block);
+        return item->status;
+    }
+};
+} // namespace
+
+/** Get the elements to check block filters against in a rescan. */
+static RescanReadAhead::FilterSet GetRescanFilterSet(const LegacyScriptPubKeyMan& spk_man, GCSFilter::ElementSet contracts)
+{
+    auto filter_set = std::make_shared<RescanReadAhead::Filters>();
+    for (const CScript& script : spk_man.GetScriptPubKeys()) {
+        filter_set->scripts.emplace(script.begin(), script.end());
+    }
+    filter_set->contracts = std::move(contracts);
+    return filter_set;
+}
+
 CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_block, const uint256& stop_block, const WalletRescanReserver& reserver, bool fUpdate)
 {
     int64_t nNow = GetTime();
@@ -1787,6 +2062,43 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
         progress_end = chain().guessVerificationProgress(stop_block.IsNull() ? tip_hash : stop_block);
     }
     double progress_current = progress_begin;
+
+    // Blocks are checked against the wallet's scripts with the BASIC block
+    // filter, when its index runs, and read ahead by -rescanthreads workers.
+    // Wallet updates are applied here, in chain order.
+    RescanReadAhead read_ahead(chain(), gArgs.GetArg("-rescanthreads", DEFAULT_RESCAN_THREADS));
+    LegacyScriptPubKeyMan* spk_man = GetLegacyScriptPubKeyMan();
+    GCSFilter::ElementSet token_contracts;
+    {
+        LOCK(cs_wallet);
+        token_contracts = GetTokenFilterSet();
+    }
+    const bool use_filters = spk_man && chain().hasBlockFilterIndex(BlockFilterType::BASIC) &&
+                             (token_contracts.empty() || chain().hasBlockFilterIndex(BlockFilterType::CONTRACT));
+    if (use_filters) {
+        read_ahead.SetFilterSet(GetRescanFilterSet(*spk_man, token_contracts));
+    }
+    int blocks_skipped = 0;
+    // The last block handed to read_ahead. Blocks on their way always
+    // continue the chain from block_height up to queued_height.
+    uint256 queued_hash;
+    int queued_height = 0;
+    auto queue_blocks = [&](interfaces::Chain::Lock& locked_chain, int tip_height) {
+        while (read_ahead.Size() < read_ahead.Capacity() && queued_hash != stop_block && queued_height < tip_height) {
+            queued_hash = locked_chain.getBlockHash(++queued_height);
+            read_ahead.Push(queued_hash, queued_height);
+        }
+    };
+    if (block_height) {
+        read_ahead.Push(block_hash, *block_height);
+        queued_hash = block_hash;
+        queued_height = *block_height;
+        auto locked_chain = chain().lock();
+        if (Optional<int> tip_height = locked_chain->getHeight()) {
+            queue_blocks(*locked_chain, *tip_height);
+        }
+    }
+
     while (block_height && !fAbortRescan && !chain().shutdownRequested()) {
         m_scanning_progress = (progress_current - progress_begin) / (progress_end - progress_begin);
         if (*block_height % 100 == 0 && progress_end - progress_begin > 0.0) {
@@ -1798,7 +2110,10 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
         }
 
         CBlock block;
-        if (chain().findBlock(block_hash, &block) && !block.IsNull()) {
+        int popped_height;
+        const RescanReadAhead::Status status = read_ahead.Pop(block_hash, popped_height, block);
+        assert(popped_height == *block_height);
+        if (status != RescanReadAhead::Status::FAILED) {
             auto locked_chain = chain().lock();
             LOCK(cs_wallet);
             if (!locked_chain->getBlockHeight(block_hash)) {
@@ -1810,8 +2125,18 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
                 result.status = ScanResult::FAILURE;
                 break;
             }
-            for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                SyncTransaction(block.vtx[posInBlock], {CWalletTx::Status::CONFIRMED, *block_height, block_hash, (int)posInBlock}, fUpdate);
+            if (status == RescanReadAhead::Status::SKIPPED) {
+                ++blocks_skipped;
+            } else {
+                const size_t wallet_size = mapWallet.size();
+                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
+                    SyncTransaction(block.vtx[posInBlock], {CWalletTx::Status::CONFIRMED, *block_height, block_hash, (int)posInBlock}, fUpdate);
+                }
+                AddTokenTxs(block, *block_height, mapToken);
+                // New wallet transactions may have topped up the keypool
+                if (use_filters && mapWallet.size() != wallet_size) {
+                    read_ahead.SetFilterSet(GetRescanFilterSet(*spk_man, token_contracts));
+                }
             }
             // scan succeeded, record block as most recent successfully scanned
             result.last_scanned_block = block_hash;
@@ -1833,6 +2158,16 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
                 break;
             }
 
+            // drop blocks read ahead from a chain that was reorged out
+            uint256 next_hash;
+            int next_height;
+            if (read_ahead.Front(next_hash, next_height) && locked_chain->getBlockHash(next_height) != next_hash) {
+                read_ahead.Clear();
+                queued_hash = block_hash;
+                queued_height = *block_height;
+            }
+            queue_blocks(*locked_chain, *tip_height);
+
             // increment block and verification progress
             block_hash = locked_chain->getBlockHash(++*block_height);
             progress_current = chain().guessVerificationProgress(block_hash);
@@ -1846,6 +2181,9 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
             }
         }
     }
+    if (blocks_skipped > 0) {
+        WalletLogPrintf("Rescan skipped %d blocks using block filters\n", blocks_skipped);
+    }
     ShowProgress(strprintf("%s " + _("Rescanning...").translated, GetDisplayName()), 100); // hide progress dialog in GUI
     if (block_height && fAbortRescan) {
         WalletLogPrintf("Rescan aborted at block %d. Progress=%f\n", *block_height, progress_current);
@@ -2167,33 +2505,135 @@ void MaybeResendWalletTxs()
  */
 
 
+/**
+ * Depth from which a transaction is trusted and stays mature while the tip
+ * does not move back, so that its share of the balance only changes when it
+ * is marked dirty. Coinbase maturity only grows, at nReduceBlocktimeHeight.
+ */
+static int BalanceSettledDepth(int tip_height)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    return params.CoinbaseMaturity(std::max(tip_height + 1, params.nReduceBlocktimeHeight)) + 1;
+}
+
+static void AddToBalance(CWallet::Balance& ret, const CWalletTx& wtx, const int min_depth, bool avoid_reuse,
+                         interfaces::Chain::Lock& locked_chain, std::set<uint256>& trusted_parents)
+{
+    isminefilter reuse_filter = avoid_reuse ? ISMINE_NO : ISMINE_USED;
+    const bool is_trusted{wtx.IsTrusted(locked_chain, trusted_parents)};
+    const int tx_depth{wtx.GetDepthInMainChain()};
+    const CAmount tx_credit_mine{wtx.GetAvailableCredit(/* fUseCache */ true, ISMINE_SPENDABLE | reuse_filter)};
+    const CAmount tx_credit_watchonly{wtx.GetAvailableCredit(/* fUseCache */ true, ISMINE_WATCH_ONLY | reuse_filter)};
+    if (is_trusted && tx_depth >= min_depth) {
+        ret.m_mine_trusted += tx_credit_mine;
+        ret.m_watchonly_trusted += tx_credit_watchonly;
+    }
+    if (!is_trusted && tx_depth == 0 && wtx.InMempool()) {
+        ret.m_mine_untrusted_pending += tx_credit_mine;
+        ret.m_watchonly_untrusted_pending += tx_credit_watchonly;
+    }
+    ret.m_mine_immature += wtx.GetImmatureCredit();
+    ret.m_watchonly_immature += wtx.GetImmatureWatchOnlyCredit();
+    ret.m_mine_stake += wtx.GetStakeCredit();
+    ret.m_watchonly_stake += wtx.GetStakeWatchOnlyCredit();
+}
+
+void CWallet::SettleBalance(const CWalletTx& wtx) const
+{
+    AssertLockHeld(cs_wallet);
+    for (bool avoid_reuse : {false, true}) {
+        isminefilter reuse_filter = avoid_reuse ? ISMINE_NO : ISMINE_USED;
+        wtx.m_settled_credit[avoid_reuse][false] = wtx.GetAvailableCredit(/* fUseCache */ true, ISMINE_SPENDABLE | reuse_filter);
+        wtx.m_settled_credit[avoid_reuse][true] = wtx.GetAvailableCredit(/* fUseCache */ true, ISMINE_WATCH_ONLY | reuse_filter);
+        m_settled_credit[avoid_reuse][false] += wtx.m_settled_credit[avoid_reuse][false];
+        m_settled_credit[avoid_reuse][true] += wtx.m_settled_credit[avoid_reuse][true];
+    }
+    wtx.m_balance_settled = true;
+    m_settled_max_block_height = std::max(m_settled_max_block_height, wtx.m_confirm.block_height);
+}
+
+void CWallet::UnsettleBalance(const CWalletTx& wtx) const
+{
+    AssertLockHeld(cs_wallet);
+    wtx.m_balance_settled = false;
+    // Copies of wallet transactions were never added
+    auto it = mapWallet.find(wtx.GetHash());
+    if (it == mapWallet.end() || &it->second != &wtx) return;
+    for (bool avoid_reuse : {false, true}) {
+        m_settled_credit[avoid_reuse][false] -= wtx.m_settled_credit[avoid_reuse][false];
+        m_settled_credit[avoid_reuse][true] -= wtx.m_settled_credit[avoid_reuse][true];
+    }
+    m_unsettled_txs.insert(wtx.GetHash());
+}
+
+void CWallet::UnsettleAllBalances() const
+{
+    AssertLockHeld(cs_wallet);
+    for (const auto& entry : mapWallet) {
+        if (entry.second.m_balance_settled) {
+            entry.second.m_balance_settled = false;
+            m_unsettled_txs.insert(entry.first);
+        }
+    }
+    for (bool avoid_reuse : {false, true}) {
+        m_settled_credit[avoid_reuse][false] = 0;
+        m_settled_credit[avoid_reuse][true] = 0;
+    }
+    m_settled_max_block_height = -1;
+}
+
 CWallet::Balance CWallet::GetBalance(const int min_depth, bool avoid_reuse) const
 {
     Balance ret;
-    isminefilter reuse_filter = avoid_reuse ? ISMINE_NO : ISMINE_USED;
     {
         auto locked_chain = chain().lock();
         LOCK(cs_wallet);
         std::set<uint256> trusted_parents;
-        for (const auto& entry : mapWallet)
-        {
-            const CWalletTx& wtx = entry.second;
-            const bool is_trusted{wtx.IsTrusted(*locked_chain, trusted_parents)};
-            const int tx_depth{wtx.GetDepthInMainChain()};
-            const CAmount tx_credit_mine{wtx.GetAvailableCredit(/* fUseCache */ true, ISMINE_SPENDABLE | reuse_filter)};
-            const CAmount tx_credit_watchonly{wtx.GetAvailableCredit(/* fUseCache */ true, ISMINE_WATCH_ONLY | reuse_filter)};
-            if (is_trusted && tx_depth >= min_depth) {
-                ret.m_mine_trusted += tx_credit_mine;
-                ret.m_watchonly_trusted += tx_credit_watchonly;
+        const int settled_depth = BalanceSettledDepth(GetLastBlockHeight());
+        if (min_depth > settled_depth) {
+            for (const auto& entry : mapWallet) {
+                AddToBalance(ret, entry.second, min_depth, avoid_reuse, *locked_chain, trusted_parents);
             }
-            if (!is_trusted && tx_depth == 0 && wtx.InMempool()) {
-                ret.m_mine_untrusted_pending += tx_credit_mine;
-                ret.m_watchonly_untrusted_pending += tx_credit_watchonly;
+            return ret;
+        }
+
+        // Settled transactions could become shallower if the tip moved back
+        if (GetLastBlockHeight() < m_settled_tip_height) {
+            UnsettleAllBalances();
+        }
+        m_settled_tip_height = GetLastBlockHeight();
+
+        for (auto it = m_unsettled_txs.begin(); it != m_unsettled_txs.end();) {
+            auto wtx_it = mapWallet.find(*it);
+            if (wtx_it == mapWallet.end()) {
+                it = m_unsettled_txs.erase(it);
+                continue;
+            }
+            const CWalletTx& wtx = wtx_it->second;
+            if (wtx.isConfirmed() && wtx.GetDepthInMainChain() >= settled_depth) {
+                SettleBalance(wtx);
+                it = m_unsettled_txs.erase(it);
+                continue;
+            }
+            AddToBalance(ret, wtx, min_depth, avoid_reuse, *locked_chain, trusted_parents);
+            ++it;
+        }
+        ret.m_mine_trusted += m_settled_credit[avoid_reuse][false];
+        ret.m_watchonly_trusted += m_settled_credit[avoid_reuse][true];
+
+        if (gArgs.GetBoolArg("-checkwalletbalance", DEFAULT_CHECK_WALLET_BALANCE)) {
+            Balance full;
+            for (const auto& entry : mapWallet) {
+                AddToBalance(full, entry.second, min_depth, avoid_reuse, *locked_chain, trusted_parents);
             }
-            ret.m_mine_immature += wtx.GetImmatureCredit();
-            ret.m_watchonly_immature += wtx.GetImmatureWatchOnlyCredit();
-            ret.m_mine_stake += wtx.GetStakeCredit();
-            ret.m_watchonly_stake += wtx.GetStakeWatchOnlyCredit();
+            assert(full.m_mine_trusted == ret.m_mine_trusted);
+            assert(full.m_mine_untrusted_pending == ret.m_mine_untrusted_pending);
+            assert(full.m_mine_immature == ret.m_mine_immature);
+            assert(full.m_mine_stake == ret.m_mine_stake);
+            assert(full.m_watchonly_trusted == ret.m_watchonly_trusted);
+            assert(full.m_watchonly_untrusted_pending == ret.m_watchonly_untrusted_pending);
+            assert(full.m_watchonly_immature == ret.m_watchonly_immature);
+            assert(full.m_watchonly_stake == ret.m_watchonly_stake);
         }
     }
     return ret;
@@ -2228,10 +2668,13 @@ void CWallet::AvailableCoins(interfaces::Chain::Lock& locked_chain, std::vector<
     const int max_depth = {coinControl ? coinControl->m_max_depth : DEFAULT_MAX_DEPTH};
 
     std::set<uint256> trusted_parents;
-    for (const auto& entry : mapWallet)
+    std::set<COutPoint>::const_iterator next_tx;
+    for (auto it = m_unspent_outputs.cbegin(); it != m_unspent_outputs.cend(); it = next_tx)
     {
-        const uint256& wtxid = entry.first;
-        const CWalletTx& wtx = entry.second;
+        const uint256& wtxid = it->hash;
+        const CWalletTx& wtx = mapWallet.at(wtxid);
+        // The unspent outputs of a transaction follow each other
+        next_tx = m_unspent_outputs.lower_bound(COutPoint(wtxid, std::numeric_limits<uint32_t>::max()));
 
         if (!locked_chain.checkFinalTx(*wtx.tx)) {
             continue;
@@ -2290,14 +2733,15 @@ void CWallet::AvailableCoins(interfaces::Chain::Lock& locked_chain, std::vector<
             continue;
         }
 
-        for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+        for (auto out = it; out != next_tx; ++out) {
+            const unsigned int i = out->n;
             if (wtx.tx->vout[i].nValue < nMinimumAmount || wtx.tx->vout[i].nValue > nMaximumAmount)
                 continue;
 
-            if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(COutPoint(entry.first, i)))
+            if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(*out))
                 continue;
 
-            if (IsLockedCoin(entry.first, i))
+            if (IsLockedCoin(wtxid, i))
                 continue;
 
             if (IsSpent(wtxid, i))
@@ -2430,13 +2874,14 @@ const CTxOut& CWallet::FindNonChangeParentOutput(const CTransaction& tx, int out
     return ptx->vout[n];
 }
 
-bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const CoinEligibilityFilter& eligibility_filter, std::vector<OutputGroup> groups,
+bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const CoinEligibilityFilter& eligibility_filter, const std::vector<OutputGroup>& groups,
                                  std::set<CInputCoin>& setCoinsRet, CAmount& nValueRet, const CoinSelectionParams& coin_selection_params, bool& bnb_used) const
 {
     setCoinsRet.clear();
     nValueRet = 0;
 
     std::vector<OutputGroup> utxo_pool;
+    utxo_pool.reserve(groups.size());
     if (coin_selection_params.use_bnb) {
         // Get long term estimate
         FeeCalculation feeCalc;
@@ -2448,9 +2893,11 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const CoinEligibil
         CAmount cost_of_change = GetDiscardRate(*this).GetFee(coin_selection_params.change_spend_size) + coin_selection_params.effective_fee.GetFee(coin_selection_params.change_output_size);
 
         // Filter by the min conf specs and add to utxo_pool and calculate effective value
-        for (OutputGroup& group : groups) {
-            if (!group.EligibleForSpending(eligibility_filter)) continue;
+        for (const OutputGroup& eligible_group : groups) {
+            if (!eligible_group.EligibleForSpending(eligibility_filter)) continue;
 
+            utxo_pool.push_back(eligible_group);
+            OutputGroup& group = utxo_pool.back();
             group.fee = 0;
             group.long_term_fee = 0;
             group.effective_value = 0;
@@ -2471,12 +2918,12 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const CoinEligibil
                     it = group.Discard(coin);
                 }
             }
-            if (group.effective_value > 0) utxo_pool.push_back(group);
+            if (group.effective_value <= 0) utxo_pool.pop_back();
         }
         // Calculate the fees for things that aren't inputs
         CAmount not_input_fees = coin_selection_params.effective_fee.GetFee(coin_selection_params.tx_noinputs_size);
         bnb_used = true;
-        return SelectCoinsBnB(utxo_pool, nTargetValue, cost_of_change, setCoinsRet, nValueRet, not_input_fees);
+        return SelectCoinsBnB(utxo_pool, nTargetValue, cost_of_change, setCoinsRet, nValueRet, not_input_fees, WALLET_BNB_MAX_DURATION);
     } else {
         // Filter by the min conf specs and add to utxo_pool
         for (const OutputGroup& group : groups) {
@@ -2484,6 +2931,9 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const CoinEligibil
             utxo_pool.push_back(group);
         }
         bnb_used = false;
+        if (utxo_pool.size() > MAX_KNAPSACK_GROUPS) {
+            return SelectCoinsSRD(nTargetValue, utxo_pool, setCoinsRet, nValueRet);
+        }
         return KnapsackSolver(nTargetValue, utxo_pool, setCoinsRet, nValueRet);
     }
 }
@@ -2561,6 +3011,10 @@ bool CWallet::SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAm
         Shuffle(vCoins.begin(), vCoins.end(), FastRandomContext());
     }
     std::vector<OutputGroup> groups = GroupOutputs(vCoins, !coin_control.m_avoid_partial_spends);
+    // Sort once for all tries below, branch and bound needs the largest first
+    std::stable_sort(groups.begin(), groups.end(), [](const OutputGroup& a, const OutputGroup& b) {
+        return a.m_value > b.m_value;
+    });
 
     unsigned int limit_ancestor_count;
     unsigned int limit_descendant_count;
@@ -3969,7 +4423,15 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
     for (uint256 hash : vHashOut) {
         const auto& it = mapWallet.find(hash);
         wtxOrdered.erase(it->second.m_it_wtxOrdered);
+        UnsettleBalance(it->second);
+        const CTransactionRef tx = it->second.tx;
         mapWallet.erase(it);
+        for (unsigned int i = 0; i < tx->vout.size(); i++) {
+            m_unspent_outputs.erase(COutPoint(hash, i));
+        }
+        for (const CTxIn& txin : tx->vin) {
+            UpdateUnspent(txin.prevout);
+        }
         NotifyTransactionChanged(this, hash, CT_DELETED);
     }
 
@@ -5041,49 +5503,57 @@ bool CWallet::LoadTokenTx(const CTokenTx &tokenTx)
 
 bool CWallet::AddTokenEntry(const CTokenInfo &token, bool fFlushOnClose)
 {
-    LOCK(cs_wallet);
-
-    WalletBatch batch(*database, "r+", fFlushOnClose);
+    bool fInsertedNew = true;
+    CTokenInfo wtoken = token;
+    {
+        LOCK(cs_wallet);
 
-    uint256 hash = token.GetHash();
+        WalletBatch batch(*database, "r+", fFlushOnClose);
 
-    bool fInsertedNew = true;
+        uint256 hash = token.GetHash();
 
-    std::map<uint256, CTokenInfo>::iterator it = mapToken.find(hash);
-    if(it!=mapToken.end())
-    {
-        fInsertedNew = false;
-    }
+        std::map<uint256, CTokenInfo>::iterator it = mapToken.find(hash);
+        if(it!=mapToken.end())
+        {
+            fInsertedNew = false;
+        }
 
-    // Write to disk
-    CTokenInfo wtoken = token;
-    if(!fInsertedNew)
-    {
-        wtoken.nCreateTime = chain().getAdjustedTime();
-    }
-    else
-    {
-        wtoken.nCreateTime = it->second.nCreateTime;
-    }
+        // Write to disk
+        if(fInsertedNew)
+        {
+            wtoken.nCreateTime = chain().getAdjustedTime();
+        }
+        else
+        {
+            wtoken.nCreateTime = it->second.nCreateTime;
+        }
 
-    if (!batch.WriteToken(wtoken))
-        return false;
+        if (!batch.WriteToken(wtoken))
+            return false;
 
-    mapToken[hash] = wtoken;
+        mapToken[hash] = wtoken;
 
-    NotifyTokenChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
+        NotifyTokenChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
-    // Refresh token tx
-    if(fInsertedNew)
-    {
-        for(auto it = mapTokenTx.begin(); it != mapTokenTx.end(); it++)
+        // Refresh token tx
+        if(fInsertedNew)
         {
-            uint256 tokenTxHash = it->second.GetHash();
-            NotifyTokenTransactionChanged(this, tokenTxHash, CT_UPDATED);
+            for(auto it = mapTokenTx.begin(); it != mapTokenTx.end(); it++)
+            {
+                uint256 tokenTxHash = it->second.GetHash();
+                NotifyTokenTransactionChanged(this, tokenTxHash, CT_UPDATED);
+            }
         }
+
+        LogPrintf("AddTokenEntry %s\n", wtoken.GetHash().ToString());
     }
 
-    LogPrintf("AddTokenEntry %s\n", wtoken.GetHash().ToString());
+    // Token transactions of recent blocks are added in the background,
+    // later ones as blocks are connected
+    if(fInsertedNew)
+    {
+        StartTokenScan(wtoken);
+    }
 
     return true;
 }
@@ -5185,8 +5655,11 @@ std::vector<OutputGroup> CWallet::GroupOutputs(const std::vector<COutput>& outpu
         if (output.fSpendable) {
             CInputCoin input_coin = output.GetInputCoin();
 
-            size_t ancestors, descendants;
-            chain().getTransactionAncestry(output.tx->GetHash(), ancestors, descendants);
+            // Only transactions in the mempool have an ancestry there
+            size_t ancestors = 0, descendants = 0;
+            if (output.nDepth == 0) {
+                chain().getTransactionAncestry(output.tx->GetHash(), ancestors, descendants);
+            }
             if (!single_coin && ExtractDestination(output.tx->tx->vout[output.i].scriptPubKey, dst)) {
                 // Limit output groups to no more than 10 entries, to protect
                 // against inadvertently creating a too-large transaction
@@ -5547,6 +6020,176 @@ bool CWallet::CleanTokenTxEntries(bool fFlushOnClose)
     return true;
 }
 
+//! Topics of the QRC20 Transfer and Burn events
+static const dev::h256 TOKEN_TRANSFER_TOPIC = dev::sha3(std::string("Transfer(address,address,uint256)"));
+static const dev::h256 TOKEN_BURN_TOPIC = dev::sha3(std::string("Burn(address,uint256)"));
+
+void CWallet::AddTokenTxs(const CBlock& block, int height, const std::map<uint256, CTokenInfo>& tokens)
+{
+    AssertLockHeld(cs_wallet);
+    if (!fLogEvents || tokens.empty()) return;
+
+    // Token contracts and the addresses they are watched for
+    std::set<std::pair<dev::h160, dev::h160>> watched;
+    for (const auto& entry : tokens) {
+        const CTokenInfo& token = entry.second;
+        std::string sender;
+        if (token.strContractAddress.size() != 40 || !IsHex(token.strContractAddress) ||
+            !YuPostToken::ToHash160(token.strSenderAddress, sender)) {
+            continue;
+        }
+        watched.emplace(dev::h160(token.strContractAddress), dev::h160(sender));
+    }
+
+    const uint256 block_hash = block.GetHash();
+    std::vector<TransactionReceiptInfo> receipts;
+    for (const CTransactionRef& tx : block.vtx) {
+        if (!tx->HasCreateOrCall()) continue;
+        receipts.clear();
+        pstorageresult->readCommittedResult(uintToh256(tx->GetHash()), receipts);
+
+        // Events of a transaction between the same addresses are summed
+        std::map<std::tuple<dev::h160, dev::h160, dev::h160>, dev::u256> transfers;
+        for (const TransactionReceiptInfo& receipt : receipts) {
+            // Receipts of the same transaction in other blocks are stored too
+            if (receipt.blockHash != block_hash) continue;
+            for (const dev::eth::LogEntry& log : receipt.logs) {
+                if (log.topics.empty() || log.data.size() < 32) continue;
+                const bool is_transfer = log.topics[0] == TOKEN_TRANSFER_TOPIC && log.topics.size() >= 3;
+                const bool is_burn = log.topics[0] == TOKEN_BURN_TOPIC && log.topics.size() >= 2;
+                if (!is_transfer && !is_burn) continue;
+
+                const dev::h160 from = dev::right160(log.topics[1]);
+                const dev::h160 to = is_transfer ? dev::right160(log.topics[2]) : dev::h160();
+                if (!watched.count({log.address, from}) && !(is_transfer && watched.count({log.address, to}))) {
+                    continue;
+                }
+                transfers[std::make_tuple(log.address, from, to)] += dev::fromBigEndian<dev::u256>(dev::bytesConstRef(log.data.data(), 32));
+            }
+        }
+
+        for (const auto& transfer : transfers) {
+            CTokenTx tokenTx;
+            tokenTx.strContractAddress = std::get<0>(transfer.first).hex();
+            YuPostToken::ToYuPostAddress(std::get<1>(transfer.first).hex(), tokenTx.strSenderAddress);
+            if (std::get<2>(transfer.first) != dev::h160()) {
+                YuPostToken::ToYuPostAddress(std::get<2>(transfer.first).hex(), tokenTx.strReceiverAddress);
+            }
+            tokenTx.nValue = u256Touint(transfer.second);
+            tokenTx.transactionHash = tx->GetHash();
+            tokenTx.blockHash = block_hash;
+            tokenTx.blockNumber = height;
+            AddTokenTxEntry(tokenTx, false);
+        }
+    }
+}
+
+void CWallet::RemoveTokenTxs(const uint256& block_hash)
+{
+    AssertLockHeld(cs_wallet);
+    WalletBatch batch(*database, "r+", false);
+    for (auto it = mapTokenTx.begin(); it != mapTokenTx.end();) {
+        if (it->second.blockHash != block_hash) {
+            ++it;
+            continue;
+        }
+        const uint256 hash = it->first;
+        batch.EraseTokenTx(hash);
+        it = mapTokenTx.erase(it);
+        NotifyTokenTransactionChanged(this, hash, CT_DELETED);
+    }
+}
+
+void CWallet::ScanTokenTxs(const CTokenInfo& token)
+{
+    if (!fLogEvents) return;
+    const std::map<uint256, CTokenInfo> tokens{{token.GetHash(), token}};
+    const GCSFilter::ElementSet contracts{GCSFilter::Element(ParseHex(token.strContractAddress))};
+
+    // The chain lock is only needed to look up the span, not to read the blocks and their receipts
+    std::vector<std::pair<int, uint256>> span;
+    {
+        auto locked_chain = chain().lock();
+        Optional<int> tip_height = locked_chain->getHeight();
+        if (!tip_height) return;
+        for (int height = std::max(0, *tip_height - Params().GetConsensus().MaxCheckpointSpan()); height <= *tip_height; ++height) {
+            span.emplace_back(height, locked_chain->getBlockHash(height));
+        }
+    }
+
+    for (const auto& entry : span) {
+        if (m_stop_token_scan || chain().shutdownRequested()) return;
+        const int height = entry.first;
+        const uint256& block_hash = entry.second;
+        Optional<bool> matches = chain().blockFilterMatchesAny(BlockFilterType::CONTRACT, block_hash, contracts);
+        if (matches && !*matches) continue;
+        CBlock block;
+        if (!chain().findBlock(block_hash, &block) || block.IsNull()) continue;
+
+        // Skip the block if it was disconnected since the span was looked up. Holding
+        // cs_wallet before releasing the chain lock makes blockDisconnected remove the
+        // token transactions of a block disconnected from now on.
+        auto locked_chain = chain().lock();
+        LOCK(cs_wallet);
+        // The token may have been removed in the meantime
+        if (!mapToken.count(token.GetHash())) return;
+        if (locked_chain->getBlockHeight(block_hash) != height) continue;
+        locked_chain.reset();
+        AddTokenTxs(block, height, tokens);
+    }
+}
+
+void CWallet::ThreadScanTokenTxs()
+{
+    while (true) {
+        CTokenInfo token;
+        {
+            std::lock_guard<std::mutex> lock(m_token_scan_mutex);
+            token = m_token_scan_queue.front();
+        }
+        ScanTokenTxs(token);
+
+        std::lock_guard<std::mutex> lock(m_token_scan_mutex);
+        m_token_scan_queue.erase(m_token_scan_queue.begin());
+        if (m_stop_token_scan) m_token_scan_queue.clear();
+        if (m_token_scan_queue.empty()) return;
+    }
+}
+
+void CWallet::StartTokenScan(const CTokenInfo& token)
+{
+    std::lock_guard<std::mutex> lock(m_token_scan_mutex);
+    if (m_stop_token_scan) return;
+    m_token_scan_queue.push_back(token);
+    // A running scan picks up the token once it is done with the ones before it
+    if (m_token_scan_queue.size() > 1) return;
+    // Only a finished thread is left to join here
+    if (m_token_scan_thread.joinable()) m_token_scan_thread.join();
+    m_token_scan_thread = std::thread(&TraceThread<std::function<void()>>, "tokenscan", std::function<void()>(std::bind(&CWallet::ThreadScanTokenTxs, this)));
+}
+
+void CWallet::StopTokenScan()
+{
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lock(m_token_scan_mutex);
+        m_stop_token_scan = true;
+        thread.swap(m_token_scan_thread);
+    }
+    if (thread.joinable()) thread.join();
+}
+
+GCSFilter::ElementSet CWallet::GetTokenFilterSet() const
+{
+    AssertLockHeld(cs_wallet);
+    GCSFilter::ElementSet contracts;
+    if (!fLogEvents) return contracts;
+    for (const auto& entry : mapToken) {
+        contracts.emplace(ParseHex(entry.second.strContractAddress));
+    }
+    return contracts;
+}
+
 bool CWallet::SetContractBook(const std::string &strAddress, const std::string &strName, const std::string &strAbi)
 {
     bool fUpdated = false;
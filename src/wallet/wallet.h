@@ -30,12 +30,14 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <map>
 #include <memory>
 #include <set>
 #include <stdexcept>
 #include <stdint.h>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -82,6 +84,16 @@ static const bool DEFAULT_SPEND_ZEROCONF_CHANGE = true;
 static const bool DEFAULT_ZERO_BALANCE_ADDRESS_TOKEN = true;
 //! Default for -walletrejectlongchains
 static const bool DEFAULT_WALLET_REJECT_LONG_CHAINS = false;
+//! Default for -checkwalletbalance
+static const bool DEFAULT_CHECK_WALLET_BALANCE = false;
+//! -rescanthreads default
+static const int DEFAULT_RESCAN_THREADS = 4;
+//! Maximum number of -rescanthreads
+static const int MAX_RESCAN_THREADS = 16;
+//! Number of blocks checked and read ahead of a rescan per -rescanthreads worker
+static const int RESCAN_READ_AHEAD_PER_THREAD = 8;
+//! Time a branch and bound coin selection may search before it settles for its best solution
+static constexpr std::chrono::milliseconds WALLET_BNB_MAX_DURATION{100};
 //! -txconfirmtarget default
 static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 6;
 //! -walletrbf default
@@ -360,6 +372,13 @@ public:
     mutable bool fChangeCached;
     mutable bool fInMempool;
     mutable CAmount nChangeCached;
+    /**
+     * Whether the available credit of this transaction is included in the
+     * wallet's settled balance, and the credit included, indexed by
+     * avoid_reuse and watch-only. See CWallet::GetBalance.
+     */
+    mutable bool m_balance_settled{false};
+    mutable CAmount m_settled_credit[2][2]{};
 
     CWalletTx(const CWallet* pwalletIn, CTransactionRef arg)
         : tx(std::move(arg))
@@ -476,15 +495,7 @@ public:
     }
 
     //! make sure balances are recalculated
-    void MarkDirty()
-    {
-        m_amounts[DEBIT].Reset();
-        m_amounts[CREDIT].Reset();
-        m_amounts[IMMATURE_CREDIT].Reset();
-        m_amounts[AVAILABLE_CREDIT].Reset();
-        fChangeCached = false;
-        m_is_cache_empty = true;
-    }
+    void MarkDirty();
 
     void BindWallet(CWallet *pwalletIn)
     {
@@ -667,6 +678,13 @@ private:
     std::mutex mutexScanning;
     friend class WalletRescanReserver;
 
+    //! Tokens whose recent blocks are being scanned in m_token_scan_thread, the one in progress first
+    std::vector<CTokenInfo> m_token_scan_queue;
+    std::thread m_token_scan_thread;
+    std::mutex m_token_scan_mutex;
+    std::atomic<bool> m_stop_token_scan{false};
+    void ThreadScanTokenTxs();
+
     //! the current wallet version: clients below this version are not able to load the wallet
     int nWalletVersion GUARDED_BY(cs_wallet){FEATURE_BASE};
 
@@ -696,6 +714,35 @@ private:
     void AddToSpends(const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     void RemoveFromSpends(const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    /**
+     * Outputs of wallet transactions that no active wallet transaction
+     * spends, in the order of mapWallet. AvailableCoins visits these instead
+     * of every output of every wallet transaction. Spends are active unless
+     * the spending transaction is conflicted or abandoned, so membership only
+     * changes with wallet transaction statuses, never with the tip.
+     */
+    std::set<COutPoint> m_unspent_outputs GUARDED_BY(cs_wallet);
+    bool HasActiveSpend(const COutPoint& outpoint) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void UpdateUnspent(const COutPoint& outpoint) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
+    /**
+     * Balance cache, see GetBalance. The available credit of settled
+     * transactions is summed in m_settled_credit, indexed like
+     * CWalletTx::m_settled_credit. All other transactions are in
+     * m_unsettled_txs.
+     */
+    mutable std::set<uint256> m_unsettled_txs GUARDED_BY(cs_wallet);
+    mutable CAmount m_settled_credit[2][2] GUARDED_BY(cs_wallet){};
+    //! Highest block with a settled transaction in it
+    mutable int m_settled_max_block_height GUARDED_BY(cs_wallet){-1};
+    //! Tip height when the balance was last computed
+    mutable int m_settled_tip_height GUARDED_BY(cs_wallet){-1};
+    void SettleBalance(const CWalletTx& wtx) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    //! Remove a transaction's credit from the settled balance, if it is in it
+    void UnsettleBalance(const CWalletTx& wtx) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void UnsettleAllBalances() const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    friend class CWalletTx; // calls UnsettleBalance when marked dirty
+
     /**
      * Add a transaction to the wallet, or update it.  pIndex and posInBlock should
      * be set when the transaction was known to be included in a block.  When
@@ -825,6 +872,9 @@ public:
         // Stop stake
         StopStake();
 
+        // Stop token scan
+        StopTokenScan();
+
         // Should not have slots connected at this point.
         assert(NotifyUnload.empty());
     }
@@ -913,7 +963,7 @@ public:
      * completion the coin set and corresponding actual target value is
      * assembled
      */
-    bool SelectCoinsMinConf(const CAmount& nTargetValue, const CoinEligibilityFilter& eligibility_filter, std::vector<OutputGroup> groups,
+    bool SelectCoinsMinConf(const CAmount& nTargetValue, const CoinEligibilityFilter& eligibility_filter, const std::vector<OutputGroup>& groups,
         std::set<CInputCoin>& setCoinsRet, CAmount& nValueRet, const CoinSelectionParams& coin_selection_params, bool& bnb_used) const;
 
     bool IsSpent(const uint256& hash, unsigned int n) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
@@ -1022,6 +1072,13 @@ public:
         CAmount m_watchonly_immature{0};
         CAmount m_watchonly_stake{0};
     };
+    /**
+     * Get the balance of the wallet. Transactions deep enough in the chain
+     * to stay mature are settled: they are trusted and their available
+     * credit only changes when they are marked dirty or the tip moves back. Their
+     * credit is kept in a running total, so only the other transactions are
+     * looked at on each call, unless min_depth is larger than that depth.
+     */
     Balance GetBalance(int min_depth = 0, bool avoid_reuse = true) const;
     CAmount GetAvailableBalance(const CCoinControl* coinControl = nullptr) const;
 
@@ -1404,6 +1461,24 @@ public:
     /* Clean token transaction entries in the wallet */
     bool CleanTokenTxEntries(bool fFlushOnClose=true);
 
+    /* Add the token transactions of a block from its Transfer and Burn logs, for the given tokens */
+    void AddTokenTxs(const CBlock& block, int height, const std::map<uint256, CTokenInfo>& tokens) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
+    /* Remove the token transactions of a disconnected block */
+    void RemoveTokenTxs(const uint256& block_hash) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
+    /* Add the token transactions of a new token from the last checkpoint span of blocks, without holding the chain lock while reading them */
+    void ScanTokenTxs(const CTokenInfo& token);
+
+    /* Run ScanTokenTxs for the token in a background thread, after the tokens already queued */
+    void StartTokenScan(const CTokenInfo& token);
+
+    /* Stop the background token scan and wait for it to exit */
+    void StopTokenScan();
+
+    /* Elements of the CONTRACT block filters of blocks with logs of the wallet's tokens */
+    GCSFilter::ElementSet GetTokenFilterSet() const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     /* Load delegation entry into the wallet */
     bool LoadDelegation(const CDelegationInfo &delegation);
 
@@ -3,17 +3,27 @@
 
 StorageResults::StorageResults(std::string const& _path){
 	path = _path + "/resultsDB";
-    leveldb::Options options;
+    dbOptions = GetDBOptions("results", DEFAULT_RESULTS_DB_CACHE);
+    options = MakeLevelDBOptions(dbOptions);
     options.create_if_missing = true;
-    leveldb::Status status = leveldb::DB::Open(options, path, &db);
-    assert(status.ok());
+    openDB();
     LogPrintf("Opened LevelDB successfully\n");
 }
 
 StorageResults::~StorageResults()
 {
+    UnregisterDBStats(db);
     delete db;
     db = NULL;
+    delete options.filter_policy;
+    delete options.info_log;
+    delete options.block_cache;
+}
+
+void StorageResults::openDB(){
+    leveldb::Status status = leveldb::DB::Open(options, path, &db);
+    assert(status.ok());
+    RegisterDBStats("results", db, dbOptions);
 }
 
 void StorageResults::addResult(dev::h256 hashTx, std::vector<TransactionReceiptInfo>& result){
@@ -28,14 +38,12 @@ void StorageResults::wipeResults(){
     LogPrintf("Wiping LevelDB in %s\n", path);
     bool opened = db;
     if (opened) {
+        UnregisterDBStats(db);
         delete db;
     }
     leveldb::Status result = leveldb::DestroyDB(path, leveldb::Options());
     if (opened) {
-        leveldb::Options options;
-        options.create_if_missing = true;
-        leveldb::Status status = leveldb::DB::Open(options, path, &db);
-        assert(status.ok());
+        openDB();
     }
 }
 
@@ -111,7 +119,11 @@ void StorageResults::commitResults(){
     }
 }
 
-bool StorageResults::readResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result){
+bool StorageResults::readCommittedResult(dev::h256 const& hashTx, std::vector<TransactionReceiptInfo>& result) const{
+    return readResult(hashTx, result);
+}
+
+bool StorageResults::readResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result) const{
 
     std::string value;
     std::string keyTemp = _key.hex();;
@@ -180,7 +192,7 @@ logEntriesSerialize StorageResults::logEntriesSerialization(dev::eth::LogEntries
 	return result;
 }
 
-dev::eth::LogEntries StorageResults::logEntriesDeserialize(logEntriesSerialize const& _logs){
+dev::eth::LogEntries StorageResults::logEntriesDeserialize(logEntriesSerialize const& _logs) const{
 	dev::eth::LogEntries result;
 	for(std::pair<dev::Address, std::pair<dev::h256s, dev::bytes>> i : _logs){
 		result.push_back(dev::eth::LogEntry(i.first, i.second.first, dev::bytes(i.second.second)));
@@ -2,9 +2,13 @@
 #include <primitives/transaction.h>
 #include <libethereum/State.h>
 #include <libethereum/Transaction.h>
+#include <dbwrapper.h>
 #include <leveldb/db.h>
 #include <util/system.h>
 
+//! Cache of the receipts database, -dboption=results:cache overrides it
+static const size_t DEFAULT_RESULTS_DB_CACHE = 16 << 20;
+
 using logEntriesSerialize = std::vector<std::pair<dev::Address, std::pair<dev::h256s, dev::bytes>>>;
 
 struct TransactionReceiptInfo{
@@ -58,6 +62,14 @@ public:
 
     std::vector<TransactionReceiptInfo> getResult(dev::h256 const& hashTx);
 
+    /**
+     * Read the results of a transaction from the database only, without
+     * touching the cache. Only LevelDB is accessed, so unlike getResult this
+     * does not need cs_main. Results are committed when their block is
+     * connected.
+     */
+    bool readCommittedResult(dev::h256 const& hashTx, std::vector<TransactionReceiptInfo>& result) const;
+
 	void commitResults();
 
     void clearCacheResult();
@@ -66,14 +78,20 @@ public:
 
 private:
 
-	bool readResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result);
+	bool readResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result) const;
 
 	logEntriesSerialize logEntriesSerialization(dev::eth::LogEntries const& _logs);
 
-	dev::eth::LogEntries logEntriesDeserialize(logEntriesSerialize const& _logs);
+	dev::eth::LogEntries logEntriesDeserialize(logEntriesSerialize const& _logs) const;
+
+    void openDB();
 
 	std::string path;
 
+    DBOptions dbOptions;
+
+    leveldb::Options options;
+
     leveldb::DB* db;
 
 	std::unordered_map<dev::h256, std::vector<TransactionReceiptInfo>> m_cache_result;
@@ -84,6 +84,7 @@ ResultExecute YuPostState::execute(EnvInfo const& _envInfo, SealEngineFace const
                 printfErrorLog(res.excepted);
             }
 
+            recordStorageAccess();
             yupost::commit(cacheUTXO, stateUTXO, m_cache);
             cacheUTXO.clear();
             bool removeEmptyAccounts = _envInfo.number() >= _sealEngine.chainParams().EIP158ForkBlock;
@@ -288,6 +289,39 @@ void YuPostState::validateTransfersWithChangeLog(){
 	transfers=validatedTransfers;
 }
 
+std::vector<dev::u256> YuPostState::recentStorageKeys(dev::Address const& _addr) const{
+    auto it = storageHistory.find(_addr);
+    if(it == storageHistory.end())
+        return std::vector<dev::u256>();
+    return it->second;
+}
+
+void YuPostState::recordStorageAccess(){
+    for(auto const& entry : m_cache){
+        auto const& overlay = entry.second.storageOverlay();
+        if(overlay.empty())
+            continue;
+        auto it = storageHistory.find(entry.first);
+        if(it == storageHistory.end()){
+            if(storageHistory.size() >= MAX_STORAGE_HISTORY_CONTRACTS){
+                storageHistory.erase(storageHistoryOrder.front());
+                storageHistoryOrder.pop_front();
+            }
+            it = storageHistory.emplace(entry.first, std::vector<dev::u256>()).first;
+            storageHistoryOrder.push_back(entry.first);
+        }
+        std::vector<dev::u256>& keys = it->second;
+        for(auto const& slot : overlay){
+            auto found = std::find(keys.begin(), keys.end(), slot.first);
+            if(found != keys.end())
+                keys.erase(found);
+            keys.push_back(slot.first);
+        }
+        if(keys.size() > MAX_STORAGE_HISTORY_SLOTS)
+            keys.erase(keys.begin(), keys.end() - MAX_STORAGE_HISTORY_SLOTS);
+    }
+}
+
 void YuPostState::deployDelegationsContract(){
     dev::Address delegationsAddress = uintToh160(Params().GetConsensus().delegationsAddress);
     if(!YuPostState::addressInUse(delegationsAddress)){
@@ -10,6 +10,8 @@
 #include <primitives/transaction.h>
 #include <yupost/yuposttransaction.h>
 
+#include <deque>
+
 #include <libethereum/Executive.h>
 #include <libethcore/SealEngine.h>
 
@@ -18,6 +20,11 @@ using OnOpFunc = std::function<void(uint64_t, uint64_t, dev::eth::Instruction, d
 using plusAndMinus = std::pair<dev::u256, dev::u256>;
 using valtype = std::vector<unsigned char>;
 
+// Number of recently used storage slots remembered per contract
+static const size_t MAX_STORAGE_HISTORY_SLOTS = 32;
+// Number of contracts for which recently used storage slots are remembered
+static const size_t MAX_STORAGE_HISTORY_CONTRACTS = 4096;
+
 struct TransferInfo{
     dev::Address from;
     dev::Address to;
@@ -110,6 +117,9 @@ public:
 
     void deployDelegationsContract();
 
+    // Storage slots of a contract touched by its most recent executions, oldest first
+    std::vector<dev::u256> recentStorageKeys(dev::Address const& _addr) const;
+
     virtual ~YuPostState(){}
 
     friend CondensingTX;
@@ -145,6 +155,13 @@ private:
 	std::unordered_map<dev::Address, Vin> cacheUTXO;
 
 	void validateTransfersWithChangeLog();
+
+    // Remember the storage slots held in the account cache before it is committed
+    void recordStorageAccess();
+
+    std::unordered_map<dev::Address, std::vector<dev::u256>> storageHistory;
+
+    std::deque<dev::Address> storageHistoryOrder;
 };
 
 
@@ -67,10 +67,28 @@ class RPCInterfaceTest(BitcoinTestFramework):
         expect_http_status(404, -32601, self.nodes[0].invalidmethod)
         expect_http_status(500, -8, self.nodes[0].getblockhash, 42)
 
+    def test_parallel_batch_request(self):
+        self.log.info("Testing JSON-RPC batch request executed on several threads...")
+
+        self.restart_node(0, extra_args=["-rpcbatchthreads=4"])
+        results = self.nodes[0].batch([
+            {"method": "echo" if i % 5 else "invalidmethod", "params": [i], "id": i} for i in range(200)
+        ])
+
+        # Replies come back in request order
+        assert_equal([res["id"] for res in results], list(range(200)))
+        for i, res in enumerate(results):
+            if i % 5:
+                assert_equal(res['error'], None)
+                assert_equal(res['result'], [i])
+            else:
+                assert_equal(res['error']['code'], -32601)
+
     def run_test(self):
         self.test_getrpcinfo()
         self.test_batch_request()
         self.test_http_status_codes()
+        self.test_parallel_batch_request()
 
 
 if __name__ == '__main__':
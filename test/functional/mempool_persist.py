@@ -79,6 +79,8 @@ class MempoolPersistTest(BitcoinTestFramework):
         tx_creation_time = self.nodes[0].getmempoolentry(txid=last_txid)['time']
         assert_greater_than_or_equal(tx_creation_time, tx_creation_time_lower)
         assert_greater_than_or_equal(tx_creation_time_higher, tx_creation_time)
+        # The transactions spend each other's change, so reloading has to respect their order.
+        mempool_before = self.nodes[0].getrawmempool(True)
 
         self.log.debug("Stop-start the nodes. Verify that node0 has the transactions in its mempool and node1 does not. Verify that node2 calculates its balance correctly after loading wallet transactions.")
         self.stop_nodes()
@@ -91,6 +93,10 @@ class MempoolPersistTest(BitcoinTestFramework):
         wait_until(lambda: self.nodes[2].getmempoolinfo()["loaded"], timeout=1)
         assert_equal(len(self.nodes[0].getrawmempool()), 5)
         assert_equal(len(self.nodes[2].getrawmempool()), 5)
+        mempool_after = self.nodes[0].getrawmempool(True)
+        assert_equal(set(mempool_after), set(mempool_before))
+        for txid, entry in mempool_after.items():
+            assert_equal(sorted(entry['depends']), sorted(mempool_before[txid]['depends']))
         # The others have loaded their mempool. If node_1 loaded anything, we'd probably notice by now:
         assert_equal(len(self.nodes[1].getrawmempool()), 0)
 
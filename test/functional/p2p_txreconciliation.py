@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test reconciliation-based transaction relay (-txreconciliation).
+
+Nodes 0-2 enable reconciliation and are connected in a triangle; node 3 does
+not and is only connected to node 2, which has to keep flooding to it.
+"""
+
+import time
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    connect_nodes,
+    wait_until,
+)
+
+
+class TxReconciliationTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 4
+        self.extra_args = [["-txreconciliation"]] * 3 + [[]]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def setup_network(self):
+        self.setup_nodes()
+        # The connecting side initiates the rounds.
+        connect_nodes(self.nodes[1], 0)
+        connect_nodes(self.nodes[2], 1)
+        connect_nodes(self.nodes[2], 0)
+        connect_nodes(self.nodes[3], 2)
+        self.sync_all()
+
+    def recon_peers(self, node):
+        return [p for p in node.getpeerinfo() if 'txreconciliation' in p]
+
+    def run_test(self):
+        self.log.info("Check that reconciliation is negotiated only between supporting peers")
+        wait_until(lambda: len(self.recon_peers(self.nodes[2])) == 2, timeout=30)
+        for node in self.nodes[:2]:
+            wait_until(lambda: len(self.recon_peers(node)) == 2, timeout=30)
+        assert_equal(sorted(p['txreconciliation']['role'] for p in self.recon_peers(self.nodes[0])), ['responder', 'responder'])
+        assert_equal(sorted(p['txreconciliation']['role'] for p in self.recon_peers(self.nodes[2])), ['initiator', 'initiator'])
+        assert_equal(len(self.nodes[2].getpeerinfo()), 3)
+        assert_equal(self.recon_peers(self.nodes[3]), [])
+
+        self.log.info("Relay transactions through reconciliation and flooding")
+        txids = [self.nodes[0].sendtoaddress(self.nodes[0].getnewaddress(), 1) for _ in range(10)]
+        mocktime = int(time.time())
+
+        def relayed():
+            # Move time forward so that trickle timers and reconciliation rounds fire.
+            nonlocal mocktime
+            mocktime += 10
+            for node in self.nodes:
+                node.setmocktime(mocktime)
+            return all(set(txids) <= set(node.getrawmempool()) for node in self.nodes)
+        wait_until(relayed, timeout=120)
+
+        self.log.info("Check per-peer reconciliation statistics")
+        stats = [p['txreconciliation'] for node in self.nodes[:3] for p in self.recon_peers(node)]
+        assert all(s['rounds'] > 0 for s in stats)
+        assert all(s['inv_bytes_saved'] == s['announcements_saved'] * 36 for s in stats)
+        assert all(s['failures'] <= s['rounds'] for s in stats)
+        # The reconciliation messages themselves are accounted like any other message.
+        assert any('sketch' in p['bytesrecv_per_msg'] for p in self.recon_peers(self.nodes[2]))
+
+
+if __name__ == '__main__':
+    TxReconciliationTest().main()
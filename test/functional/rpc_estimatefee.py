@@ -10,7 +10,7 @@ Test the following RPCs:
 """
 
 from test_framework.test_framework import BitcoinTestFramework
-from test_framework.util import assert_raises_rpc_error
+from test_framework.util import assert_equal, assert_raises_rpc_error
 
 class EstimateFeeTest(BitcoinTestFramework):
     def set_test_params(self):
@@ -21,6 +21,7 @@ class EstimateFeeTest(BitcoinTestFramework):
         # missing required params
         assert_raises_rpc_error(-1, "estimatesmartfee", self.nodes[0].estimatesmartfee)
         assert_raises_rpc_error(-1, "estimaterawfee", self.nodes[0].estimaterawfee)
+        assert_raises_rpc_error(-1, "estimatesmartgasprice", self.nodes[0].estimatesmartgasprice)
 
         # wrong type for conf_target
         assert_raises_rpc_error(-3, "Expected type number, got string", self.nodes[0].estimatesmartfee, 'foo')
@@ -29,6 +30,7 @@ class EstimateFeeTest(BitcoinTestFramework):
         # wrong type for estimatesmartfee(estimate_mode)
         assert_raises_rpc_error(-3, "Expected type string, got number", self.nodes[0].estimatesmartfee, 1, 1)
         assert_raises_rpc_error(-8, "Invalid estimate_mode parameter", self.nodes[0].estimatesmartfee, 1, 'foo')
+        assert_raises_rpc_error(-8, "Invalid estimate_mode parameter", self.nodes[0].estimatesmartgasprice, 1, 'foo')
 
         # wrong type for estimaterawfee(threshold)
         assert_raises_rpc_error(-3, "Expected type number, got string", self.nodes[0].estimaterawfee, 1, 'foo')
@@ -46,6 +48,13 @@ class EstimateFeeTest(BitcoinTestFramework):
         self.nodes[0].estimaterawfee(1, None)
         self.nodes[0].estimaterawfee(1, 1)
 
+        # the gas price estimate never goes below the DGP minimum, which is
+        # reported in satoshis like getdgpinfo does
+        gas_estimate = self.nodes[0].estimatesmartgasprice(2, 'ECONOMICAL')
+        assert_equal(gas_estimate['mingasprice'], self.nodes[0].getdgpinfo()['mingasprice'])
+        if 'gasprice' in gas_estimate:
+            assert gas_estimate['gasprice'] >= gas_estimate['mingasprice']
+
 
 if __name__ == '__main__':
     EstimateFeeTest().main()
@@ -11,6 +11,7 @@ from test_framework.util import (
     assert_equal,
     assert_greater_than,
     assert_greater_than_or_equal,
+    wait_until,
 )
 
 from test_framework.authproxy import JSONRPCException
@@ -61,6 +62,81 @@ class RpcMiscTest(BitcoinTestFramework):
         node.logging(include=['qt'])
         assert_equal(node.logging()['qt'], True)
 
+        self.log.info("test getindexinfo")
+        # Without any indices running the RPC returns an empty object
+        assert_equal(node.getindexinfo(), {})
+
+        # Restart the node with indices and wait for them to sync
+        self.restart_node(0, ["-txindex", "-blockfilterindex"])
+        wait_until(lambda: all(i["synced"] for i in node.getindexinfo().values()))
+        wait_until(lambda: node.getindexinfo("txindex")["txindex"]["lookup_filter"]["ready"])
+        height = node.getblockcount()
+
+        # Returns a list of all running indices by default
+        info = node.getindexinfo()
+        lookup_filter = info["txindex"].pop("lookup_filter")
+        assert_equal(
+            info,
+            {
+                "txindex": {"synced": True, "best_block_height": height},
+                "basic block filter index": {"synced": True, "best_block_height": height},
+            }
+        )
+
+        # The txindex reports its lookup filter
+        assert_greater_than(lookup_filter["memory_usage"], 0)
+        assert_greater_than_or_equal(lookup_filter["entries"], height)
+        assert_greater_than(lookup_filter["capacity"], lookup_filter["entries"])
+
+        # Lookups of unknown transactions are answered by the filter
+        checked = lookup_filter["skipped_lookups"] + lookup_filter["false_positives"]
+        assert_raises_rpc_error(-5, "No such mempool or blockchain transaction", node.getrawtransaction, "ab" * 32)
+        lookup_filter = node.getindexinfo("txindex")["txindex"]["lookup_filter"]
+        assert_equal(lookup_filter["skipped_lookups"] + lookup_filter["false_positives"], checked + 1)
+
+        # Specifying an index by name returns only the status of that index
+        info = node.getindexinfo("basic block filter index")
+        assert_equal(info, {"basic block filter index": {"synced": True, "best_block_height": height}})
+
+        # Specifying an unknown index name returns an empty result
+        assert_equal(node.getindexinfo("foo"), {})
+
+        # The lookup filter can be turned off
+        self.restart_node(0, ["-txindex", "-txindexfilter=0"])
+        wait_until(lambda: node.getindexinfo("txindex")["txindex"]["synced"])
+        assert "lookup_filter" not in node.getindexinfo("txindex")["txindex"]
+
+        self.log.info("test getdbinfo")
+        info = node.getdbinfo()
+        for name in ["blockindex", "chainstate", "results", "txindex"]:
+            assert_equal(info[name]["bloom_bits"], 10)
+            assert_greater_than(info[name]["cache_size"], 0)
+            assert_greater_than_or_equal(info[name]["memory_usage"], 0)
+        assert_equal(list(node.getdbinfo("txindex").keys()), ["txindex"])
+        assert_equal(node.getdbinfo("foo"), {})
+
+        # Databases can be tuned one by one
+        self.restart_node(0, ["-txindex", "-dboption=txindex:bloombits=16", "-dboption=txindex:cache=4", "-dboption=results:writebuffer=1"])
+        info = node.getdbinfo()
+        assert_equal(info["txindex"]["bloom_bits"], 16)
+        assert_equal(info["txindex"]["cache_size"], 4 << 20)
+        assert_equal(info["txindex"]["write_buffer_size"], 1 << 20)
+        assert_equal(info["results"]["write_buffer_size"], 1 << 20)
+        assert_equal(info["chainstate"]["bloom_bits"], 10)
+
+        self.stop_node(0)
+        node.assert_start_raises_init_error(["-dboption=txindex:bloombits"], "Error: Invalid -dboption value txindex:bloombits.")
+        node.assert_start_raises_init_error(["-dboption=foo:cache=1"], "Error: Unknown database foo in -dboption.")
+        self.start_node(0)
+
+        self.log.info("test getsigcacheinfo")
+        info = node.getsigcacheinfo()
+        for name in ["signatures", "script_execution"]:
+            assert_equal(info[name]["shards"], 16)
+            assert_greater_than(info[name]["capacity"], 0)
+            for counter in ["hits", "misses", "inserts"]:
+                assert_greater_than_or_equal(info[name][counter], 0)
+
 
 if __name__ == '__main__':
     RpcMiscTest().main()
@@ -82,6 +82,7 @@ BASE_SCRIPTS = [
     # Scripts that are run by default.
     # Longest test should go first, to favor running tests in parallel
     'wallet_hd.py',
+    'wallet_fast_rescan.py',
     'wallet_backup.py',
     # vv Tests less than 5m vv
     'mining_getblocktemplate_longpoll.py',
@@ -108,6 +109,7 @@ BASE_SCRIPTS = [
     'rpc_rawtransaction.py',
     'wallet_address_types.py',
     'p2p_feefilter.py',
+    'p2p_txreconciliation.py',
     'feature_reindex.py',
     'feature_abortnode.py',
     # vv Tests less than 30s vv
@@ -273,6 +275,8 @@ BASE_SCRIPTS = [
     'yupost_prioritize_create_over_call.py',
     'yupost_callcontract_timestamp.py',
     'yupost_transaction_receipt_origin_contract_address.py',
+    'yupost_rest_receipts.py',
+    'yupost_contract_blockfilter.py',
     'yupost_block_number_corruption.py',
     'yupost_duplicate_stake.py',
     'yupost_rpc_bitcore.py',
@@ -53,8 +53,8 @@ class WalletTest(BitcoinTestFramework):
         self.num_nodes = 3
         self.setup_clean_chain = True
         self.extra_args = [
-            ['-limitdescendantcount=3', '-headerspamfilter=0'],  # Limit mempool descendants as a hack to have wallet txs rejected from the mempool
-            ['-headerspamfilter=0'],
+            ['-limitdescendantcount=3', '-headerspamfilter=0', '-checkwalletbalance'],  # Limit mempool descendants as a hack to have wallet txs rejected from the mempool
+            ['-headerspamfilter=0', '-checkwalletbalance'],
             ['-headerspamfilter=0']
         ]
 
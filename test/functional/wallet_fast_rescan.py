@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test that wallet rescans skip blocks using block filters.
+
+A wallet is restored from a backup taken before any of its keys were used,
+so the rescan has to top up the keypool as it finds transactions. The
+restored wallet must find the same transactions with and without the block
+filter index, and with and without rescan threads."""
+import os
+import shutil
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    wait_until,
+)
+from test_framework.yupostconfig import COINBASE_MATURITY
+
+NUM_DESTINATIONS = 10
+NUM_EMPTY_BLOCKS = 5
+
+
+class WalletFastRescanTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.extra_args = [['-blockfilterindex', '-keypool=1']]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def get_txids(self, wallet):
+        return sorted(set(tx['txid'] for tx in wallet.listtransactions('*', 1000)))
+
+    def restore(self, name):
+        backup = os.path.join(self.nodes[0].datadir, 'fast_rescan.bak')
+        shutil.copyfile(backup, os.path.join(self.nodes[0].datadir, self.chain, 'wallets', name))
+        self.nodes[0].loadwallet(name)
+        return self.nodes[0].get_wallet_rpc(name)
+
+    def run_test(self):
+        node = self.nodes[0]
+        funder = node.get_wallet_rpc('')
+        node.generatetoaddress(COINBASE_MATURITY + 1, funder.getnewaddress())
+
+        node.createwallet('fast_rescan')
+        wallet = node.get_wallet_rpc('fast_rescan')
+        wallet.backupwallet(os.path.join(node.datadir, 'fast_rescan.bak'))
+
+        self.log.info("Fund the wallet on keys beyond its keypool, between empty blocks")
+        for _ in range(NUM_DESTINATIONS):
+            funder.sendtoaddress(wallet.getnewaddress(), 1)
+            node.generate(1)
+            node.generate(NUM_EMPTY_BLOCKS)
+        wallet.sendtoaddress(funder.getnewaddress(), 0.5)
+        node.generate(1)
+        txids = self.get_txids(wallet)
+        assert_equal(len(txids), NUM_DESTINATIONS + 1)
+        wait_until(lambda: all(i['synced'] for i in node.getindexinfo().values()))
+
+        self.log.info("Restore the wallet with block filters and rescan threads")
+        with node.assert_debug_log(['Rescan skipped']):
+            restored = self.restore('filters.dat')
+        assert_equal(self.get_txids(restored), txids)
+
+        self.log.info("Restore the wallet without block filters or rescan threads")
+        self.restart_node(0, ['-blockfilterindex=0', '-keypool=1', '-rescanthreads=0'])
+        with node.assert_debug_log(expected_msgs=['Rescan completed'], unexpected_msgs=['Rescan skipped']):
+            restored = self.restore('no_filters.dat')
+        assert_equal(self.get_txids(restored), txids)
+
+
+if __name__ == '__main__':
+    WalletFastRescanTest().main()
@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Test block filters over contract addresses and log topics."""
+
+from io import BytesIO
+import os
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+from test_framework.messages import deser_compact_size, hash256
+from test_framework.siphash import siphash
+from test_framework.yupostconfig import COINBASE_MATURITY
+
+CONTRACT_FILTER_P = 19
+CONTRACT_FILTER_M = 784931
+
+# Emits TestEvent() when doEvent() (afd67ce7) is called
+CONTRACT_BYTECODE = "608060405234801561001057600080fd5b506102b8806100206000396000f3fe608060405234801561001057600080fd5b506004361061005e576000357c010000000000000000000000000000000000000000000000000000000090048063afd67ce714610063578063bcb1c3a91461006d578063f8d86e18146100b7575b600080fd5b61006b6100fb565b005b610075610220565b604051808273ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff16815260200191505060405180910390f35b6100f9600480360360208110156100cd57600080fd5b81019080803573ffffffffffffffffffffffffffffffffffffffff169060200190929190505050610249565b005b600073ffffffffffffffffffffffffffffffffffffffff166000809054906101000a900473ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff161415610182577f24ec1d3ff24c2f6ff210738839dbc339cd45a5294d85c79361016243157aae7b60405160405180910390a161021e565b6000809054906101000a900473ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff1663afd67ce76040518163ffffffff167c0100000000000000000000000000000000000000000000000000000000028152600401600060405180830381600087803b15801561020757600080fd5b5060325a03f115801561021957600080fd5b505050505b565b60008060009054906101000a900473ffffffffffffffffffffffffffffffffffffffff16905090565b806000806101000a81548173ffffffffffffffffffffffffffffffffffffffff021916908373ffffffffffffffffffffffffffffffffffffffff1602179055505056fea165627a7a723058203cf61a18e40f6e2bd01b2f7bd607c6e6aff032f12bd5e3eca68212d2e2c80dbf0029"
+
+
+def decode_gcs(block_hash, filter_hex):
+    """Return the hashed values in a BIP 158 style filter, and the keys and range used to hash elements into it."""
+    f = BytesIO(bytes.fromhex(filter_hex))
+    n = deser_compact_size(f)
+    bits = ''.join('{:08b}'.format(b) for b in f.read())
+    values = []
+    pos = 0
+    value = 0
+    for _ in range(n):
+        quotient = 0
+        while bits[pos] == '1':
+            quotient += 1
+            pos += 1
+        pos += 1
+        remainder = int(bits[pos:pos + CONTRACT_FILTER_P], 2)
+        pos += CONTRACT_FILTER_P
+        value += (quotient << CONTRACT_FILTER_P) | remainder
+        values.append(value)
+    key = int(block_hash, 16)
+    return set(values), key & 0xffffffffffffffff, key >> 64 & 0xffffffffffffffff, n * CONTRACT_FILTER_M
+
+
+def gcs_match(decoded, element):
+    values, k0, k1, f = decoded
+    return (siphash(k0, k1, element) * f) >> 64 in values
+
+
+class YuPostContractBlockFilterTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.extra_args = [['-logevents', '-blockfilterindex=contract']]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(COINBASE_MATURITY + 10)
+
+        contract_address = node.createcontract(CONTRACT_BYTECODE)['address']
+        node.generate(1)
+        txid = node.sendtocontract(contract_address, "afd67ce7", 0, 1000000)['txid']
+        block_hash = node.generate(1)[0]
+        receipt = node.gettransactionreceipt(txid)[0]
+        assert_equal(len(receipt['log']), 1)
+
+        self.log.info("The filter matches the contract address and the log address and topics")
+        result = node.getblockfilter(block_hash, 'contract')
+        decoded = decode_gcs(block_hash, result['filter'])
+        log = receipt['log'][0]
+        for element in [receipt['contractAddress'], log['address']] + log['topics']:
+            assert gcs_match(decoded, bytes.fromhex(element))
+        assert not gcs_match(decoded, os.urandom(20))
+        assert not gcs_match(decoded, bytes(20))
+
+        self.log.info("The filter headers form a chain")
+        prev_header = node.getblockfilter(node.getblockhash(node.getblockcount() - 1), 'contract')['header']
+        filter_hash = hash256(bytes.fromhex(result['filter']))
+        header = hash256(filter_hash + bytes.fromhex(prev_header)[::-1])
+        assert_equal(header[::-1].hex(), result['header'])
+
+        self.log.info("Blocks without contract transactions have empty filters")
+        assert_equal(node.getblockfilter(node.getblockhash(COINBASE_MATURITY), 'contract')['filter'], '00')
+        assert_raises_rpc_error(-1, "Index is not enabled for filtertype basic", node.getblockfilter, block_hash, 'basic')
+
+        self.log.info("Contract filters need -logevents")
+        self.stop_node(0)
+        node.assert_start_raises_init_error(['-blockfilterindex=contract', '-logevents=0'], 'Error: -blockfilterindex=contract requires -logevents.')
+
+
+if __name__ == '__main__':
+    YuPostContractBlockFilterTest().main()
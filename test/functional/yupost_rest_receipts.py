@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""Test the REST endpoints for contract receipts and the address index."""
+
+from decimal import Decimal
+import http.client
+import json
+from io import BytesIO
+from struct import unpack
+import urllib.parse
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+from test_framework.messages import deser_compact_size, deser_uint256
+from test_framework.yupostconfig import COINBASE_MATURITY
+
+# Emits TestEvent() when doEvent() (afd67ce7) is called
+CONTRACT_BYTECODE = "608060405234801561001057600080fd5b506102b8806100206000396000f3fe608060405234801561001057600080fd5b506004361061005e576000357c010000000000000000000000000000000000000000000000000000000090048063afd67ce714610063578063bcb1c3a91461006d578063f8d86e18146100b7575b600080fd5b61006b6100fb565b005b610075610220565b604051808273ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff16815260200191505060405180910390f35b6100f9600480360360208110156100cd57600080fd5b81019080803573ffffffffffffffffffffffffffffffffffffffff169060200190929190505050610249565b005b600073ffffffffffffffffffffffffffffffffffffffff166000809054906101000a900473ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff161415610182577f24ec1d3ff24c2f6ff210738839dbc339cd45a5294d85c79361016243157aae7b60405160405180910390a161021e565b6000809054906101000a900473ffffffffffffffffffffffffffffffffffffffff1673ffffffffffffffffffffffffffffffffffffffff1663afd67ce76040518163ffffffff167c0100000000000000000000000000000000000000000000000000000000028152600401600060405180830381600087803b15801561020757600080fd5b5060325a03f115801561021957600080fd5b505050505b565b60008060009054906101000a900473ffffffffffffffffffffffffffffffffffffffff16905090565b806000806101000a81548173ffffffffffffffffffffffffffffffffffffffff021916908373ffffffffffffffffffffffffffffffffffffffff1602179055505056fea165627a7a723058203cf61a18e40f6e2bd01b2f7bd607c6e6aff032f12bd5e3eca68212d2e2c80dbf0029"
+
+
+class YuPostRESTReceiptsTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.extra_args = [['-rest', '-logevents', '-addrindex=1']]
+        self.supports_cli = False
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_bitcore()
+        self.skip_if_no_wallet()
+
+    def rest_request(self, uri, status=200):
+        url = urllib.parse.urlparse(self.nodes[0].url)
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        conn.request('GET', '/rest' + uri)
+        resp = conn.getresponse()
+        assert_equal(resp.status, status)
+        data = resp.read()
+        if uri.endswith('.json') and status == 200:
+            return json.loads(data.decode('utf-8'), parse_float=Decimal)
+        return data
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(COINBASE_MATURITY + 10)
+
+        contract_address = node.createcontract(CONTRACT_BYTECODE)['address']
+        node.generate(1)
+        txid = node.sendtocontract(contract_address, "afd67ce7", 0, 1000000)['txid']
+        blockhash = node.generate(1)[0]
+
+        self.log.info("Receipt of a transaction in all formats")
+        receipt = node.gettransactionreceipt(txid)
+        assert_equal(len(receipt), 1)
+        assert_equal(self.rest_request('/receipt/%s.json' % txid), receipt)
+
+        binary = self.rest_request('/receipt/%s.bin' % txid)
+        assert_equal(self.rest_request('/receipt/%s.hex' % txid).decode().strip(), binary.hex())
+        f = BytesIO(binary)
+        assert_equal(deser_compact_size(f), 1)
+        assert_equal('%064x' % deser_uint256(f), receipt[0]['blockHash'])
+        assert_equal(unpack('<I', f.read(4))[0], receipt[0]['blockNumber'])
+        assert_equal('%064x' % deser_uint256(f), txid)
+        assert_equal(unpack('<I', f.read(4))[0], receipt[0]['transactionIndex'])
+        assert_equal(unpack('<I', f.read(4))[0], receipt[0]['outputIndex'])
+        assert_equal(f.read(20).hex(), receipt[0]['from'])
+        assert_equal(f.read(20).hex(), receipt[0]['to'])
+
+        self.log.info("Receipts of a block")
+        assert_equal(self.rest_request('/blockreceipts/%s.json' % blockhash), receipt)
+        coinbase_only = node.getblockhash(COINBASE_MATURITY)
+        assert_equal(self.rest_request('/blockreceipts/%s.json' % coinbase_only), [])
+        assert_equal(self.rest_request('/blockreceipts/%s.bin' % coinbase_only), b'\x00')
+
+        self.log.info("A transaction without receipts gives an empty list")
+        coinbase_txid = node.getblock(coinbase_only)['tx'][0]
+        assert_equal(self.rest_request('/receipt/%s.json' % coinbase_txid), [])
+
+        self.log.info("Address deltas and unspent outputs")
+        address = node.getnewaddress()
+        node.sendtoaddress(address, 1)
+        node.sendtoaddress(address, 2)
+        node.generate(1)
+        height = node.getblockcount()
+
+        deltas = node.getaddressdeltas({'addresses': [address]})
+        assert_equal(len(deltas), 2)
+        assert_equal(self.rest_request('/addressdeltas/%s.json' % address), deltas)
+        assert_equal(self.rest_request('/addressdeltas/%d/%d/%s.json' % (height, height, address)), deltas)
+        assert_equal(self.rest_request('/addressdeltas/1/%d/%s.json' % (height - 1, address)), [])
+
+        f = BytesIO(self.rest_request('/addressdeltas/%s.bin' % address))
+        assert_equal(deser_compact_size(f), 2)
+        for delta in deltas:
+            assert_equal('%064x' % deser_uint256(f), delta['txid'])
+            assert_equal(unpack('<I', f.read(4))[0], delta['index'])
+            assert_equal(unpack('<i', f.read(4))[0], delta['height'])
+            assert_equal(unpack('<I', f.read(4))[0], delta['blockindex'])
+            assert_equal(unpack('<q', f.read(8))[0], delta['satoshis'])
+
+        utxos = node.getaddressutxos({'addresses': [address]})
+        assert_equal(self.rest_request('/addressutxos/%s.json' % address), utxos)
+        f = BytesIO(self.rest_request('/addressutxos/%s.bin' % address))
+        assert_equal(deser_compact_size(f), len(utxos))
+
+        self.log.info("Invalid requests")
+        self.rest_request('/receipt/%s.json' % ('0' * 63), status=400)
+        self.rest_request('/blockreceipts/%s.json' % ('0' * 64), status=404)
+        self.rest_request('/addressdeltas/notanaddress.json', status=400)
+        self.rest_request('/addressdeltas/5/1/%s.json' % address, status=400)
+        self.rest_request('/addressutxos/%s.xml' % address, status=404)
+
+
+if __name__ == '__main__':
+    YuPostRESTReceiptsTest().main()